@@ -1,16 +1,33 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
+#include <stdarg.h>
 #include <string.h>
 #include <time.h>
 #include <ctype.h>
+#include <signal.h>
+#include <errno.h>
+#include <sys/stat.h>
 #ifdef _WIN32
     #include <io.h>
     #include <conio.h>
+    #include <direct.h>
     #define access _access
     #define F_OK 0
 #else
     #include <unistd.h>
     #include <termios.h>
+    #include <pthread.h>
+    #include <sys/wait.h>
+    #include <sys/mman.h>
+    #include <fcntl.h>
+    #include <dirent.h>
+    #include <sys/socket.h>
+    #include <sys/un.h>
+    #include <poll.h>
+    #ifdef __linux__
+        #include <sys/epoll.h>
+    #endif
 #endif
 
 #ifdef _WIN32
@@ -53,9 +70,7 @@ void setColor(int textColor, int bgColor) {
 
 // Constants
 #define MAX_STRING 100
-#define MAX_PRODUCTS 1000
-#define MAX_CUSTOMERS 1000
-#define MAX_EMPLOYEES 100
+#define STRING_BLOCK_SIZE 65536
 #define MAX_CART_ITEMS 50
 #define LOYALTY_THRESHOLD 100000
 #define LOW_STOCK_THRESHOLD 10
@@ -67,24 +82,77 @@ void setColor(int textColor, int bgColor) {
 #define LOYALTY_MILESTONE_1 100000
 #define LOYALTY_MILESTONE_2 200000
 #define LOYALTY_MILESTONE_3 300000
-
+#define PRODUCT_JOURNAL_FILE "products.journal"
+#define PRODUCT_JOURNAL_COMPACT_AT 1000
+#define CUSTOMER_JOURNAL_FILE "customers.journal"
+#define CUSTOMER_JOURNAL_COMPACT_AT 1000
+#define EMPLOYEE_FLUSH_INTERVAL 30
+#define AGGREGATE_FILE "sales.agg"
+#define AGGREGATE_ORDER_ROW -1
+#define AGGREGATE_MAX_THREADS 16
+#define AGGREGATE_MIN_CHUNK (256 * 1024)  // Bytes of sales log worth a thread of its own
+#define SALES_LOG_FILE "sales.log"  // Single log from before partitioning; split on first start
+#define SALES_DIR "sales"           // One log per month: sales/YYYY-MM.log
+#define SALES_PARTITION_PATH_SIZE 32
+#define STORE_LOCK_FILE "shop.lock"  // Serializes changes between tills sharing this directory
+#define ORDER_ID_FILE "order.id"     // Last order id handed out by any till
+#define SERVER_SOCKET_FILE "shop.sock"
+#define SERVER_MAX_REQUEST 65536
+#define SERVER_SEARCH_LIMIT 50
+#define SERVER_MAX_EVENTS 64
+#define SERVER_MAX_OUTPUT (1 << 20)   // Unsent reply bytes before a till's requests wait
+#define SERVER_FLUSH_MS 1000          // How long a stopping daemon waits on a till to take its replies
+#define SALES_LOG_MAGIC "SSLG"
+#define SALES_LOG_VERSION 2
+#define SALES_LOG_HEADER_SIZE 16
+#define SALES_LOG_RECORD_HEADER 8
+#define SALES_LOG_ITEM_SIZE 24     // 16 in version 1 records, which carry no cost
+#define SALES_LOG_RECORD_SIZE(items) (SALES_LOG_RECORD_HEADER + 8 + 4 + 8 + 8 + 1 + 256 + 256 + 2 + (items) * SALES_LOG_ITEM_SIZE)
+#define SALES_LOG_MAX_RECORD SALES_LOG_RECORD_SIZE(65535)
+#ifndef SALES_COMMIT_WINDOW_MS
+#define SALES_COMMIT_WINDOW_MS 2  // How long the daemon gathers orders before syncing; "serve ... window=<ms>"
+#endif
+#ifndef RECEIPT_USE_WKHTMLTOPDF
+#define RECEIPT_USE_WKHTMLTOPDF 0  // Build with -DRECEIPT_USE_WKHTMLTOPDF=1 for HTML receipts via wkhtmltopdf
+#endif
+#define PDF_PAGE_WIDTH 595
+#define PDF_PAGE_HEIGHT 842
+#define PDF_MAX_PAGES 8
+#define OUTPUT_BUFFER_SIZE (1 << 20)
+#define MONEY_STR_SIZE 32
+#define TAKA(amount) ((Money)(amount) * 100)
+#define RECEIPT_QUEUE_FILE "receipts.queue"
+#define JOB_MAX_WORKERS 16
+#define JOB_PRIORITY_RECEIPT 0  // Someone at the till is waiting for it
+#define JOB_PRIORITY_STORE 1    // Snapshot writes the caller waits on
+#define JOB_PRIORITY_REPORT 2   // Report PDFs and exports
+#define JOB_PRIORITIES 3
+#define PRODUCT_SAVE_CHUNK 8192  // Products formatted per job by saveProducts
+
+// Money is held as whole paisa (1/100 taka) so sums are exact; parse it
+// with parseMoney and print it with moneyStr or formatMoney. Thresholds
+// like LOYALTY_THRESHOLD stay in taka and go through TAKA()
+typedef int64_t Money;
+
+// String fields point into the interned string arena (see internString)
 typedef struct {
     int id;
-    char name[MAX_STRING];
-    char category[MAX_STRING];
+    const char* name;
+    const char* category;
     int quantity;
-    float purchase_price;
-    float sale_price;
-    char date_added[MAX_STRING];
+    Money purchase_price;
+    Money sale_price;
+    const char* date_added;
 } Product;
 
 typedef struct {
-    char name[MAX_STRING];
-    char phone[MAX_STRING];
-    char address[MAX_STRING];
-    float total_spending;
+    const char* name;
+    const char* phone;
+    const char* address;
+    Money total_spending;
     int loyalty_points;
     int last_loyalty_milestone;
+    int dirty;  // changed since the last flushCustomers
 } Customer;
 
 typedef struct {
@@ -93,13 +161,15 @@ typedef struct {
     char username[MAX_STRING];
     char password[MAX_STRING];
     char role[MAX_STRING];
-    float total_sales;
+    Money total_sales;
+    Money unsaved_sales;  // sold by this till since the last saveEmployees
 } Employee;
 
 typedef struct {
     int product_id;
     int quantity;
-    float price;
+    Money price;
+    Money cost;  // Purchase price per unit when sold; see costOrderItems
 } CartItem;
 
 typedef struct {
@@ -109,31 +179,316 @@ typedef struct {
     char date[30];
     CartItem items[MAX_CART_ITEMS];
     int item_count;
-    float total_amount;
-    float discount;
+    Money total_amount;
+    Money discount;
     int payment_method;
     char transaction_id[50];
     float manual_discount_percentage;
     float card_discount_percentage;
 } Order;
 
-Product products[MAX_PRODUCTS];
-Customer customers[MAX_CUSTOMERS];
-Employee employees[MAX_EMPLOYEES];
+// Everything a receipt shows, copied out of the shared tables at checkout
+// so the receipt workers never read customers[] or products[]
+typedef struct {
+    Order order;
+    int has_customer;
+    char customer_name[MAX_STRING];
+    char customer_address[MAX_STRING];
+    char item_names[MAX_CART_ITEMS][MAX_STRING];  // Empty for unknown products
+    int open_when_done;
+} Receipt;
+
+// Buffered output for the report and receipt emitters; see outPrintf
+typedef struct {
+    FILE* file;  // NULL keeps everything in data
+    char* data;
+    size_t size;
+    size_t capacity;
+    int failed;
+} OutputBuffer;
+
+// A whole data file, memory-mapped where the platform allows; see mapFile
+typedef struct {
+    const char* data;
+    size_t size;
+    int mapped;  // 0 when data was read into the heap instead
+} MappedFile;
+
+// A run of bytes inside a mapped file. Not NUL-terminated.
+typedef struct {
+    const char* data;
+    size_t len;
+} StringView;
+
+// One HTML-to-PDF conversion for renderReportJobs
+typedef struct {
+    char html[256];
+    char pdf[256];
+    int ok;
+} ReportJob;
+
+// One row of sales.txt plus the range of its line items in the ledger
+typedef struct {
+    long id;
+    char customer_phone[MAX_STRING];
+    int employee_id;
+    char date[30];
+    Money total_amount;
+    Money discount;
+    int item_start;
+    int item_count;
+    int item_units;
+} LedgerOrder;
+
+typedef struct {
+    long order_id;
+    int product_id;
+    int quantity;
+    Money price;
+    int seq;
+} LedgerItem;
+
+// Order history loaded once from the sales partitions; see loadSalesLedger
+typedef struct {
+    LedgerOrder* orders;
+    int order_count;
+    LedgerItem* items;
+    int item_count;
+    int* by_customer;
+} SalesLedger;
+
+typedef struct {
+    int product_id;
+    int qty_sold;
+    Money revenue;
+    Money cost;
+} ProductSummary;
+
+typedef struct {
+    int orders;
+    int items;
+    Money sales;
+    Money discount;
+} EmployeeSummary;
+
+typedef struct {
+    char date[11];
+    int orders;
+    int items;
+    Money sales;
+    Money discount;
+} DailySummary;
+
+// One row of the sales aggregate store; see recordOrderAggregates
+typedef struct {
+    int day;
+    int employee_id;
+    int product_id;
+    int orders;
+    int items;
+    Money gross;
+    Money discount;
+    Money cost;
+} SalesAggregate;
+
+// Aggregate rows with an open-addressing index on (day, employee, product)
+typedef struct {
+    SalesAggregate* rows;
+    int count;
+    int capacity;
+    int* slots;
+    int slot_capacity;
+} AggregateTable;
+
+// One record-aligned byte range of a sales partition for rebuildAggregates
+typedef struct {
+    const unsigned char* data;
+    size_t start;
+    size_t end;
+    size_t stopped_at;  // end, or the offset of the first damaged record
+    int partition;
+    AggregateTable* table;
+} AggregateChunk;
+
+// Worker w of n takes chunks w, w + n, w + 2n, ...
+typedef struct {
+    AggregateChunk* chunks;
+    int count;
+    int first;
+    int step;
+} AggregateWork;
+
+// Identity of a data file, to notice another till replacing or growing it.
+// inode is 0 where the platform has none.
+typedef struct {
+    long long inode;
+    long long size;
+    long long mtime;
+} FileStamp;
+
+// How much of a snapshot + journal pair this till has read. journal.size
+// is the replayed length rather than the size on disk.
+typedef struct {
+    FileStamp snapshot;
+    FileStamp journal;
+} StoreSync;
+
+// Appends records to the month partitions, keeping the last one open. A
+// durable writer syncs each partition to disk as it closes it.
+typedef struct {
+    FILE* file;
+    int month;
+    int ok;
+    int durable;
+} SalesLogWriter;
+
+// A function to run on the job scheduler; see submitJob
+typedef struct {
+    void (*run)(void* arg);
+    void* arg;
+} Job;
+
+// One priority level of a worker's jobs. The worker pushes and pops at
+// the bottom; other workers steal the oldest job from the top.
+typedef struct {
+    Job* jobs;
+    int top;
+    int bottom;
+    int capacity;
+} JobDeque;
+
+#ifndef _WIN32
+typedef struct {
+    pthread_t thread;
+    pthread_mutex_t lock;
+    JobDeque deques[JOB_PRIORITIES];
+} JobWorker;
+
+// Parts of one task that the submitter waits for; see runJobs
+typedef struct {
+    void (*run)(void* arg, int part);
+    void* arg;
+    int count;
+    int next;      // First part nobody has claimed
+    int finished;
+    int refs;      // Queued helpers plus the submitter
+    pthread_mutex_t lock;
+    pthread_cond_t done;
+} JobBatch;
+#endif
+
+// One till connected to the daemon: the cart it is building, requests
+// read but not yet answered, and replies not yet sent
+typedef struct {
+    int fd;  // -1 once closed
+    CartItem cart[MAX_CART_ITEMS];
+    int cart_count;
+    char* input;
+    size_t input_size;
+    size_t input_capacity;
+    OutputBuffer output;
+    size_t output_sent;
+    int watching;  // SERVER_READ and SERVER_WRITE bits
+    int busy;      // A request of this till's is with a worker
+    int eof;       // The till has sent its last request
+    unsigned long long commit_seq;  // Sale the held replies wait on; 0 if none
+    size_t commit_from;             // Replies from here on wait for commit_seq to be synced
+} ServerSession;
+
+// A slow request handed from the event loop to the worker pool
+typedef struct {
+    ServerSession* session;
+    char* request;
+    OutputBuffer reply;
+} ServerJob;
+
+// Something that happened on a watched descriptor; see waitEvents
+typedef struct {
+    void* data;
+    int readable;  // Also set on errors and hangups, for the read to find
+    int writable;
+} ServerEvent;
+
+// Counts kept by the client's reply reader
+typedef struct {
+    int fd;
+    int received;
+    int failed;
+} ClientReplies;
+
+// Growable tables; see ensureProductCapacity and friends
+Product* products = NULL;
+Customer* customers = NULL;
+Employee* employees = NULL;
 CartItem current_cart[MAX_CART_ITEMS];
 int product_count = 0;
 int customer_count = 0;
 int employee_count = 0;
+int product_capacity = 0;
+int customer_capacity = 0;
+int employee_capacity = 0;
 int cart_count = 0;
 Employee current_user;
 
+// Set for command-line runs: no screen clears, pauses or chatter
+int headless = 0;
+
+// While the daemon serves a request, command results and errors are
+// collected here for the client instead of going to stdout and stderr
+OutputBuffer* command_reply = NULL;
+
+// Open-addressing map from product id to its position in products[].
+// Slots hold index + 1 so that 0 marks an empty slot.
+int* product_slots = NULL;
+int product_slot_capacity = 0;
+int product_journal_entries = 0;
+
+// Same scheme for customers[], keyed by phone number
+int* customer_slots = NULL;
+int customer_slot_capacity = 0;
+int* dirty_customers = NULL;
+int dirty_customer_count = 0;
+int dirty_customer_capacity = 0;
+int customer_journal_entries = 0;
+int* employee_id_slots = NULL;
+int* employee_username_slots = NULL;
+int employee_slot_capacity = 0;
+int employees_dirty = 0;
+time_t employees_flushed_at = 0;
+
+// Sales aggregate store, indexed the same way as products[]
+AggregateTable aggregates = {NULL, 0, 0, NULL, 0};
+
+// Store lock and what this till has read of the shared files; see lockStore
+int store_lock_depth = 0;
+int store_loaded = 0;
+#ifdef _WIN32
+HANDLE store_lock_handle = INVALID_HANDLE_VALUE;
+#else
+int store_lock_fd = -1;
+#endif
+StoreSync product_sync;
+StoreSync customer_sync;
+StoreSync aggregate_sync;  // sales.agg is the journal; it has no snapshot
+
 
 // Authentication functions
 void initializeSystem();
+void loadSystem();
 void loginScreen();
 int authenticateUser(char* username, char* password);
 void registerEmployee();
 void changePassword();
+void loadEmployees();
+void saveEmployees();
+void flushEmployees(int force);
+void flushEmployeesAtExit();
+void handleExitSignal(int sig);
+void checkExitRequest();
+void installExitHandlers();
+int findEmployeeIndex(int id);
+int findEmployeeByUsername(const char* username);
+void rebuildEmployeeIndex();
 
 // Menu functions
 void mainMenu();
@@ -150,10 +505,19 @@ void viewProducts();
 void searchProduct();
 void editProduct();
 void deleteProduct();
-void processPayment(Order* order);
+int processPayment(Order* order);
+int eligibleLoyaltyMilestone(const Customer* customer);
 void updateInventory(Order order);
 void saveProducts();
 void loadProducts();
+int findProductIndex(int id);
+void indexProduct(int index);
+void rebuildProductIndex();
+FILE* openProductJournal();
+void journalStockChange(FILE* journal, int index, int delta);
+int closeProductJournal(FILE* journal);
+void replayProductJournal(long offset);
+int findShortStock(const Order* order);
 
 // Inventory management functions
 void restockInventory();
@@ -163,6 +527,17 @@ void generateStockReport();
 // Sales management functions
 void createNewSale();
 void generateReceipt(Order order); 
+void prepareReceipt(const Order* order, Receipt* receipt);
+int renderReceipt(const Receipt* receipt);
+int writeReceiptPDF(const Receipt* receipt, const char* path);
+int writeReceiptHTML(const Receipt* receipt, const char* html_file);
+void resumeReceiptQueue();
+
+// Job scheduler functions
+int startJobWorkers();
+void stopJobWorkers();
+void submitJob(int priority, void (*run)(void* arg), void* arg);
+void runJobs(int priority, void (*run)(void* arg, int part), void* arg, int count);
 void viewSalesHistory();
 void addToCart();
 void viewCart();
@@ -179,10 +554,18 @@ void generateDetailedCustomerListPDF();
 void generateDetailedCustomerListCSV();
 void searchCustomer();
 void generateCustomerSearchPDF(const char* phone);
+int writeCustomerListHTML(const char* path);
+int writeDetailedCustomerListHTML(const char* path);
+int writeCustomerSearchHTML(const char* phone, const char* path);
 void updateCustomer();
 void saveCustomers();
 void loadCustomers();
-void updateEmployeeTotalSales(int employee_id, float sale_amount);
+int findCustomerIndex(const char* phone);
+void indexCustomer(int index);
+void rebuildCustomerIndex();
+void markCustomerDirty(int index);
+void flushCustomers();
+void updateEmployeeTotalSales(int employee_id, Money sale_amount);
 // Report functions
 void dailySalesReport();
 void monthlySalesReport();
@@ -191,38 +574,172 @@ void profitReport();
 
 // Utility functions
 void clearScreen();
+void pauseFor(int seconds);
 void printHeader(char* title);
+#ifdef __GNUC__
+int promptScanf(const char* format, ...) __attribute__((format(scanf, 1, 2)));
+#else
+int promptScanf(const char* format, ...);
+#endif
+char* promptLine(char* line, int size);
+int promptChar();
 void printLine();
 char* getCurrentDate();
-float calculateProfit(int product_id, int quantity);
-float applyDiscount(float amount, const char* phone);
-void saveTransactionToFile(Order order);
+unsigned int hashString(const char* str);
+const char* internString(const char* str);
+const char* internView(StringView view);
+void ensureProductCapacity(int needed);
+void ensureCustomerCapacity(int needed);
+void ensureEmployeeCapacity(int needed);
+Money calculateProfit(int product_id, int quantity);
+Money applyDiscount(Money amount, const char* phone);
+int saveTransactionToFile(Order order);
 void generatePDF(Order order);
+Money parseMoney(const char* text);
+int scanMoney(Money* amount);
+char* formatMoney(char* buf, Money amount);
+const char* moneyStr(Money amount);
+Money percentOf(Money amount, double percent);
+char* formatUnsigned(char* end, unsigned long long v);
+
+// Mapped file functions
+int mapFile(const char* path, MappedFile* file);
+void unmapFile(MappedFile* file);
+int nextLine(const char** cursor, const char* end, StringView* line);
+StringView nextField(StringView* line, char delimiter);
+int viewInt64(StringView view, int64_t* value);
+int viewInt(StringView view, int* value);
+int viewLong(StringView view, long* value);
+Money viewMoney(StringView view);
+void viewCopy(char* dest, size_t size, StringView view);
+
+// Output buffer functions
+int outOpen(OutputBuffer* out, const char* path);
+void outFlush(OutputBuffer* out);
+int outClose(OutputBuffer* out);
+void outWrite(OutputBuffer* out, const char* data, size_t len);
+#ifdef __GNUC__
+void outPrintf(OutputBuffer* out, const char* format, ...) __attribute__((format(printf, 2, 3)));
+#else
+void outPrintf(OutputBuffer* out, const char* format, ...);
+#endif
+
+// Sales ledger functions
+int loadSalesLedger(SalesLedger* ledger);
+int loadSalesLedgerRange(SalesLedger* ledger, int first_month, int last_month);
+int loadLegacySalesLedger(SalesLedger* ledger);
+int appendOrderToLog(const Order* order);
+void convertLegacySales();
+void partitionSalesLog();
+void freeSalesLedger(SalesLedger* ledger);
+int ledgerFindCustomerOrders(SalesLedger* ledger, const char* phone, int* first);
+int mapSalesLog(const char* path, MappedFile* log, size_t* start);
+int listSalesPartitions(int** months);
+void salesPartitionPath(char* path, int month);
+long intactSalesLength(const char* path, int month);
+void raiseSalesLogVersion(const char* path);
+void truncateSalesPartition(int month, long length);
+int writeSalesRecord(SalesLogWriter* writer, int month, const unsigned char* record, size_t size);
+int closeSalesLogWriter(SalesLogWriter* writer);
+int syncFile(int fd);
+void syncDirectory(const char* path);
+void noteSalesAppend(int month);
+void startSalesCommitter(void (*notify)(void));
+void stopSalesCommitter();
+unsigned long long salesDurable();
+unsigned long long salesFailed();
+int splitSalesLog(const unsigned char* data, size_t size, size_t start, size_t* bounds, int count);
+int decodeOrder(const unsigned char* p, uint32_t len, Order* order);
+long salesItemSize(long rest, int item_count);
+
+// Sales aggregate functions
+void loadAggregates();
+void rebuildAggregates();
+void recordOrderAggregates(const Order* order);
+void applyOrderAggregates(AggregateTable* table, const Order* order, FILE* file);
+Money productCost(int product_id, int quantity);
+void costOrderItems(Order* order);
+int dayKey(const char* date);
+int monthKey(const char* month);
+int parseDigits(const char** text, int max, int* value);
+int collectMonthlySales(int month, DailySummary* days);
+void collectEmployeeSales(EmployeeSummary* summary);
+int collectProductSales(ProductSummary* summary);
+
+// Shared store functions
+void lockStore();
+void unlockStore();
+void syncStore();
+void refreshStore();
+void syncProducts();
+void syncCustomers();
+void syncAggregates();
+int stampFile(const char* path, FileStamp* stamp);
+int truncateStream(FILE* file, long size);
+FILE* openJournal(const char* path);
+int sameFile(const FileStamp* a, const FileStamp* b);
 
 
 // Function prototypes
 void exportOptions(const char* report_type);
 void generateReportPDF(const char* report_type);
 void generateReportCSV(const char* report_type);
+int writeReportHTML(const char* report_type, const char* path);
+int writeReportCSV(const char* report_type, const char* path);
+
+// Report rendering
+void reportPath(char* path, size_t size, const char* name, const char* ext);
+void tempReportPath(char* path, size_t size);
+int renderReportJobs(ReportJob* jobs, int count);
+void newReportJob(ReportJob* job, const char* name);
+int finishReportPDF(ReportJob* job, int written);
+void showReportFailures();
 
 // Report content generators
-void generateProfitReportContent(FILE* file);
-void generateDailySalesReportContent(FILE* file);
-void generateMonthlySalesReportContent(FILE* file);
-void generateEmployeeSalesReportContent(FILE* file);
+void generateProfitReportContent(OutputBuffer* out);
+void generateDailySalesReportContent(OutputBuffer* out);
+void generateMonthlySalesReportContent(OutputBuffer* out);
+void generateEmployeeSalesReportContent(OutputBuffer* out);
 
 // CSV generators
-void generateProfitReportCSV(FILE* file);
-void generateDailySalesReportCSV(FILE* file);
-void generateMonthlySalesReportCSV(FILE* file);
-void generateEmployeeSalesReportCSV(FILE* file);
+void generateProfitReportCSV(OutputBuffer* out);
+void generateDailySalesReportCSV(OutputBuffer* out);
+void generateMonthlySalesReportCSV(OutputBuffer* out);
+void generateEmployeeSalesReportCSV(OutputBuffer* out);
 
 // Utility functions
 char* getCurrentDateTime(void);
 
+// Benchmark functions
+int runBenchmark(int argc, char* argv[]);
+
+// Headless command functions
+int isHeadlessCommand(const char* name);
+int runCommand(int argc, char* argv[]);
+int runCommandFile(const char* path);
+int commandImport(int argc, char* argv[]);
+int commandExport(int argc, char* argv[]);
+int splitCommand(char* line, char* args[]);
+long nextOrderId();
+long reserveOrderIds(int count);
+double nowSeconds();
+void commandError(const char* message, const char* detail);
+#ifdef __GNUC__
+void commandResult(const char* format, ...) __attribute__((format(printf, 1, 2)));
+#else
+void commandResult(const char* format, ...);
+#endif
+
+// POS daemon functions
+int runServer(int argc, char* argv[]);
+int runClient(int argc, char* argv[]);
+OutputBuffer* pauseServerRequest();
+void resumeServerRequest(OutputBuffer* reply);
+
 
 // Utility Functions Implementation
 void clearScreen() {
+    if (headless) return;
     #ifdef _WIN32
         system("cls");
     #else
@@ -230,17 +747,100 @@ void clearScreen() {
     #endif
 }
 
+void pauseFor(int seconds) {
+    if (!headless) sleep(seconds);
+    checkExitRequest();
+}
+
+// Menu input. Ctrl+C cuts a wait for input short; these then exit, from
+// outside the signal handler (see handleExitSignal).
+int promptScanf(const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    checkExitRequest();
+    int result = vscanf(format, args);
+    va_end(args);
+    checkExitRequest();
+    return result;
+}
+
+char* promptLine(char* line, int size) {
+    checkExitRequest();
+    char* result = fgets(line, size, stdin);
+    checkExitRequest();
+    return result;
+}
+
+int promptChar() {
+    checkExitRequest();
+    int ch = getchar();
+    checkExitRequest();
+    return ch;
+}
+
 void printHeader(char* title) {
     clearScreen();
     printLine();
     printf("\n\t\t%s\n", title);
     printLine();
+    showReportFailures();
 }
 
 void printLine() {
     printf("\n========================================================\n");
 }
 
+// "1234.5" or "-0.75" to paisa; a third decimal rounds, the rest is ignored
+Money parseMoney(const char* text) {
+    return viewMoney((StringView){text, strlen(text)});
+}
+
+// Reads one amount from stdin in place of promptScanf("%f")
+int scanMoney(Money* amount) {
+    char text[32];
+    int result = promptScanf("%31s", text);
+    if (result == 1) *amount = parseMoney(text);
+    return result;
+}
+
+// Writes amount as taka with two decimals into buf, which must hold
+// MONEY_STR_SIZE bytes. Safe from any thread.
+char* formatMoney(char* buf, Money amount) {
+    unsigned long long v = amount < 0 ? 0ULL - (unsigned long long)amount : (unsigned long long)amount;
+    char digits[32];
+    char* end = digits + sizeof(digits);
+    char* p = formatUnsigned(end, v);
+    while (end - p < 3) *--p = '0';
+
+    char* out = buf;
+    if (amount < 0) *out++ = '-';
+    size_t whole = end - p - 2;
+    memcpy(out, p, whole);
+    out += whole;
+    *out++ = '.';
+    *out++ = end[-2];
+    *out++ = end[-1];
+    *out = '\0';
+    return buf;
+}
+
+// formatMoney into one of a few rotating buffers, for use as a printf
+// argument. The buffers are shared: off the main thread only code holding
+// server_lock may call this (the daemon's report jobs do); receipt
+// rendering and other workers use formatMoney.
+const char* moneyStr(Money amount) {
+    static char buffers[8][MONEY_STR_SIZE];
+    static int next = 0;
+    next = (next + 1) % 8;
+    return formatMoney(buffers[next], amount);
+}
+
+// percent% of amount, rounded to the nearest paisa
+Money percentOf(Money amount, double percent) {
+    double value = amount * percent / 100;
+    return (Money)(value + (value >= 0 ? 0.5 : -0.5));
+}
+
 char* getCurrentDate() {
     static char date[MAX_STRING];
     time_t now = time(NULL);
@@ -248,11 +848,271 @@ char* getCurrentDate() {
     return date;
 }
 
+unsigned int hashString(const char* str) {
+    // FNV-1a
+    unsigned int hash = 2166136261u;
+    while (*str) {
+        hash ^= (unsigned char)*str++;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+// String arena
+// Product and customer text fields are interned: each distinct string is
+// stored once in a large block and never freed, so repeated categories and
+// dates share storage and records only carry pointers.
+char* string_block = NULL;
+size_t string_block_used = 0;
+size_t string_block_size = 0;
+const char** intern_slots = NULL;
+int intern_capacity = 0;
+int intern_count = 0;
+
+char* arenaAlloc(size_t size) {
+    if (string_block_used + size > string_block_size) {
+        string_block_size = size > STRING_BLOCK_SIZE ? size : STRING_BLOCK_SIZE;
+        string_block = malloc(string_block_size);
+        string_block_used = 0;
+    }
+    char* ptr = string_block + string_block_used;
+    string_block_used += size;
+    return ptr;
+}
+
+const char* internString(const char* str) {
+    return internView((StringView){str, strlen(str)});
+}
+
+const char* internView(StringView view) {
+    if ((intern_count + 1) * 2 > intern_capacity) {
+        int capacity = intern_capacity ? intern_capacity * 2 : 1024;
+        const char** slots = calloc(capacity, sizeof(const char*));
+        for (int i = 0; i < intern_capacity; i++) {
+            if (intern_slots[i]) {
+                unsigned int slot = hashString(intern_slots[i]) & (capacity - 1);
+                while (slots[slot]) slot = (slot + 1) & (capacity - 1);
+                slots[slot] = intern_slots[i];
+            }
+        }
+        free(intern_slots);
+        intern_slots = slots;
+        intern_capacity = capacity;
+    }
+
+    // FNV-1a, as hashString computes for the stored copy
+    unsigned int hash = 2166136261u;
+    for (size_t i = 0; i < view.len; i++) {
+        hash ^= (unsigned char)view.data[i];
+        hash *= 16777619u;
+    }
+
+    unsigned int slot = hash & (intern_capacity - 1);
+    while (intern_slots[slot]) {
+        const char* stored = intern_slots[slot];
+        if (strncmp(stored, view.data, view.len) == 0 && stored[view.len] == '\0') return stored;
+        slot = (slot + 1) & (intern_capacity - 1);
+    }
+
+    char* copy = arenaAlloc(view.len + 1);
+    memcpy(copy, view.data, view.len);
+    copy[view.len] = '\0';
+    intern_slots[slot] = copy;
+    intern_count++;
+    return copy;
+}
+
+// Mapped files
+// The loaders used to fscanf every field into a char[MAX_STRING] on the
+// stack and copy it again into the arena or a record. They now map the
+// whole file, split lines and fields with memchr and parse numbers by
+// hand, so a field is a StringView into the mapping until something keeps
+// it: internView for the string tables, viewCopy for fixed-size fields.
+int mapFile(const char* path, MappedFile* file) {
+    memset(file, 0, sizeof(*file));
+#ifndef _WIN32
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return 0;
+    struct stat st;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+        void* data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data != MAP_FAILED) {
+            madvise(data, st.st_size, MADV_SEQUENTIAL);
+            file->data = data;
+            file->size = st.st_size;
+            file->mapped = 1;
+            close(fd);
+            return 1;
+        }
+    }
+    close(fd);
+#endif
+    // No mmap, or an empty file: read it the ordinary way
+    FILE* stream = fopen(path, "rb");
+    if (!stream) return 0;
+    fseek(stream, 0, SEEK_END);
+    long size = ftell(stream);
+    fseek(stream, 0, SEEK_SET);
+    char* data = size > 0 ? malloc(size) : NULL;
+    if (size > 0 && (!data || fread(data, 1, size, stream) != (size_t)size)) {
+        free(data);
+        fclose(stream);
+        return 0;
+    }
+    fclose(stream);
+    file->data = data;
+    file->size = size > 0 ? (size_t)size : 0;
+    return 1;
+}
+
+void unmapFile(MappedFile* file) {
+    if (file->mapped) {
+#ifndef _WIN32
+        munmap((void*)file->data, file->size);
+#endif
+    } else {
+        free((void*)file->data);
+    }
+    memset(file, 0, sizeof(*file));
+}
+
+// Next line before end, without its "\n" or "\r\n". Returns 0 at the end.
+int nextLine(const char** cursor, const char* end, StringView* line) {
+    const char* start = *cursor;
+    if (start >= end) return 0;
+    const char* newline = memchr(start, '\n', end - start);
+    const char* stop = newline ? newline : end;
+    *cursor = newline ? newline + 1 : end;
+    if (stop > start && stop[-1] == '\r') stop--;
+    line->data = start;
+    line->len = stop - start;
+    return 1;
+}
+
+// Splits the next field off line. The last field is the rest of the line.
+StringView nextField(StringView* line, char delimiter) {
+    StringView field = *line;
+    const char* stop = line->len ? memchr(line->data, delimiter, line->len) : NULL;
+    if (stop) {
+        field.len = stop - line->data;
+        line->data = stop + 1;
+        line->len -= field.len + 1;
+    } else {
+        line->data += line->len;
+        line->len = 0;
+    }
+    return field;
+}
+
+// Whole-field decimal integers; 0 if the field is empty or has anything
+// but an optional sign and digits
+int viewInt64(StringView view, int64_t* value) {
+    size_t i = 0;
+    int negative = view.len > 0 && view.data[0] == '-';
+    if (view.len > 0 && (view.data[0] == '-' || view.data[0] == '+')) i++;
+    if (i == view.len) return 0;
+
+    int64_t result = 0;
+    for (; i < view.len; i++) {
+        char c = view.data[i];
+        if (c < '0' || c > '9') return 0;
+        result = result * 10 + (c - '0');
+    }
+    *value = negative ? -result : result;
+    return 1;
+}
+
+int viewLong(StringView view, long* value) {
+    int64_t result;
+    if (!viewInt64(view, &result)) return 0;
+    *value = (long)result;
+    return 1;
+}
+
+int viewInt(StringView view, int* value) {
+    int64_t result;
+    if (!viewInt64(view, &result)) return 0;
+    *value = (int)result;
+    return 1;
+}
+
+// parseMoney for a view
+Money viewMoney(StringView view) {
+    const char* p = view.data;
+    const char* end = p + view.len;
+    while (p < end && (*p == ' ' || *p == '\t')) p++;
+    int negative = p < end && *p == '-';
+    if (p < end && (*p == '-' || *p == '+')) p++;
+
+    Money whole = 0;
+    for (; p < end && *p >= '0' && *p <= '9'; p++) whole = whole * 10 + (*p - '0');
+    Money fraction = 0;
+    if (p < end && *p == '.') {
+        p++;
+        for (int i = 0; i < 2; i++) {
+            fraction *= 10;
+            if (p < end && *p >= '0' && *p <= '9') fraction += *p++ - '0';
+        }
+        if (p < end && *p >= '5' && *p <= '9') fraction++;
+    }
+    Money amount = whole * 100 + fraction;
+    return negative ? -amount : amount;
+}
+
+// Copies view into a fixed-size field, truncating to fit
+void viewCopy(char* dest, size_t size, StringView view) {
+    size_t len = view.len < size ? view.len : size - 1;
+    memcpy(dest, view.data, len);
+    dest[len] = '\0';
+}
+
+void ensureProductCapacity(int needed) {
+    if (needed <= product_capacity) return;
+    int capacity = product_capacity ? product_capacity : 256;
+    while (capacity < needed) capacity *= 2;
+    products = realloc(products, capacity * sizeof(Product));
+    product_capacity = capacity;
+}
+
+void ensureCustomerCapacity(int needed) {
+    if (needed <= customer_capacity) return;
+    int capacity = customer_capacity ? customer_capacity : 256;
+    while (capacity < needed) capacity *= 2;
+    customers = realloc(customers, capacity * sizeof(Customer));
+    customer_capacity = capacity;
+}
+
+void ensureEmployeeCapacity(int needed) {
+    if (needed <= employee_capacity) return;
+    int capacity = employee_capacity ? employee_capacity : 16;
+    while (capacity < needed) capacity *= 2;
+    employees = realloc(employees, capacity * sizeof(Employee));
+    employee_capacity = capacity;
+}
+
 
 void initializeSystem() {
+    loadSystem();
+    resumeReceiptQueue();
+    loginScreen();
+}
+
+// Everything but the login; shared with the headless commands
+void loadSystem() {
+    // Locked so no other till's write lands between a snapshot and its
+    // journal
+    lockStore();
     loadProducts();
     loadCustomers();
-    loginScreen();
+    loadEmployees();
+    // Ctrl+C is how most sessions end, so route it through exit()
+    atexit(flushEmployeesAtExit);
+    installExitHandlers();
+    partitionSalesLog();
+    convertLegacySales();
+    loadAggregates();
+    store_loaded = 1;
+    unlockStore();
 }
 void loginScreen() {
     char username[MAX_STRING];
@@ -263,7 +1123,7 @@ void loginScreen() {
         printHeader("DIU SUPER SHOP - LOGIN");
         
         printf("\nUsername: ");
-        fgets(username, sizeof(username), stdin);
+        promptLine(username, sizeof(username));
         username[strcspn(username, "\n")] = 0; 
 
         printf("Password: ");
@@ -282,20 +1142,22 @@ void loginScreen() {
             newt = oldt;
             newt.c_lflag &= ~(ICANON | ECHO);
             tcsetattr(STDIN_FILENO, TCSANOW, &newt);
-            char ch;
+            int ch;
             int i = 0;
-            while ((ch = getchar()) != '\n' && i < MAX_STRING - 1) {
-                password[i++] = ch;
+            // Raw getchar, so that Ctrl+C puts the terminal back first
+            while ((ch = getchar()) != '\n' && ch != EOF && i < MAX_STRING - 1) {
+                password[i++] = (char)ch;
                 printf("*");
             }
             password[i] = '\0';
             tcsetattr(STDIN_FILENO, TCSANOW, &oldt);
+            checkExitRequest();
         #endif
         if (authenticateUser(username, password)) {
             GREEN_COLOR;
             printf("\nLogin successful! Welcome, %s\n", current_user.name);
             RESET_COLOR;
-            sleep(2);
+            pauseFor(2);
             mainMenu();
             return;
         } else {
@@ -303,7 +1165,7 @@ void loginScreen() {
             RED_COLOR;
             printf("\nInvalid username or password! Attempts remaining: %d\n", attempts);
             RESET_COLOR;
-            sleep(2);
+            pauseFor(2);
         }
     }
 
@@ -314,21 +1176,11 @@ void loginScreen() {
 }
 
 int authenticateUser(char* username, char* password) {
-    FILE* file = fopen("employees.txt", "r");
-    if (!file) return 0;
-
-    Employee emp;
-    while (fscanf(file, "%d,%[^,],%[^,],%[^,],%[^,],%f\n",
-           &emp.id, emp.name, emp.username, emp.password,
-           emp.role, &emp.total_sales) != EOF) {
-        if (strcmp(emp.username, username) == 0 &&
-            strcmp(emp.password, password) == 0) {
-            current_user = emp;
-            fclose(file);
-            return 1;
-        }
+    int i = findEmployeeByUsername(username);
+    if (i != -1 && strcmp(employees[i].password, password) == 0) {
+        current_user = employees[i];
+        return 1;
     }
-    fclose(file);
     return 0;
 }
 
@@ -345,38 +1197,33 @@ void registerEmployee() {
 
     printf("\nEnter employee details:\n");
     printf("ID: ");
-    scanf("%d", &new_emp.id);
-    getchar(); 
+    promptScanf("%d", &new_emp.id);
+    promptChar(); 
 
     printf("Name: ");
-    fgets(new_emp.name, MAX_STRING, stdin);
+    promptLine(new_emp.name, MAX_STRING);
     new_emp.name[strcspn(new_emp.name, "\n")] = 0;
 
     printf("Username: ");
-    scanf("%s", new_emp.username);
+    promptScanf("%s", new_emp.username);
 
     printf("Password: ");
-    scanf("%s", new_emp.password);
+    promptScanf("%s", new_emp.password);
 
     printf("Role (admin/employee): ");
-    scanf("%s", new_emp.role);
+    promptScanf("%s", new_emp.role);
 
-    new_emp.total_sales = 0.0;
+    new_emp.total_sales = 0;
+    new_emp.unsaved_sales = 0;
 
-    FILE* file = fopen("employees.txt", "a");
-    if (file) {
-        fprintf(file, "%d,%s,%s,%s,%s,%.2f\n",
-                new_emp.id, new_emp.name, new_emp.username,
-                new_emp.password, new_emp.role, new_emp.total_sales);
-        fclose(file);
-        GREEN_COLOR;
-        printf("\nEmployee registered successfully!\n");
-        RESET_COLOR;
-    } else {
-        RED_COLOR;
-        printf("\nError registering employee!\n");
-        RESET_COLOR;
-    }
+    ensureEmployeeCapacity(employee_count + 1);
+    employees[employee_count++] = new_emp;
+    rebuildEmployeeIndex();
+    saveEmployees();
+
+    GREEN_COLOR;
+    printf("\nEmployee registered successfully!\n");
+    RESET_COLOR;
 }
 
 void changePassword() {
@@ -386,7 +1233,7 @@ void changePassword() {
     printHeader("CHANGE PASSWORD");
 
     printf("\nEnter old password: ");
-    scanf("%s", old_password);
+    promptScanf("%s", old_password);
 
     if (strcmp(old_password, current_user.password) != 0) {
         RED_COLOR;
@@ -396,35 +1243,19 @@ void changePassword() {
     }
 
     printf("Enter new password: ");
-    scanf("%s", new_password);
+    promptScanf("%s", new_password);
 
-    FILE* file = fopen("employees.txt", "r");
-    FILE* temp = fopen("temp.txt", "w");
-
-    if (!file || !temp) {
+    int i = findEmployeeIndex(current_user.id);
+    if (i == -1) {
         RED_COLOR;
         printf("\nError changing password!\n");
         RESET_COLOR;
         return;
     }
 
-    Employee emp;
-    while (fscanf(file, "%d,%[^,],%[^,],%[^,],%[^,],%f\n",
-           &emp.id, emp.name, emp.username, emp.password,
-           emp.role, &emp.total_sales) != EOF) {
-        if (emp.id == current_user.id) {
-            strcpy(emp.password, new_password);
-            strcpy(current_user.password, new_password);
-        }
-        fprintf(temp, "%d,%s,%s,%s,%s,%.2f\n",
-                emp.id, emp.name, emp.username, emp.password,
-                emp.role, emp.total_sales);
-    }
-
-    fclose(file);
-    fclose(temp);
-    remove("employees.txt");
-    rename("temp.txt", "employees.txt");
+    strcpy(employees[i].password, new_password);
+    strcpy(current_user.password, new_password);
+    saveEmployees();
 
     GREEN_COLOR;
     printf("\nPassword changed successfully!\n");
@@ -446,7 +1277,7 @@ void mainMenu() {
         printf("\n7. Logout");
         printf("\n\nEnter your choice: ");
 
-        scanf("%d", &choice);
+        promptScanf("%d", &choice);
 
         switch (choice) {
             case 1: productMenu(); break;
@@ -456,17 +1287,18 @@ void mainMenu() {
             case 5: reportMenu(); break;
             case 6: settingsMenu(); break;
             case 7:
+                flushEmployees(1);
                 GREEN_COLOR;
                 printf("\nLogging out...\n");
                 RESET_COLOR;
-                sleep(1);
+                pauseFor(1);
                 loginScreen();
                 return;
             default:
                 RED_COLOR;
                 printf("\nInvalid choice! Please try again.\n");
                 RESET_COLOR;
-                sleep(1);
+                pauseFor(1);
         }
     }
 }
@@ -484,7 +1316,7 @@ void productMenu() {
         printf("\n6. Back to Main Menu");
         printf("\n\nEnter your choice: ");
 
-        scanf("%d", &choice);
+        promptScanf("%d", &choice);
 
         switch (choice) {
             case 1: addProduct(); break;
@@ -497,7 +1329,7 @@ void productMenu() {
                 RED_COLOR;
                 printf("\nInvalid choice! Please try again.\n");
                 RESET_COLOR;
-                sleep(1);
+                pauseFor(1);
         }
     }
 }
@@ -505,59 +1337,75 @@ void productMenu() {
 
 void addProduct() {
     Product new_product;
+    char name[MAX_STRING];
+    char category[MAX_STRING];
     printHeader("ADD NEW PRODUCT");
 
     printf("\nEnter product details:\n");
     printf("ID: ");
-    scanf("%d", &new_product.id);
-    getchar();
+    promptScanf("%d", &new_product.id);
+    promptChar();
 
-    for (int i = 0; i < product_count; i++) {
-        if (products[i].id == new_product.id) {
-            RED_COLOR;
-            printf("\nProduct ID already exists!\n");
-            RESET_COLOR;
-            sleep(2);
-            return;
-        }
+    if (findProductIndex(new_product.id) != -1) {
+        RED_COLOR;
+        printf("\nProduct ID already exists!\n");
+        RESET_COLOR;
+        pauseFor(2);
+        return;
     }
 
     printf("Name: ");
-    fgets(new_product.name, MAX_STRING, stdin);
-    new_product.name[strcspn(new_product.name, "\n")] = 0;
+    promptLine(name, MAX_STRING);
+    name[strcspn(name, "\n")] = 0;
+    new_product.name = internString(name);
 
     printf("Category: ");
-    fgets(new_product.category, MAX_STRING, stdin);
-    new_product.category[strcspn(new_product.category, "\n")] = 0;
+    promptLine(category, MAX_STRING);
+    category[strcspn(category, "\n")] = 0;
+    new_product.category = internString(category);
 
     printf("Quantity: ");
-    scanf("%d", &new_product.quantity);
+    promptScanf("%d", &new_product.quantity);
 
     printf("Purchase Price: ");
-    scanf("%f", &new_product.purchase_price);
+    scanMoney(&new_product.purchase_price);
 
     printf("Sale Price: ");
-    scanf("%f", &new_product.sale_price);
+    scanMoney(&new_product.sale_price);
 
-    strcpy(new_product.date_added, getCurrentDate());
+    new_product.date_added = internString(getCurrentDate());
 
+    // Another till may have taken the id in the meantime
+    lockStore();
+    if (findProductIndex(new_product.id) != -1) {
+        unlockStore();
+        RED_COLOR;
+        printf("\nProduct ID already exists!\n");
+        RESET_COLOR;
+        pauseFor(2);
+        return;
+    }
+    ensureProductCapacity(product_count + 1);
     products[product_count++] = new_product;
+    indexProduct(product_count - 1);
     saveProducts();
+    unlockStore();
 
     GREEN_COLOR;
     printf("\nProduct added successfully!\n");
     RESET_COLOR;
-    sleep(2);
+    pauseFor(2);
 }
 
 void viewProducts() {
+    refreshStore();
     printHeader("PRODUCT LIST");
 
     if (product_count == 0) {
         YELLOW_COLOR;
         printf("\nNo products available!\n");
         RESET_COLOR;
-        sleep(2);
+        pauseFor(2);
         return;
     }
 
@@ -565,18 +1413,18 @@ void viewProducts() {
     printLine();
 
     for (int i = 0; i < product_count; i++) {
-        printf("%d\t%-16s%-16s%-16d%.2f\t\t%.2f\n",
+        printf("%d\t%-16s%-16s%-16d%s\t\t%s\n",
                products[i].id,
                products[i].name,
                products[i].category,
                products[i].quantity,
-               products[i].purchase_price,
-               products[i].sale_price);
+               moneyStr(products[i].purchase_price),
+               moneyStr(products[i].sale_price));
     }
 
     printf("\nPress Enter to continue...");
-    getchar();
-    getchar();
+    promptChar();
+    promptChar();
 }
 
 void searchProduct() {
@@ -584,22 +1432,31 @@ void searchProduct() {
     char search_term[MAX_STRING];
     int found = 0;
 
+    refreshStore();
     printHeader("SEARCH PRODUCT");
     printf("\n1. Search by ID");
     printf("\n2. Search by Name");
     printf("\n3. Search by Category");
     printf("\nEnter your choice: ");
-    scanf("%d", &choice);
-    getchar();
+    promptScanf("%d", &choice);
+    promptChar();
 
     printf("Enter search term: ");
-    fgets(search_term, MAX_STRING, stdin);
+    promptLine(search_term, MAX_STRING);
     search_term[strcspn(search_term, "\n")] = 0;
 
     printf("\nSearch Results:\n");
     printLine();
 
-    for (int i = 0; i < product_count; i++) {
+    // An ID search has at most one hit, so go straight to it
+    int start = 0, end = product_count;
+    if (choice == 1) {
+        start = findProductIndex(atoi(search_term));
+        end = start + 1;
+        if (start == -1) start = end = 0;
+    }
+
+    for (int i = start; i < end; i++) {
         int match = 0;
         switch (choice) {
             case 1:
@@ -618,8 +1475,8 @@ void searchProduct() {
             printf("\nName: %s", products[i].name);
             printf("\nCategory: %s", products[i].category);
             printf("\nQuantity: %d", products[i].quantity);
-            printf("\nPurchase Price: %.2f", products[i].purchase_price);
-            printf("\nSale Price: %.2f", products[i].sale_price);
+            printf("\nPurchase Price: %s", moneyStr(products[i].purchase_price));
+            printf("\nSale Price: %s", moneyStr(products[i].sale_price));
             printf("\nDate Added: %s\n", products[i].date_added);
             printLine();
             found = 1;
@@ -633,7 +1490,7 @@ void searchProduct() {
     }
 
     printf("\nPress Enter to continue...");
-    getchar();
+    promptChar();
 }
 
 void editProduct() {
@@ -641,58 +1498,72 @@ void editProduct() {
     printHeader("EDIT PRODUCT");
 
     printf("\nEnter Product ID to edit: ");
-    scanf("%d", &id);
-
-    for (int i = 0; i < product_count; i++) {
-        if (products[i].id == id) {
-            printf("\nCurrent Details:");
-            printf("\nName: %s", products[i].name);
-            printf("\nCategory: %s", products[i].category);
-            printf("\nQuantity: %d", products[i].quantity);
-            printf("\nPurchase Price: %.2f", products[i].purchase_price);
-            printf("\nSale Price: %.2f", products[i].sale_price);
-
-            printf("\n\nEnter new details (press Enter to keep current value):\n");
-            char input[MAX_STRING];
-            getchar();
-
-            printf("Name: ");
-            fgets(input, MAX_STRING, stdin);
-            if (input[0] != '\n') {
-                input[strcspn(input, "\n")] = 0;
-                strcpy(products[i].name, input);
-            }
+    promptScanf("%d", &id);
+
+    int i = findProductIndex(id);
+    if (i != -1) {
+        printf("\nCurrent Details:");
+        printf("\nName: %s", products[i].name);
+        printf("\nCategory: %s", products[i].category);
+        printf("\nQuantity: %d", products[i].quantity);
+        printf("\nPurchase Price: %s", moneyStr(products[i].purchase_price));
+        printf("\nSale Price: %s", moneyStr(products[i].sale_price));
+
+        printf("\n\nEnter new details (press Enter to keep current value):\n");
+        char input[MAX_STRING];
+        Product edited = products[i];
+        int quantity_entered = 0;
+        promptChar();
+
+        printf("Name: ");
+        promptLine(input, MAX_STRING);
+        if (input[0] != '\n') {
+            input[strcspn(input, "\n")] = 0;
+            edited.name = internString(input);
+        }
 
-            printf("Category: ");
-            fgets(input, MAX_STRING, stdin);
-            if (input[0] != '\n') {
-                input[strcspn(input, "\n")] = 0;
-                strcpy(products[i].category, input);
-            }
+        printf("Category: ");
+        promptLine(input, MAX_STRING);
+        if (input[0] != '\n') {
+            input[strcspn(input, "\n")] = 0;
+            edited.category = internString(input);
+        }
 
-            printf("Quantity: ");
-            fgets(input, MAX_STRING, stdin);
-            if (input[0] != '\n') {
-                products[i].quantity = atoi(input);
-            }
+        printf("Quantity: ");
+        promptLine(input, MAX_STRING);
+        if (input[0] != '\n') {
+            edited.quantity = atoi(input);
+            quantity_entered = 1;
+        }
 
-            printf("Purchase Price: ");
-            fgets(input, MAX_STRING, stdin);
-            if (input[0] != '\n') {
-                products[i].purchase_price = atof(input);
-            }
+        printf("Purchase Price: ");
+        promptLine(input, MAX_STRING);
+        if (input[0] != '\n') {
+            edited.purchase_price = parseMoney(input);
+        }
 
-            printf("Sale Price: ");
-            fgets(input, MAX_STRING, stdin);
-            if (input[0] != '\n') {
-                products[i].sale_price = atof(input);
-            }
+        printf("Sale Price: ");
+        promptLine(input, MAX_STRING);
+        if (input[0] != '\n') {
+            edited.sale_price = parseMoney(input);
+        }
 
+        // Other tills may have sold some while this was typed; keep their
+        // count unless a new one was entered
+        lockStore();
+        i = findProductIndex(id);
+        if (i != -1) {
+            if (!quantity_entered) edited.quantity = products[i].quantity;
+            products[i] = edited;
             saveProducts();
+        }
+        unlockStore();
+
+        if (i != -1) {
             GREEN_COLOR;
             printf("\nProduct updated successfully!\n");
             RESET_COLOR;
-            sleep(2);
+            pauseFor(2);
             return;
         }
     }
@@ -700,7 +1571,7 @@ void editProduct() {
     RED_COLOR;
     printf("\nProduct not found!\n");
     RESET_COLOR;
-    sleep(2);
+    pauseFor(2);
 }
 
 void deleteProduct() {
@@ -708,83 +1579,397 @@ void deleteProduct() {
     printHeader("DELETE PRODUCT");
 
     printf("\nEnter Product ID to delete: ");
-    scanf("%d", &id);
+    promptScanf("%d", &id);
 
-    for (int i = 0; i < product_count; i++) {
-        if (products[i].id == id) {
-        
-            char confirm;
-            printf("\nAre you sure you want to delete %s? (y/n): ", products[i].name);
-            getchar();
-            scanf("%c", &confirm);
-
-            if (tolower(confirm) == 'y') {
+    int i = findProductIndex(id);
+    if (i != -1) {
+    
+        char confirm;
+        printf("\nAre you sure you want to delete %s? (y/n): ", products[i].name);
+        promptChar();
+        promptScanf("%c", &confirm);
+
+        if (tolower(confirm) == 'y') {
+            lockStore();
+            i = findProductIndex(id);
+            if (i != -1) {
                 // Shift remaining products
                 for (int j = i; j < product_count - 1; j++) {
                     products[j] = products[j + 1];
                 }
                 product_count--;
+                rebuildProductIndex();
                 saveProducts();
-
-                GREEN_COLOR;
-                printf("\nProduct deleted successfully!\n");
-                RESET_COLOR;
-            } else {
-                YELLOW_COLOR;
-                printf("\nDeletion cancelled!\n");
-                RESET_COLOR;
             }
-            sleep(2);
-            return;
+            unlockStore();
+
+            GREEN_COLOR;
+            printf("\nProduct deleted successfully!\n");
+            RESET_COLOR;
+        } else {
+            YELLOW_COLOR;
+            printf("\nDeletion cancelled!\n");
+            RESET_COLOR;
         }
+        pauseFor(2);
+        return;
     }
 
     RED_COLOR;
     printf("\nProduct not found!\n");
     RESET_COLOR;
-    sleep(2);
+    pauseFor(2);
 }
 
-void saveProducts() {
-    FILE* file = fopen("products.txt", "w");
-    if (!file) {
-        RED_COLOR;
-        printf("\nError saving products!\n");
-        RESET_COLOR;
-        return;
+// Shared store
+// Several tills can run against one directory. Every change to the shared
+// files happens under an exclusive lock on shop.lock (fcntl, or LockFileEx
+// on Windows), and taking the lock first catches up with what other tills
+// committed since this one last looked: journal tails are replayed, and a
+// snapshot another till rewrote is reloaded. Code that reads, decides and
+// writes (stock checks, restocks, edits) holds the lock across all three,
+// so no till works from stale counts. The lock nests; only the outermost
+// lockStore syncs and the outermost unlockStore releases.
+void lockStore() {
+    if (store_lock_depth++ > 0) return;
+
+    // Without a lock file this behaves as a single till, as before
+#ifdef _WIN32
+    if (store_lock_handle == INVALID_HANDLE_VALUE) {
+        store_lock_handle = CreateFile(STORE_LOCK_FILE, GENERIC_READ | GENERIC_WRITE,
+                                       FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_ALWAYS, 0, NULL);
     }
-
-    for (int i = 0; i < product_count; i++) {
-        fprintf(file, "%d,%s,%s,%d,%.2f,%.2f,%s\n",
-                products[i].id,
-                products[i].name,
-                products[i].category,
-                products[i].quantity,
-                products[i].purchase_price,
-                products[i].sale_price,
-                products[i].date_added);
+    if (store_lock_handle != INVALID_HANDLE_VALUE) {
+        OVERLAPPED overlapped = {0};
+        LockFileEx(store_lock_handle, LOCKFILE_EXCLUSIVE_LOCK, 0, 1, 0, &overlapped);
+    }
+#else
+    if (store_lock_fd == -1) {
+        store_lock_fd = open(STORE_LOCK_FILE, O_RDWR | O_CREAT, 0644);
+    }
+    if (store_lock_fd != -1) {
+        struct flock lock;
+        memset(&lock, 0, sizeof(lock));
+        lock.l_type = F_WRLCK;
+        lock.l_whence = SEEK_SET;
+        while (fcntl(store_lock_fd, F_SETLKW, &lock) == -1 && errno == EINTR) {
+        }
     }
+#endif
 
-    fclose(file);
+    if (store_loaded) syncStore();
 }
 
-void loadProducts() {
-    FILE* file = fopen("products.txt", "r");
-    if (!file) return;
-
-    product_count = 0;
-    while (fscanf(file, "%d,%[^,],%[^,],%d,%f,%f,%[^\n]\n",
-                  &products[product_count].id,
-                  products[product_count].name,
-                  products[product_count].category,
-                  &products[product_count].quantity,
-                  &products[product_count].purchase_price,
-                  &products[product_count].sale_price,
-                  products[product_count].date_added) != EOF) {
-        product_count++;
+void unlockStore() {
+    if (store_lock_depth == 0 || --store_lock_depth > 0) return;
+#ifdef _WIN32
+    if (store_lock_handle != INVALID_HANDLE_VALUE) {
+        OVERLAPPED overlapped = {0};
+        UnlockFileEx(store_lock_handle, 0, 1, 0, &overlapped);
     }
+#else
+    if (store_lock_fd != -1) {
+        struct flock lock;
+        memset(&lock, 0, sizeof(lock));
+        lock.l_type = F_UNLCK;
+        lock.l_whence = SEEK_SET;
+        fcntl(store_lock_fd, F_SETLK, &lock);
+    }
+#endif
+}
 
-    fclose(file);
+// Returns 0, with stamp zeroed, if path doesn't exist
+int stampFile(const char* path, FileStamp* stamp) {
+    struct stat st;
+    memset(stamp, 0, sizeof(*stamp));
+    if (stat(path, &st) != 0) return 0;
+#ifndef _WIN32
+    stamp->inode = (long long)st.st_ino;
+#endif
+    stamp->size = (long long)st.st_size;
+    stamp->mtime = (long long)st.st_mtime;
+    return 1;
+}
+
+int sameFile(const FileStamp* a, const FileStamp* b) {
+    return a->inode == b->inode && a->size == b->size && a->mtime == b->mtime;
+}
+
+void syncStore() {
+    syncProducts();
+    syncCustomers();
+    syncAggregates();
+}
+
+// Catches up with other tills before a screen or report that only reads
+void refreshStore() {
+    lockStore();
+    unlockStore();
+}
+
+// Appends the products.txt lines for one PRODUCT_SAVE_CHUNK of products
+// to chunks[part]
+void formatProductChunk(void* arg, int part) {
+    OutputBuffer* out = (OutputBuffer*)arg + part;
+    int end = (part + 1) * PRODUCT_SAVE_CHUNK;
+    if (end > product_count) end = product_count;
+    char purchase[MONEY_STR_SIZE], sale[MONEY_STR_SIZE];
+    for (int i = part * PRODUCT_SAVE_CHUNK; i < end; i++) {
+        outPrintf(out, "%d,%s,%s,%d,%s,%s,%s\n",
+                  products[i].id,
+                  products[i].name,
+                  products[i].category,
+                  products[i].quantity,
+                  formatMoney(purchase, products[i].purchase_price),
+                  formatMoney(sale, products[i].sale_price),
+                  products[i].date_added);
+    }
+}
+
+void saveProducts() {
+    // Written to a temp file and renamed so a crash never leaves a
+    // half-written snapshot next to a journal that has been cleared
+    lockStore();
+    FILE* file = fopen("products.txt.tmp", "w");
+    if (!file) {
+        RED_COLOR;
+        printf("\nError saving products!\n");
+        RESET_COLOR;
+        unlockStore();
+        return;
+    }
+
+    // Large catalogs are formatted in parallel, a chunk per job
+    int chunk_count = (product_count + PRODUCT_SAVE_CHUNK - 1) / PRODUCT_SAVE_CHUNK;
+    OutputBuffer* chunks = calloc(chunk_count ? chunk_count : 1, sizeof(OutputBuffer));
+    runJobs(JOB_PRIORITY_STORE, formatProductChunk, chunks, chunk_count);
+    int written = 1;
+    for (int i = 0; i < chunk_count; i++) {
+        if (fwrite(chunks[i].data, 1, chunks[i].size, file) != chunks[i].size) written = 0;
+        free(chunks[i].data);
+    }
+    free(chunks);
+
+    if (fclose(file) != 0 || !written) {
+        RED_COLOR;
+        printf("\nError saving products!\n");
+        RESET_COLOR;
+        remove("products.txt.tmp");
+        unlockStore();
+        return;
+    }
+#ifdef _WIN32
+    remove("products.txt");
+#endif
+    rename("products.txt.tmp", "products.txt");
+
+    // The snapshot now holds every journaled change
+    remove(PRODUCT_JOURNAL_FILE);
+    product_journal_entries = 0;
+    stampFile("products.txt", &product_sync.snapshot);
+    memset(&product_sync.journal, 0, sizeof(product_sync.journal));
+    unlockStore();
+}
+
+void loadProducts() {
+    MappedFile file;
+    stampFile("products.txt", &product_sync.snapshot);
+    if (!mapFile("products.txt", &file)) return;
+
+    product_count = 0;
+    const char* cursor = file.data;
+    StringView line;
+    while (nextLine(&cursor, file.data + file.size, &line)) {
+        // id,name,category,quantity,purchase_price,sale_price,date_added
+        Product product;
+        if (!viewInt(nextField(&line, ','), &product.id)) continue;
+        StringView name = nextField(&line, ',');
+        StringView category = nextField(&line, ',');
+        if (!viewInt(nextField(&line, ','), &product.quantity)) continue;
+        product.purchase_price = viewMoney(nextField(&line, ','));
+        product.sale_price = viewMoney(nextField(&line, ','));
+        product.name = internView(name);
+        product.category = internView(category);
+        product.date_added = internView(line);
+        ensureProductCapacity(product_count + 1);
+        products[product_count++] = product;
+    }
+
+    unmapFile(&file);
+    rebuildProductIndex();
+    replayProductJournal(0);
+}
+
+// Cuts an open file down to size bytes; 0 on failure
+int truncateStream(FILE* file, long size) {
+    fflush(file);
+#ifdef _WIN32
+    int cut = _chsize(_fileno(file), size);
+#else
+    int cut = ftruncate(fileno(file), size);
+#endif
+    fseek(file, 0, SEEK_END);
+    return cut == 0;
+}
+
+// Opens a line journal for appending, with the store locked. A crash
+// mid-write can leave a last line without its newline; it is cut off so
+// that the next line is not glued onto it.
+FILE* openJournal(const char* path) {
+    FILE* file = fopen(path, "a+");
+    if (!file) return NULL;
+    if (fseek(file, -1, SEEK_END) == 0 && fgetc(file) != '\n') {
+        MappedFile data;
+        if (mapFile(path, &data)) {
+            long keep = (long)data.size;
+            while (keep > 0 && data.data[keep - 1] != '\n') keep--;
+            unmapFile(&data);
+            truncateStream(file, keep);
+        } else {
+            // Can't find the last whole line; end the torn one instead
+            fseek(file, 0, SEEK_END);
+            fputc('\n', file);
+        }
+    }
+    fseek(file, 0, SEEK_END);
+    return file;
+}
+
+// Stock journal
+// Checkout and restock only change quantities, so rather than rewriting
+// products.txt they append "id,delta,quantity,timestamp" lines to
+// products.journal and loadProducts replays them over the snapshot.
+// Replay assigns the recorded quantity instead of re-adding the delta, so
+// applying an entry that the snapshot already contains is harmless.
+// saveProducts writes a new snapshot and clears the journal; closing the
+// journal triggers that once it holds PRODUCT_JOURNAL_COMPACT_AT entries.
+// The store is locked from open to close.
+FILE* openProductJournal() {
+    lockStore();
+    FILE* journal = openJournal(PRODUCT_JOURNAL_FILE);
+    if (!journal) unlockStore();
+    return journal;
+}
+
+void journalStockChange(FILE* journal, int index, int delta) {
+    fprintf(journal, "%d,%d,%d,%ld\n",
+            products[index].id,
+            delta,
+            products[index].quantity,
+            (long)time(NULL));
+    product_journal_entries++;
+}
+
+int closeProductJournal(FILE* journal) {
+    int ok = fclose(journal) == 0;
+    // Everything in the journal has now been read or written by this till
+    stampFile(PRODUCT_JOURNAL_FILE, &product_sync.journal);
+    if (product_journal_entries >= PRODUCT_JOURNAL_COMPACT_AT) {
+        saveProducts();
+    }
+    unlockStore();
+    return ok;
+}
+
+// Applies the journal from byte offset on: all of it after loading the
+// snapshot, or just what other tills appended since the last sync
+void replayProductJournal(long offset) {
+    if (offset == 0) product_journal_entries = 0;
+
+    MappedFile file;
+    FileStamp stamp;
+    stampFile(PRODUCT_JOURNAL_FILE, &stamp);
+    if (!mapFile(PRODUCT_JOURNAL_FILE, &file)) {
+        product_sync.journal = stamp;
+        return;
+    }
+
+    const char* cursor = file.data + (offset < (long)file.size ? offset : (long)file.size);
+    StringView line;
+    while (nextLine(&cursor, file.data + file.size, &line)) {
+        int id, delta, quantity;
+        long timestamp;
+        if (line.len == 0) continue;
+        if (!viewInt(nextField(&line, ','), &id) || !viewInt(nextField(&line, ','), &delta) ||
+            !viewInt(nextField(&line, ','), &quantity) || !viewLong(line, &timestamp)) {
+            continue;  // Damaged line; the ones after it still count
+        }
+        // Entries for products deleted since are skipped
+        int i = findProductIndex(id);
+        if (i != -1) {
+            products[i].quantity = quantity;
+        }
+        product_journal_entries++;
+    }
+
+    product_sync.journal = stamp;
+    product_sync.journal.size = (long long)file.size;
+    unmapFile(&file);
+}
+
+// Catches up with other tills' stock changes
+void syncProducts() {
+    FileStamp snapshot, journal;
+    stampFile("products.txt", &snapshot);
+    stampFile(PRODUCT_JOURNAL_FILE, &journal);
+    if (!sameFile(&snapshot, &product_sync.snapshot) || journal.inode != product_sync.journal.inode ||
+        journal.size < product_sync.journal.size) {
+        // Rewritten or compacted; start over from the new snapshot
+        loadProducts();
+    } else if (journal.size > product_sync.journal.size) {
+        replayProductJournal((long)product_sync.journal.size);
+    }
+}
+
+unsigned int hashProductId(int id) {
+    return (unsigned int)id * 2654435761u;
+}
+
+void rebuildProductIndex() {
+    // Keep the table at most half full
+    int capacity = 64;
+    while (capacity < product_count * 2) capacity *= 2;
+
+    if (capacity != product_slot_capacity) {
+        free(product_slots);
+        product_slots = malloc(capacity * sizeof(int));
+        product_slot_capacity = capacity;
+    }
+    memset(product_slots, 0, capacity * sizeof(int));
+
+    for (int i = 0; i < product_count; i++) {
+        unsigned int slot = hashProductId(products[i].id) & (capacity - 1);
+        while (product_slots[slot] != 0) {
+            slot = (slot + 1) & (capacity - 1);
+        }
+        product_slots[slot] = i + 1;
+    }
+}
+
+// Adds products[index] to the map, growing it when it gets half full
+void indexProduct(int index) {
+    if (product_count * 2 > product_slot_capacity) {
+        rebuildProductIndex();
+        return;
+    }
+
+    unsigned int slot = hashProductId(products[index].id) & (product_slot_capacity - 1);
+    while (product_slots[slot] != 0) {
+        slot = (slot + 1) & (product_slot_capacity - 1);
+    }
+    product_slots[slot] = index + 1;
+}
+
+int findProductIndex(int id) {
+    if (product_slot_capacity == 0) return -1;
+
+    unsigned int slot = hashProductId(id) & (product_slot_capacity - 1);
+    while (product_slots[slot] != 0) {
+        int index = product_slots[slot] - 1;
+        if (products[index].id == id) return index;
+        slot = (slot + 1) & (product_slot_capacity - 1);
+    }
+    return -1;
 }
 
 // Inventory Management Functions
@@ -799,7 +1984,7 @@ void inventoryMenu() {
         printf("\n4. Back to Main Menu");
         printf("\n\nEnter your choice: ");
 
-        scanf("%d", &choice);
+        promptScanf("%d", &choice);
 
         switch (choice) {
             case 1: restockInventory(); break;
@@ -810,7 +1995,7 @@ void inventoryMenu() {
                 RED_COLOR;
                 printf("\nInvalid choice! Please try again.\n");
                 RESET_COLOR;
-                sleep(1);
+                pauseFor(1);
         }
     }
 }
@@ -820,42 +2005,62 @@ void restockInventory() {
     printHeader("RESTOCK INVENTORY");
 
     printf("\nEnter Product ID: ");
-    scanf("%d", &id);
-
-    for (int i = 0; i < product_count; i++) {
-        if (products[i].id == id) {
-            printf("\nCurrent stock for %s: %d", products[i].name, products[i].quantity);
-            printf("\nEnter quantity to add: ");
-            scanf("%d", &quantity);
+    promptScanf("%d", &id);
 
-            if (quantity < 0) {
-                RED_COLOR;
-                printf("\nInvalid quantity!\n");
-                RESET_COLOR;
-                sleep(2);
-                return;
-            }
+    int i = findProductIndex(id);
+    if (i != -1) {
+        printf("\nCurrent stock for %s: %d", products[i].name, products[i].quantity);
+        printf("\nEnter quantity to add: ");
+        promptScanf("%d", &quantity);
 
-            products[i].quantity += quantity;
-            saveProducts();
+        if (quantity < 0) {
+            RED_COLOR;
+            printf("\nInvalid quantity!\n");
+            RESET_COLOR;
+            pauseFor(2);
+            return;
+        }
 
-            GREEN_COLOR;
-            printf("\nInventory updated successfully!");
-            printf("\nNew stock level: %d\n", products[i].quantity);
+        // Opening the journal locks the store and catches up first, so
+        // the addition lands on the current count
+        FILE* journal = openProductJournal();
+        if (!journal) {
+            RED_COLOR;
+            printf("\nError saving products!\n");
+            RESET_COLOR;
+            pauseFor(2);
+            return;
+        }
+        i = findProductIndex(id);
+        if (i == -1) {
+            closeProductJournal(journal);
+            RED_COLOR;
+            printf("\nProduct not found!\n");
             RESET_COLOR;
-            sleep(2);
+            pauseFor(2);
             return;
         }
+        products[i].quantity += quantity;
+        journalStockChange(journal, i, quantity);
+        closeProductJournal(journal);
+
+        GREEN_COLOR;
+        printf("\nInventory updated successfully!");
+        printf("\nNew stock level: %d\n", products[i].quantity);
+        RESET_COLOR;
+        pauseFor(2);
+        return;
     }
 
     RED_COLOR;
     printf("\nProduct not found!\n");
     RESET_COLOR;
-    sleep(2);
+    pauseFor(2);
 }
 
 void checkLowStock() {
     int found = 0;
+    refreshStore();
     printHeader("LOW STOCK ITEMS");
 
     printf("\nProducts with stock below %d:\n", LOW_STOCK_THRESHOLD);
@@ -878,54 +2083,56 @@ void checkLowStock() {
     }
 
     printf("\nPress Enter to continue...");
-    getchar();
-    getchar();
+    promptChar();
+    promptChar();
 }
 
 void generateStockReport() {
-    float total_value = 0;
+    Money total_value = 0;
     int total_items = 0;
 
+    refreshStore();
     printHeader("STOCK REPORT");
     printf("\nCurrent Inventory Status:\n");
     printLine();
 
     printf("\nCategory-wise Summary:\n");
-    // Create a temporary array to store unique categories
-    char categories[MAX_PRODUCTS][MAX_STRING];
+    // Create a temporary array to store unique categories. Categories are
+    // interned, so equal names share one pointer.
+    const char** categories = malloc((product_count + 1) * sizeof(const char*));
     int category_count = 0;
 
     // Collect unique categories
     for (int i =0; i < product_count; i++) {
         int found = 0;
         for (int j = 0; j < category_count; j++) {
-            if (strcmp(categories[j], products[i].category) == 0) {
+            if (categories[j] == products[i].category) {
                 found = 1;
                 break;
             }
         }
         if (!found) {
-            strcpy(categories[category_count++], products[i].category);
+            categories[category_count++] = products[i].category;
         }
     }
 
     // Print category-wise summary
     for (int i =0; i < category_count; i++) {
         int cat_items = 0;
-        float cat_value = 0;
+        Money cat_value = 0;
 
         printf("\nCategory: %s", categories[i]);
         printf("\n-----------------");
 
         for (int j =0; j < product_count; j++) {
-            if (strcmp(products[j].category, categories[i]) == 0) {
+            if (products[j].category == categories[i]) {
                 cat_items += products[j].quantity;
                 cat_value += products[j].quantity * products[j].purchase_price;
 
-                printf("\n%s: %d units (Value: %.2f)",
+                printf("\n%s: %d units (Value: %s)",
                        products[j].name,
                        products[j].quantity,
-                       products[j].quantity * products[j].purchase_price);
+                       moneyStr(products[j].quantity * products[j].purchase_price));
 
                 if (products[j].quantity < LOW_STOCK_THRESHOLD) {
                     RED_COLOR;
@@ -939,18 +2146,19 @@ void generateStockReport() {
         total_value += cat_value;
 
         printf("\nTotal Items in Category: %d", cat_items);
-        printf("\nTotal Value in Category: %.2f\n", cat_value);
+        printf("\nTotal Value in Category: %s\n", moneyStr(cat_value));
     }
+    free(categories);
 
     printLine();
     printf("\nOverall Summary:");
     printf("\nTotal Number of Products: %d", product_count);
     printf("\nTotal Items in Stock: %d", total_items);
-    printf("\nTotal Inventory Value: %.2f\n", total_value);
+    printf("\nTotal Inventory Value: %s\n", moneyStr(total_value));
 
     printf("\nPress Enter to continue...");
-    getchar();
-    getchar();
+    promptChar();
+    promptChar();
 }
 
 // Sales Management Functions
@@ -965,7 +2173,7 @@ void salesMenu() {
         printf("\n4. Back to Main Menu");
         printf("\n\nEnter your choice: ");
 
-        scanf("%d", &choice);
+        promptScanf("%d", &choice);
 
         switch (choice) {
             case 1: createNewSale(); break;
@@ -976,7 +2184,7 @@ void salesMenu() {
                 RED_COLOR;
                 printf("\nInvalid choice! Please try again.\n");
                 RESET_COLOR;
-                sleep(1);
+                pauseFor(1);
         }
     }
 }
@@ -987,8 +2195,8 @@ void createNewSale() {
     if (cart_count > 0) {
         char choice;
         printf("\nThere are items in the cart. Clear cart? (y/n): ");
-        getchar();
-        scanf("%c", &choice);
+        promptChar();
+        promptScanf("%c", &choice);
 
         if (tolower(choice) == 'y') {
             clearCart();
@@ -1003,7 +2211,7 @@ void createNewSale() {
         printf("\nEnter choice: ");
 
         int choice;
-        scanf("%d", &choice);
+        promptScanf("%d", &choice);
 
         switch (choice) {
             case 1: addToCart(); break;
@@ -1016,7 +2224,7 @@ void createNewSale() {
                     YELLOW_COLOR;
                     printf("\nCart is empty!\n");
                     RESET_COLOR;
-                    sleep(1);
+                    pauseFor(1);
                 }
                 break;
             case 4:
@@ -1026,7 +2234,7 @@ void createNewSale() {
                 RED_COLOR;
                 printf("\nInvalid choice!\n");
                 RESET_COLOR;
-                sleep(1);
+                pauseFor(1);
         }
     }
 }
@@ -1035,35 +2243,29 @@ void addToCart() {
     int id, quantity;
 
     printf("\nEnter Product ID: ");
-    scanf("%d", &id);
+    promptScanf("%d", &id);
 
     // Find product
-    int product_index = -1;
-    for (int i = 0; i < product_count; i++) {
-        if (products[i].id == id) {
-            product_index = i;
-            break;
-        }
-    }
+    int product_index = findProductIndex(id);
 
     if (product_index == -1) {
         RED_COLOR;
         printf("\nProduct not found!\n");
         RESET_COLOR;
-        sleep(1);
+        pauseFor(1);
         return;
     }
-    printf("\nProduct Name: %s || Price : %.2f TK || ", products[product_index].name,products[product_index].sale_price);
+    printf("\nProduct Name: %s || Price : %s TK || ", products[product_index].name,moneyStr(products[product_index].sale_price));
     printf("Available Stock: %d\n", products[product_index].quantity);
 
     printf("Enter quantity: ");
-    scanf("%d", &quantity);
+    promptScanf("%d", &quantity);
 
     if (quantity <= 0) {
         RED_COLOR;
         printf("\nInvalid quantity!\n");
         RESET_COLOR;
-        sleep(1);
+        pauseFor(1);
         return;
     }
 
@@ -1071,7 +2273,7 @@ void addToCart() {
         RED_COLOR;
         printf("\nInsufficient stock! Available: %d\n", products[product_index].quantity);
         RESET_COLOR;
-        sleep(1);
+        pauseFor(1);
         return;
     }
 
@@ -1082,7 +2284,7 @@ void addToCart() {
             GREEN_COLOR;
             printf("\nCart updated successfully!\n");
             RESET_COLOR;
-            sleep(1);
+            pauseFor(1);
             return;
         }
     }
@@ -1092,7 +2294,7 @@ void addToCart() {
         RED_COLOR;
         printf("\nCart is full!\n");
         RESET_COLOR;
-        sleep(1);
+        pauseFor(1);
         return;
     }
 
@@ -1104,7 +2306,7 @@ void addToCart() {
     GREEN_COLOR;
     printf("\nItem added to cart successfully!\n");
     RESET_COLOR;
-    sleep(1);
+    pauseFor(1);
 }
 
 void viewCart() {
@@ -1115,37 +2317,35 @@ void viewCart() {
         printf("\nCart is empty!\n");
         RESET_COLOR;
         printf("\nPress Enter to continue...");
-        getchar();
-        getchar();
+        promptChar();
+        promptChar();
         return;
     }
 
-    float total = 0;
+    Money total = 0;
     printf("\nID\tProduct\t\tQuantity\tPrice\tSubtotal\n");
     printLine();
 
     for (int i = 0; i < cart_count; i++) {
-        for (int j = 0; j < product_count; j++) {
-            if (products[j].id == current_cart[i].product_id) {
-                float subtotal = current_cart[i].quantity * current_cart[i].price;
-                printf("%d\t%-16s%-16d%.2f\t%.2f\n",
-                       products[j].id,
-                       products[j].name,
-                       current_cart[i].quantity,
-                       current_cart[i].price,
-                       subtotal);
-                total += subtotal;
-                break;
-            }
+        int j = findProductIndex(current_cart[i].product_id);
+        if (j != -1) {
+            Money subtotal = current_cart[i].quantity * current_cart[i].price;
+            printf("%d\t%-16s%-16d%s\t%s\n",
+                   products[j].id,
+                   products[j].name,
+                   current_cart[i].quantity,
+                   moneyStr(current_cart[i].price),
+                   moneyStr(subtotal));
+            total += subtotal;
         }
     }
 
     printLine();
-    printf("Total Amount: %.2f TK \n", total);
+    printf("Total Amount: %s TK \n", moneyStr(total));
 
     printf("\nPress Enter to continue...");
-    getchar();
-    getchar();
+    promptChar();
+    promptChar();
 }
 
 void clearCart() {
@@ -1153,47 +2353,60 @@ void clearCart() {
     YELLOW_COLOR;
     printf("\nCart cleared!\n");
     RESET_COLOR;
-    sleep(1);
+    pauseFor(1);
+}
+
+// Index of a product the order needs more of than is in stock, counting
+// repeated lines together, or -1
+int findShortStock(const Order* order) {
+    for (int k = 0; k < order->item_count; k++) {
+        int needed = 0;
+        for (int j = 0; j < order->item_count; j++) {
+            if (order->items[j].product_id == order->items[k].product_id) {
+                needed += order->items[j].quantity;
+            }
+        }
+        int p = findProductIndex(order->items[k].product_id);
+        if (p != -1 && needed > products[p].quantity) return p;
+    }
+    return -1;
 }
 
 void updateInventory(Order order) {
+    // Only the changed quantities are journaled; see replayProductJournal
+    FILE* journal = openProductJournal();
+    if (!journal) {
+        RED_COLOR;
+        printf("\nError updating inventory!\n");
+        RESET_COLOR;
+        return;
+    }
+
     // Update product quantities
     for (int i = 0; i < order.item_count; i++) {
         CartItem item = order.items[i];
-        for (int j = 0; j < product_count; j++) {
-            if (products[j].id == item.product_id) {
-                products[j].quantity -= item.quantity;
+        int j = findProductIndex(item.product_id);
+        if (j != -1) {
+            products[j].quantity -= item.quantity;
+            journalStockChange(journal, j, -item.quantity);
+            if (!headless) {
                 printf("\nUpdated stock for %s: %d", products[j].name, products[j].quantity);
-                break;
             }
         }
     }
 
-
-    FILE* file = fopen("products.txt", "w");
-    if (!file) {
+    if (!closeProductJournal(journal)) {
         RED_COLOR;
         printf("\nError updating inventory!\n");
         RESET_COLOR;
         return;
     }
     
-    for (int i = 0; i < product_count; i++) {
-        fprintf(file, "%d,%s,%s,%d,%.2f,%.2f,%s\n",
-                products[i].id,
-                products[i].name,
-                products[i].category,
-                products[i].quantity,
-                products[i].purchase_price,
-                products[i].sale_price,
-                products[i].date_added);
+    if (!headless) {
+        GREEN_COLOR;
+        printf("\nInventory updated successfully!\n");
+        RESET_COLOR;
     }
-    
-    fclose(file);
-    
-    GREEN_COLOR;
-    printf("\nInventory updated successfully!\n");
-    RESET_COLOR;
 }
 
  
@@ -1203,9 +2416,10 @@ void checkout() {
     Order order;
     char confirm;
     
+    // processPayment only sets the discount fields it uses
+    memset(&order, 0, sizeof(order));
     time_t t = time(NULL);
     struct tm* tm = localtime(&t);
-    order.id = (long)t; 
     strftime(order.date, sizeof(order.date), "%Y-%m-%d %I:%M:%S %p", tm);
     
     // Set employee ID from current user
@@ -1218,7 +2432,7 @@ void checkout() {
     }
     
     printf("\nEnter Customer Phone Number ");
-    scanf("%s", phone);
+    promptScanf("%s", phone);
     if (strlen(phone) == 0) {
         strcpy(order.customer_phone, "GUEST");
     } else {
@@ -1226,39 +2440,42 @@ void checkout() {
     }
     
     int found = 0;
-    for (int i = 0; i < customer_count; i++) {
-        if (strcmp(customers[i].phone, phone) == 0) {
-            found = 1;
-            printf("\nCustomer Found!");
-            printf("\nName: %s", customers[i].name);
-            printf("\nTotal Previous Purchases: %.2f", customers[i].total_spending);
-            if (customers[i].total_spending >= LOYALTY_THRESHOLD) {
-                printf("\nLoyalty Customer - Eligible for 10%% discount!\n");
-            }
-            break;
+    int i = findCustomerIndex(phone);
+    if (i != -1) {
+        found = 1;
+        printf("\nCustomer Found!");
+        printf("\nName: %s", customers[i].name);
+        printf("\nTotal Previous Purchases: %s", moneyStr(customers[i].total_spending));
+        if (customers[i].total_spending >= TAKA(LOYALTY_THRESHOLD)) {
+            printf("\nLoyalty Customer - Eligible for 10%% discount!\n");
         }
     }
     
     if (!found) {
         printf("\nCustomer not found! Create new account:");
         Customer newCustomer;
-        strcpy(newCustomer.phone, phone);
+        char name[MAX_STRING], address[MAX_STRING];
+        newCustomer.phone = internString(phone);
         
         printf("\nEnter Customer Name: ");
-        scanf(" %[^\n]s", newCustomer.name);
+        promptScanf(" %[^\n]s", name);
+        newCustomer.name = internString(name);
         
         printf("Enter Customer Address: ");
-        scanf(" %[^\n]s", newCustomer.address);
+        promptScanf(" %[^\n]s", address);
+        newCustomer.address = internString(address);
         
         newCustomer.total_spending = 0;
         newCustomer.loyalty_points = 0;
         newCustomer.last_loyalty_milestone = 0;
+        newCustomer.dirty = 0;
         
+        i = customer_count;
+        ensureCustomerCapacity(customer_count + 1);
         customers[customer_count] = newCustomer;
         customer_count++;
-        
-        // Save updated customer list
-        saveCustomers();
+        indexCustomer(i);
+        markCustomerDirty(i);
         
         GREEN_COLOR;
         printf("\nNew customer account created successfully!\n");
@@ -1266,24 +2483,51 @@ void checkout() {
     }
     
     printf("\nProceed with checkout? (y/n): ");
-    scanf(" %c", &confirm);
+    promptScanf(" %c", &confirm);
     if (tolower(confirm) == 'y') {
-        processPayment(&order);
-        updateInventory(order);  
-        saveTransactionToFile(order);
+        int milestone = processPayment(&order);
+
+        // Other tills sell from the same stock; check it again under the
+        // lock, which also brings products[] and customers[] up to date
+        lockStore();
+        int short_index = findShortStock(&order);
+        if (short_index != -1) {
+            unlockStore();
+            RED_COLOR;
+            printf("\nInsufficient stock for %s! Only %d left.\n",
+                   products[short_index].name, products[short_index].quantity);
+            RESET_COLOR;
+            flushCustomers();
+            pauseFor(2);
+            return;
+        }
+        order.id = nextOrderId();
+
+        // The sale is only made once its record is written
+        if (!saveTransactionToFile(order)) {
+            flushCustomers();
+            unlockStore();
+            pauseFor(2);
+            return;
+        }
+        updateInventory(order);
 
         updateEmployeeTotalSales(order.employee_id, order.total_amount - order.discount);
 
         generateReceipt(order);
         
-        // Update customer's total spending
-        for (int i = 0; i < customer_count; i++) {
-            if (strcmp(customers[i].phone, phone) == 0) {
-                customers[i].total_spending += order.total_amount;
-                break;
+        // Update customer's total spending; the loyalty milestone is only
+        // used up by a sale that went through
+        i = findCustomerIndex(phone);
+        if (i != -1) {
+            customers[i].total_spending += order.total_amount;
+            if (customers[i].last_loyalty_milestone < milestone) {
+                customers[i].last_loyalty_milestone = milestone;
             }
+            markCustomerDirty(i);
         }
-        saveCustomers();
+        flushCustomers();
+        unlockStore();
         
         clearCart();
         
@@ -1291,13 +2535,40 @@ void checkout() {
         printf("\nCheckout completed successfully!\n");
         printf("Order ID: %ld\n", order.id);
         RESET_COLOR;
-        sleep(2);
+        pauseFor(2);
+    }
+
+    // One write for every customer change made during this checkout
+    flushCustomers();
+}
+
+// Highest spending milestone the customer has reached but not yet been
+// rewarded for, or 0
+int eligibleLoyaltyMilestone(const Customer* customer) {
+    Money current_total = customer->total_spending;
+    
+    if (current_total >= TAKA(LOYALTY_MILESTONE_3) && 
+        customer->last_loyalty_milestone < LOYALTY_MILESTONE_3) {
+        return LOYALTY_MILESTONE_3;
     }
+    if (current_total >= TAKA(LOYALTY_MILESTONE_2) && 
+        customer->last_loyalty_milestone < LOYALTY_MILESTONE_2) {
+        return LOYALTY_MILESTONE_2;
+    }
+    if (current_total >= TAKA(LOYALTY_MILESTONE_1) && 
+        customer->last_loyalty_milestone < LOYALTY_MILESTONE_1) {
+        return LOYALTY_MILESTONE_1;
+    }
+    return 0;
 }
 
-void processPayment(Order* order) {
+// Prices the order and takes payment details. Returns the loyalty
+// milestone whose discount was given, or 0; checkout records it once the
+// sale has gone through.
+int processPayment(Order* order) {
     int choice;
-    float total = 0;
+    int milestone = 0;
+    Money total = 0;
     
     // Calculate total from cart
     for (int i = 0; i < cart_count; i++) {
@@ -1307,53 +2578,36 @@ void processPayment(Order* order) {
     order->discount = 0;
     
     printf("\n=== PAYMENT PROCESSING ===\n");
-    printf("\nCurrent Total: %.2f", total);
+    printf("\nCurrent Total: %s", moneyStr(total));
     
     // Check for Loyalty Milestone Discount
-    for (int i = 0; i < customer_count; i++) {
-        if (strcmp(customers[i].phone, order->customer_phone) == 0) {
-            float current_total = customers[i].total_spending;
-            int eligible_milestone = 0;
-            
-            if (current_total >= LOYALTY_MILESTONE_3 && 
-                customers[i].last_loyalty_milestone < LOYALTY_MILESTONE_3) {
-                eligible_milestone = LOYALTY_MILESTONE_3;
-            }
-            else if (current_total >= LOYALTY_MILESTONE_2 && 
-                     customers[i].last_loyalty_milestone < LOYALTY_MILESTONE_2) {
-                eligible_milestone = LOYALTY_MILESTONE_2;
-            }
-            else if (current_total >= LOYALTY_MILESTONE_1 && 
-                     customers[i].last_loyalty_milestone < LOYALTY_MILESTONE_1) {
-                eligible_milestone = LOYALTY_MILESTONE_1;
-            }
+    int i = findCustomerIndex(order->customer_phone);
+    if (i != -1) {
+        int eligible_milestone = eligibleLoyaltyMilestone(&customers[i]);
+        
+        // Apply loyalty discount if eligible
+        if (eligible_milestone > 0) {
+            Money loyalty_discount = percentOf(total, 10);  // 10% loyalty discount
+            order->discount += loyalty_discount;
+            milestone = eligible_milestone;
             
-            // Apply loyalty discount if eligible
-            if (eligible_milestone > 0) {
-                float loyalty_discount = total * 0.10;  // 10% loyalty discount
-                order->discount += loyalty_discount;
-                customers[i].last_loyalty_milestone = eligible_milestone;
-                saveCustomers();  // Save the updated milestone
-                
-                GREEN_COLOR;
-                printf("\nCongratulations! Loyalty Milestone of %.2f reached!", 
-                       (float)eligible_milestone);
-                printf("\nOne-time Loyalty Discount (10%%): %.2f", loyalty_discount);
-                RESET_COLOR;
-            }
-            break;
+            GREEN_COLOR;
+            printf("\nCongratulations! Loyalty Milestone of %s reached!", 
+                   moneyStr(TAKA(eligible_milestone)));
+            printf("\nOne-time Loyalty Discount (10%%): %s", moneyStr(loyalty_discount));
+            RESET_COLOR;
         }
     }
     
     // Manual Discount
     char discount_choice;
     printf("\nApply manual discount? (y/n): ");
-    scanf(" %c", &discount_choice);
+    promptScanf(" %c", &discount_choice);
     
     if(tolower(discount_choice) == 'y') {
         do {
             printf("\nEnter discount percentage (1-100): ");
-            scanf("%f", &order->manual_discount_percentage);
+            promptScanf("%f", &order->manual_discount_percentage);
             if(order->manual_discount_percentage < 0 || order->manual_discount_percentage > 100) {
                 RED_COLOR;
                 printf("\nInvalid discount percentage! Please enter between 1-100\n");
@@ -1361,9 +2615,9 @@ void processPayment(Order* order) {
             }
         } while(order->manual_discount_percentage < 0 || order->manual_discount_percentage > 100);
         
-        float manual_discount = total * order->manual_discount_percentage / 100;
+        Money manual_discount = percentOf(total, order->manual_discount_percentage);
         order->discount += manual_discount;
-        printf("\nManual discount applied: %.2f", manual_discount);
+        printf("\nManual discount applied: %s", moneyStr(manual_discount));
     }
     
     // Payment Method Selection
@@ -1374,7 +2628,7 @@ void processPayment(Order* order) {
     printf("\n4. Nagad");
     printf("\n5. Bank Transfer");
     printf("\nSelect payment method (1-5): ");
-    scanf("%d", &choice);
+    promptScanf("%d", &choice);
     
     order->payment_method = choice;
     order->card_discount_percentage = 0;  // Reset card discount
@@ -1382,16 +2636,16 @@ void processPayment(Order* order) {
     // Apply 1Card discount only if selected
     if(choice == PAYMENT_1CARD) {
         order->card_discount_percentage = 5.0;
-        float remaining_amount = total - order->discount;
-        float card_discount = remaining_amount * 0.05;
+        Money remaining_amount = total - order->discount;
+        Money card_discount = percentOf(remaining_amount, 5);
         order->discount += card_discount;
-        printf("\n1Card discount applied: %.2f", card_discount);
+        printf("\n1Card discount applied: %s", moneyStr(card_discount));
     }
     
     // Get transaction ID for non-cash payments
     if(choice != PAYMENT_CASH) {
         printf("\nEnter Transaction ID: ");
-        scanf("%s", order->transaction_id);
+        promptScanf("%s", order->transaction_id);
     }
     
     // Update final amount
@@ -1399,30 +2653,27 @@ void processPayment(Order* order) {
     
     // Show payment summary
     printf("\n=== PAYMENT SUMMARY ===\n");
-    printf("Original Amount: %.2f TK\n", total);
+    printf("Original Amount: %s TK\n", moneyStr(total));
     
     // Show loyalty discount if applicable
-    for (int i = 0; i < customer_count; i++) {
-        if (strcmp(customers[i].phone, order->customer_phone) == 0) {
-            if (customers[i].total_spending >= LOYALTY_THRESHOLD) {
-                printf("Loyalty Discount (10%%): %.2f TK \n", total * 0.10);
-            }
-            break;
+    if (i != -1) {
+        if (customers[i].total_spending >= TAKA(LOYALTY_THRESHOLD)) {
+            printf("Loyalty Discount (10%%): %s TK \n", moneyStr(percentOf(total, 10)));
         }
     }
     
     if (order->manual_discount_percentage > 0) {
-        printf("Manual Discount (%.0f%%): %.2f\n", 
+        printf("Manual Discount (%.0f%%): %s\n", 
                order->manual_discount_percentage, 
-               total * order->manual_discount_percentage / 100);
+               moneyStr(percentOf(total, order->manual_discount_percentage)));
     }
     
     if (order->payment_method == PAYMENT_1CARD) {
-        float remaining_after_discounts = total - (total * 0.10) - (total * order->manual_discount_percentage / 100);
-        printf("1Card Discount (5%%): %.2f TK \n", remaining_after_discounts * 0.05);
+        Money remaining_after_discounts = total - percentOf(total, 10) - percentOf(total, order->manual_discount_percentage);
+        printf("1Card Discount (5%%): %s TK \n", moneyStr(percentOf(remaining_after_discounts, 5)));
     }
     
-    printf("Final Amount: %.2f\n", order->total_amount);
+    printf("Final Amount: %s\n", moneyStr(order->total_amount));
     printf("Payment Method: %s\n", 
            choice == PAYMENT_CASH ? "Cash" :
            choice == PAYMENT_1CARD ? "1Card" :
@@ -1430,184 +2681,1094 @@ void processPayment(Order* order) {
            choice == PAYMENT_NAGAD ? "Nagad" : "Bank Transfer");
     
     printf("\nPress Enter to continue...");
-    getchar();
-    getchar();
+    promptChar();
+    promptChar();
+    return milestone;
 }
 
-void generateReceipt(Order order) {
-    char filename[256];
-    char html_file[256];
-    char print_command[512];
-    
-    // Create directories and filenames
-    #ifdef _WIN32
-        CreateDirectory("receipts", NULL);
-        sprintf(html_file, "receipts\\receipt_%ld.html", order.id);
-        sprintf(filename, "receipts\\receipt_%ld.pdf", order.id);
-        sprintf(print_command, "wkhtmltopdf %s %s", html_file, filename);
-    #else
-        system("mkdir -p receipts");  // -p flag for macOS/Linux
-        sprintf(html_file, "receipts/receipt_%ld.html", order.id);  // Forward slash for macOS
-        sprintf(filename, "receipts/receipt_%ld.pdf", order.id);
-        sprintf(print_command, "wkhtmltopdf %s %s", html_file, filename);
-    #endif
+// Output Buffer
+// Report, receipt and PDF emitters write through an OutputBuffer: a large
+// buffer in front of a file (or, with no file, a growing memory block) and
+// outPrintf, which formats the conversions they use (%s %c %d %ld %lld %u
+// %zu with width/'-', %.Nf and %%) without going through stdio. Anything
+// else falls back to vsnprintf.
+
+int outOpen(OutputBuffer* out, const char* path) {
+    memset(out, 0, sizeof(*out));
+    out->file = fopen(path, "w");
+    if (!out->file) return 0;
+    out->capacity = OUTPUT_BUFFER_SIZE;
+    out->data = malloc(out->capacity);
+    return 1;
+}
 
-    FILE* file = fopen(html_file, "w");
-    if (!file) {
-        RED_COLOR;
-        printf("\nError creating receipt file!\n");
-        RESET_COLOR;
-        return;
+void outFlush(OutputBuffer* out) {
+    if (!out->file || out->size == 0) return;
+    if (fwrite(out->data, 1, out->size, out->file) != out->size) out->failed = 1;
+    out->size = 0;
+}
+
+// Flushes and closes; like fclose, returns 0 on success and EOF if any
+// write failed
+int outClose(OutputBuffer* out) {
+    outFlush(out);
+    if (out->file && fclose(out->file) != 0) out->failed = 1;
+    free(out->data);
+    out->file = NULL;
+    out->data = NULL;
+    return out->failed ? EOF : 0;
+}
+
+// Makes room for n more bytes, flushing to the file if there is one
+char* outReserve(OutputBuffer* out, size_t n) {
+    if (out->size + n > out->capacity) {
+        outFlush(out);
+        if (out->size + n > out->capacity) {
+            out->capacity = (out->size + n) * 2;
+            out->data = realloc(out->data, out->capacity);
+        }
     }
-    
-    fprintf(file, "<html><head>\n");
-    fprintf(file, "<meta charset='UTF-8'>\n");
-    fprintf(file, "<style>\n");
-    fprintf(file, "body { font-family: Arial, sans-serif; margin: 0; padding: 20px; }\n");
-    fprintf(file, ".container { width: 800px; margin: 0 auto; border: 1px solid #00a651; padding: 20px; }\n");
-    
-    fprintf(file, ".header { position: relative; margin-bottom: 40px; }\n");
-    fprintf(file, ".invoice-title { color: #00a651; font-size: 24px; margin-bottom: 10px; }\n");
-    fprintf(file, ".company-info { color: #666; font-size: 14px; line-height: 1.5; }\n");
-    fprintf(file, ".invoice-number { position: absolute; top: 0; right: 0; background: #00a651; color: white; padding: 10px 20px; }\n");
-    
-    fprintf(file, ".info-section { display: flex; justify-content: space-between; margin: 30px 0; }\n");
-    fprintf(file, ".payment-info { flex: 1; }\n");
-    fprintf(file, ".invoice-to { flex: 1; text-align: right; }\n");
-    
-    fprintf(file, "table { width: 100%%; border-collapse: collapse; margin: 20px 0; }\n");
-    fprintf(file, "th { background: #00a651; color: white; padding: 12px 8px; text-align: left; }\n");
-    fprintf(file, "td { padding: 10px 8px; border-bottom: 1px solid #ddd; }\n");
-    
-    fprintf(file, ".footer { display: flex; margin-top: 30px; }\n");
-    fprintf(file, ".terms { flex: 1; background: #f9f9f9; padding: 20px; }\n");
-    fprintf(file, ".totals { width: 300px; text-align: right; margin-left: auto; }\n");
-    fprintf(file, ".signature { margin-top: 100px; text-align: right; }\n");
-    fprintf(file, ".signature-line { border-top: 1px solid #000; width: 200px; display: inline-block; text-align: center; padding-top: 5px; }\n");
-    fprintf(file, "</style></head><body>\n");
-    
-    fprintf(file, "<div class='container'>\n");
-    
-    fprintf(file, "<div class='header'>\n");
-    fprintf(file, "  <div class='invoice-title'>Invoice</div>\n");
-    fprintf(file, "  <div class='company-info'>\n");
-    fprintf(file, "    DIU SUPER SHOP<br>\n");
-    fprintf(file, "    Daffodil Smart City, Ashulia, Dhaka<br>\n");
-    fprintf(file, "    Phone: +880 1234-567890<br>\n");
-    fprintf(file, "    Email: info@diusupershop.com\n");
-    fprintf(file, "  </div>\n");
-    fprintf(file, "  <div class='invoice-number'>\n");
-    fprintf(file, "    Invoice No#<br>%ld\n", order.id);
-    fprintf(file, "  </div>\n");
-    fprintf(file, "</div>\n");
-    
-    fprintf(file, "<div class='info-section'>\n");
-    fprintf(file, "  <div class='payment-info'>\n");
-    fprintf(file, "    <strong>Payment Info</strong><br>\n");
-    fprintf(file, "    Invoice ID: %ld<br>\n", order.id);
-    fprintf(file, "    Date & Time: %s<br>\n", order.date);
-    fprintf(file, "    Payment Method: %s\n",
-            order.payment_method == PAYMENT_CASH ? "Cash" :
-            order.payment_method == PAYMENT_1CARD ? "1Card" :
-            order.payment_method == PAYMENT_BKASH ? "bKash" :
-            order.payment_method == PAYMENT_NAGAD ? "Nagad" : "Bank Transfer");
-    fprintf(file, "  </div>\n");
-    
-    fprintf(file, "  <div class='invoice-to'>\n");
-    fprintf(file, "    <strong>Invoice To:</strong><br>\n");
-    
-    int found = 0;
-    for (int i = 0; i < customer_count; i++) {
-        if (strcmp(customers[i].phone, order.customer_phone) == 0) {
-            fprintf(file, "    Name: %s<br>\n", customers[i].name);
-            fprintf(file, "    Address: %s<br>\n", customers[i].address);
-            fprintf(file, "    Phone: %s<br>\n", customers[i].phone);
-            found = 1;
-            break;
+    return out->data + out->size;
+}
+
+void outWrite(OutputBuffer* out, const char* data, size_t len) {
+    memcpy(outReserve(out, len), data, len);
+    out->size += len;
+}
+
+// Digits of v, right to left, ending at end; returns the first digit
+char* formatUnsigned(char* end, unsigned long long v) {
+    do {
+        *--end = (char)('0' + v % 10);
+        v /= 10;
+    } while (v);
+    return end;
+}
+
+// The same digits as printf("%.*f"), rounding half to even. A float
+// argument scaled by 10^precision is exact in a double, so the result
+// matches printf for floats; huge or non-finite values use snprintf.
+int formatFixed(char* buf, size_t size, double v, int precision) {
+    static const double scales[] = {1, 10, 100, 1000, 10000, 100000, 1000000};
+    if (precision < 0 || precision > 6 || !(v > -1e15 && v < 1e15)) {
+        return snprintf(buf, size, "%.*f", precision, v);
+    }
+
+    int negative = v < 0 || (v == 0 && 1 / v < 0);
+    double scaled = (negative ? -v : v) * scales[precision];
+    unsigned long long whole = (unsigned long long)scaled;
+    double fraction = scaled - (double)whole;
+    if (fraction > 0.5 || (fraction == 0.5 && (whole & 1))) whole++;
+
+    char digits[32];
+    char* end = digits + sizeof(digits);
+    char* p = formatUnsigned(end, whole);
+    while (end - p <= precision) *--p = '0';
+
+    int n = 0;
+    if (negative) buf[n++] = '-';
+    int int_digits = (int)(end - p) - precision;
+    memcpy(buf + n, p, int_digits);
+    n += int_digits;
+    if (precision > 0) {
+        buf[n++] = '.';
+        memcpy(buf + n, p + int_digits, precision);
+        n += precision;
+    }
+    buf[n] = '\0';
+    return n;
+}
+
+void outPadded(OutputBuffer* out, const char* text, size_t len, int width, int left) {
+    size_t pad = width > 0 && (size_t)width > len ? width - len : 0;
+    char* p = outReserve(out, len + pad);
+    if (!left) { memset(p, ' ', pad); p += pad; }
+    memcpy(p, text, len);
+    if (left) memset(p + len, ' ', pad);
+    out->size += len + pad;
+}
+
+// Whether every conversion in format is one outPrintf formats itself
+int fastFormat(const char* f) {
+    for (; *f; f++) {
+        if (*f != '%') continue;
+        f++;
+        if (*f == '-') f++;
+        while (*f >= '0' && *f <= '9') f++;
+        if (*f == '.') {
+            for (f++; *f >= '0' && *f <= '9'; f++) {}
         }
+        while (*f == 'l' || *f == 'z') f++;
+        if (!*f || !strchr("%scdiuf", *f)) return 0;
     }
-    
-    if (!found) {
-        fprintf(file, "    Guest Customer<br>\n");
-        fprintf(file, "    Phone: %s<br>\n", order.customer_phone);
+    return 1;
+}
+
+void outPrintf(OutputBuffer* out, const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    if (!fastFormat(format)) {
+        va_list copy;
+        va_copy(copy, args);
+        int len = vsnprintf(NULL, 0, format, copy);
+        va_end(copy);
+        if (len > 0) {
+            vsnprintf(outReserve(out, len + 1), len + 1, format, args);
+            out->size += len;
+        }
+        va_end(args);
+        return;
     }
-    
-    fprintf(file, "  </div>\n");
-    fprintf(file, "</div>\n");
 
-    // Table
-    fprintf(file, "<table>\n");
-    fprintf(file, "<tr><th>SL</th><th>Description</th><th>Price</th><th>Quantity</th><th>Total</th></tr>\n");
-    
-    float subtotal = 0;
-    for (int i = 0; i < order.item_count; i++) {
-        for (int j = 0; j < product_count; j++) {
-            if (products[j].id == order.items[i].product_id) {
-                float amount = order.items[i].quantity * order.items[i].price;
-                subtotal += amount;
-                fprintf(file, "<tr><td>%d</td><td>%s</td><td>%.2f</td><td>%d</td><td>%.2f</td></tr>\n",
-                        i + 1,
-                        products[j].name,
-                        order.items[i].price,
-                        order.items[i].quantity,
-                        amount);
+    for (const char* f = format; *f; f++) {
+        const char* literal = f;
+        while (*f && *f != '%') f++;
+        if (f > literal) outWrite(out, literal, f - literal);
+        if (!*f) break;
+
+        f++;
+        int left = 0, width = 0, precision = -1, length = 0;
+        if (*f == '-') { left = 1; f++; }
+        while (*f >= '0' && *f <= '9') width = width * 10 + (*f++ - '0');
+        if (*f == '.') {
+            precision = 0;
+            for (f++; *f >= '0' && *f <= '9'; f++) precision = precision * 10 + (*f - '0');
+        }
+        while (*f == 'l' || *f == 'z') { length = *f == 'z' ? 'z' : length + 1; f++; }
+
+        char buf[512];
+        char* end = buf + sizeof(buf);
+        switch (*f) {
+            case '%':
+                outWrite(out, "%", 1);
+                break;
+            case 's': {
+                const char* s = va_arg(args, const char*);
+                if (!s) s = "(null)";
+                size_t len = strlen(s);
+                if (precision >= 0 && (size_t)precision < len) len = precision;
+                outPadded(out, s, len, width, left);
+                break;
+            }
+            case 'c':
+                buf[0] = (char)va_arg(args, int);
+                outPadded(out, buf, 1, width, left);
+                break;
+            case 'd':
+            case 'i': {
+                long long v = length == 'z' ? (long long)va_arg(args, size_t) :
+                              length == 2 ? va_arg(args, long long) :
+                              length == 1 ? va_arg(args, long) : va_arg(args, int);
+                char* p = formatUnsigned(end, v < 0 ? 0ULL - (unsigned long long)v : (unsigned long long)v);
+                if (v < 0) *--p = '-';
+                outPadded(out, p, end - p, width, left);
+                break;
+            }
+            case 'u': {
+                unsigned long long v = length == 'z' ? va_arg(args, size_t) :
+                                       length == 2 ? va_arg(args, unsigned long long) :
+                                       length == 1 ? va_arg(args, unsigned long) : va_arg(args, unsigned int);
+                char* p = formatUnsigned(end, v);
+                outPadded(out, p, end - p, width, left);
+                break;
+            }
+            case 'f': {
+                int n = formatFixed(buf, sizeof(buf), va_arg(args, double), precision < 0 ? 6 : precision);
+                outPadded(out, buf, n < (int)sizeof(buf) ? n : (int)sizeof(buf) - 1, width, left);
                 break;
             }
         }
     }
-    fprintf(file, "</table>\n");
-    
-    fprintf(file, "<div class='footer'>\n");
-    fprintf(file, "  <div class='terms'>\n");
-    fprintf(file, "    <strong>Thank you for your business</strong><br><br>\n");
-    fprintf(file, "    <strong>Terms & Conditions</strong><br>\n");
-    fprintf(file, "    1. All prices include VAT<br>\n");
-    fprintf(file, "    2. No refund after purchase<br>\n");
-    fprintf(file, "    3. Please keep the receipt for warranty\n");
-    fprintf(file, "  </div>\n");
-    fprintf(file, "  <div class='totals'>\n");
-    fprintf(file, "    Sub Total: %.2f<br>\n", subtotal);
-    if (order.manual_discount_percentage > 0) {
-        fprintf(file, "    Discount %.0f%%: %.2f<br>\n", 
-                order.manual_discount_percentage,
-                subtotal * order.manual_discount_percentage / 100);
-    }
-    fprintf(file, "    <strong>Total Amount: %.2f</strong>\n", order.total_amount);
-    fprintf(file, "  </div>\n");
-    fprintf(file, "</div>\n");
-    
-    // Signature
-    fprintf(file, "<div class='signature'>\n");
-    fprintf(file, "  <div class='signature-line'>Authorized Sign</div>\n");
-    fprintf(file, "</div>\n");
-    
-    fprintf(file, "</div>\n");
+    va_end(args);
+}
 
-  fclose(file);
+// PDF Writer
+// Just enough PDF for the fixed receipt layout: base-14 Helvetica text,
+// filled rectangles and lines, written uncompressed. Coordinates are in
+// points from the bottom-left corner of an A4 page.
+typedef struct {
+    OutputBuffer pages[PDF_MAX_PAGES];  // Content streams, in memory
+    int page_count;
+} PdfDocument;
+
+// Helvetica advance widths for ' ' to '~', in 1/1000 em
+const short helvetica_widths[95] = {
+    278, 278, 355, 556, 556, 889, 667, 191, 333, 333, 389, 584, 278, 333, 278, 278,
+    556, 556, 556, 556, 556, 556, 556, 556, 556, 556, 278, 278, 584, 584, 584, 556,
+    1015, 667, 667, 722, 722, 667, 611, 778, 722, 278, 500, 667, 556, 833, 722, 778,
+    667, 778, 722, 667, 611, 722, 667, 944, 667, 667, 611, 278, 278, 278, 469, 556,
+    333, 556, 556, 500, 556, 556, 278, 556, 556, 222, 222, 500, 222, 833, 556, 556,
+    556, 556, 333, 500, 278, 556, 500, 722, 500, 500, 500, 334, 260, 334, 584
+};
+
+OutputBuffer* pdfPage(PdfDocument* doc) {
+    return &doc->pages[doc->page_count - 1];
+}
 
-    // Convert HTML to PDF
-    #ifdef _WIN32
-        sprintf(print_command, "wkhtmltopdf %s %s", html_file, filename);
-    #else
-        sprintf(print_command, "wkhtmltopdf %s %s", html_file, filename);
-    #endif
+int pdfNewPage(PdfDocument* doc) {
+    if (doc->page_count == PDF_MAX_PAGES) return 0;
+    doc->page_count++;
+    return 1;
+}
 
-    int result = system(print_command);
-    
-    #ifdef _WIN32
-        sprintf(print_command, "start %s", filename);
-    #else
-        sprintf(print_command, "xdg-open %s", filename);
-    #endif
-    system(print_command);
+// Helvetica-Bold runs about 5% wider than the regular widths above
+float pdfTextWidth(const char* text, float size, int bold) {
+    int width = 0;
+    for (; *text; text++) {
+        unsigned char c = (unsigned char)*text;
+        width += c >= 32 && c <= 126 ? helvetica_widths[c - 32] : 556;
+    }
+    return width * size / 1000 * (bold ? 1.05f : 1.0f);
+}
+
+void pdfText(PdfDocument* doc, float x, float y, int bold, float size, const char* text) {
+    char escaped[2 * 256 + 1];
+    size_t n = 0;
+    for (; *text && n + 2 < sizeof(escaped); text++) {
+        if (*text == '(' || *text == ')' || *text == '\\') escaped[n++] = '\\';
+        escaped[n++] = *text;
+    }
+    escaped[n] = '\0';
+    outPrintf(pdfPage(doc), "BT /%s %.1f Tf %.2f %.2f Td (%s) Tj ET\n", bold ? "F2" : "F1", size, x, y, escaped);
+}
+
+void pdfTextRight(PdfDocument* doc, float right, float y, int bold, float size, const char* text) {
+    pdfText(doc, right - pdfTextWidth(text, size, bold), y, bold, size, text);
+}
+
+// Sets the fill color used by text and rectangles
+void pdfColor(PdfDocument* doc, float r, float g, float b) {
+    outPrintf(pdfPage(doc), "%.3f %.3f %.3f rg\n", r, g, b);
+}
+
+void pdfFillRect(PdfDocument* doc, float x, float y, float w, float h) {
+    outPrintf(pdfPage(doc), "%.2f %.2f %.2f %.2f re f\n", x, y, w, h);
+}
+
+void pdfStrokeRect(PdfDocument* doc, float x, float y, float w, float h, float r, float g, float b) {
+    outPrintf(pdfPage(doc), "%.3f %.3f %.3f RG 1 w %.2f %.2f %.2f %.2f re S\n", r, g, b, x, y, w, h);
+}
+
+void pdfLine(PdfDocument* doc, float x1, float y1, float x2, float y2, float gray) {
+    outPrintf(pdfPage(doc), "%.3f G 0.75 w %.2f %.2f m %.2f %.2f l S\n", gray, x1, y1, x2, y2);
+}
+
+int pdfSave(PdfDocument* doc, const char* path) {
+    FILE* file = fopen(path, "wb");
+    if (!file) return 0;
+
+    // Objects: 1 catalog, 2 page tree, 3-4 fonts, then a page and its
+    // content stream for each page
+    long offsets[5 + 2 * PDF_MAX_PAGES];
+    int object_count = 4 + 2 * doc->page_count;
+
+    fprintf(file, "%%PDF-1.4\n");
+    offsets[1] = ftell(file);
+    fprintf(file, "1 0 obj\n<< /Type /Catalog /Pages 2 0 R >>\nendobj\n");
+    offsets[2] = ftell(file);
+    fprintf(file, "2 0 obj\n<< /Type /Pages /Count %d /Kids [", doc->page_count);
+    for (int i = 0; i < doc->page_count; i++) {
+        fprintf(file, " %d 0 R", 5 + 2 * i);
+    }
+    fprintf(file, " ] >>\nendobj\n");
+    offsets[3] = ftell(file);
+    fprintf(file, "3 0 obj\n<< /Type /Font /Subtype /Type1 /BaseFont /Helvetica "
+                  "/Encoding /WinAnsiEncoding >>\nendobj\n");
+    offsets[4] = ftell(file);
+    fprintf(file, "4 0 obj\n<< /Type /Font /Subtype /Type1 /BaseFont /Helvetica-Bold "
+                  "/Encoding /WinAnsiEncoding >>\nendobj\n");
+
+    for (int i = 0; i < doc->page_count; i++) {
+        int page = 5 + 2 * i;
+        offsets[page] = ftell(file);
+        fprintf(file, "%d 0 obj\n<< /Type /Page /Parent 2 0 R /MediaBox [0 0 %d %d] "
+                      "/Resources << /Font << /F1 3 0 R /F2 4 0 R >> >> /Contents %d 0 R >>\nendobj\n",
+                page, PDF_PAGE_WIDTH, PDF_PAGE_HEIGHT, page + 1);
+        offsets[page + 1] = ftell(file);
+        fprintf(file, "%d 0 obj\n<< /Length %lu >>\nstream\n", page + 1, (unsigned long)doc->pages[i].size);
+        if (doc->pages[i].size) fwrite(doc->pages[i].data, 1, doc->pages[i].size, file);
+        fprintf(file, "\nendstream\nendobj\n");
+    }
+
+    long xref = ftell(file);
+    fprintf(file, "xref\n0 %d\n0000000000 65535 f \n", object_count + 1);
+    for (int i = 1; i <= object_count; i++) {
+        fprintf(file, "%010ld 00000 n \n", offsets[i]);
+    }
+    fprintf(file, "trailer\n<< /Size %d /Root 1 0 R >>\nstartxref\n%ld\n%%%%EOF\n", object_count + 1, xref);
+
+    return fclose(file) == 0;
+}
+
+void pdfFree(PdfDocument* doc) {
+    for (int i = 0; i < doc->page_count; i++) {
+        outClose(&doc->pages[i]);
+    }
+}
+
+// Invoice green (#00a651)
+#define RECEIPT_GREEN 0.0, 0.651, 0.318
+
+// Border and table header repeated on every page
+void receiptPageFrame(PdfDocument* doc, float table_top) {
+    pdfStrokeRect(doc, 40, 40, 515, 762, RECEIPT_GREEN);
+    pdfColor(doc, RECEIPT_GREEN);
+    pdfFillRect(doc, 60, table_top - 24, 475, 24);
+    pdfColor(doc, 1, 1, 1);
+    pdfText(doc, 68, table_top - 16, 1, 10, "SL");
+    pdfText(doc, 100, table_top - 16, 1, 10, "Description");
+    pdfTextRight(doc, 370, table_top - 16, 1, 10, "Price");
+    pdfTextRight(doc, 445, table_top - 16, 1, 10, "Quantity");
+    pdfTextRight(doc, 527, table_top - 16, 1, 10, "Total");
+    pdfColor(doc, 0, 0, 0);
+}
+
+// The same invoice as the HTML receipt, drawn directly
+int writeReceiptPDF(const Receipt* receipt, const char* path) {
+    const Order* order = &receipt->order;
+    PdfDocument doc;
+    memset(&doc, 0, sizeof(doc));
+    char line[256];
+
+    pdfNewPage(&doc);
+    receiptPageFrame(&doc, 580);
+
+    // Header
+    pdfColor(&doc, RECEIPT_GREEN);
+    pdfText(&doc, 60, 765, 0, 24, "Invoice");
+    pdfColor(&doc, 0.4, 0.4, 0.4);
+    pdfText(&doc, 60, 745, 0, 10, "DIU SUPER SHOP");
+    pdfText(&doc, 60, 731, 0, 10, "Daffodil Smart City, Ashulia, Dhaka");
+    pdfText(&doc, 60, 717, 0, 10, "Phone: +880 1234-567890");
+    pdfText(&doc, 60, 703, 0, 10, "Email: info@diusupershop.com");
+    pdfColor(&doc, RECEIPT_GREEN);
+    pdfFillRect(&doc, 405, 735, 130, 45);
+    pdfColor(&doc, 1, 1, 1);
+    pdfText(&doc, 415, 763, 0, 11, "Invoice No#");
+    snprintf(line, sizeof(line), "%ld", order->id);
+    pdfText(&doc, 415, 745, 1, 12, line);
+    pdfColor(&doc, 0, 0, 0);
+
+    // Payment info and customer
+    pdfText(&doc, 60, 665, 1, 11, "Payment Info");
+    snprintf(line, sizeof(line), "Invoice ID: %ld", order->id);
+    pdfText(&doc, 60, 650, 0, 10, line);
+    snprintf(line, sizeof(line), "Date & Time: %s", order->date);
+    pdfText(&doc, 60, 636, 0, 10, line);
+    snprintf(line, sizeof(line), "Payment Method: %s",
+             order->payment_method == PAYMENT_CASH ? "Cash" :
+             order->payment_method == PAYMENT_1CARD ? "1Card" :
+             order->payment_method == PAYMENT_BKASH ? "bKash" :
+             order->payment_method == PAYMENT_NAGAD ? "Nagad" : "Bank Transfer");
+    pdfText(&doc, 60, 622, 0, 10, line);
+
+    pdfTextRight(&doc, 535, 665, 1, 11, "Invoice To:");
+    if (receipt->has_customer) {
+        snprintf(line, sizeof(line), "Name: %s", receipt->customer_name);
+        pdfTextRight(&doc, 535, 650, 0, 10, line);
+        snprintf(line, sizeof(line), "Address: %s", receipt->customer_address);
+        pdfTextRight(&doc, 535, 636, 0, 10, line);
+        snprintf(line, sizeof(line), "Phone: %s", order->customer_phone);
+        pdfTextRight(&doc, 535, 622, 0, 10, line);
+    } else {
+        pdfTextRight(&doc, 535, 650, 0, 10, "Guest Customer");
+        snprintf(line, sizeof(line), "Phone: %s", order->customer_phone);
+        pdfTextRight(&doc, 535, 636, 0, 10, line);
+    }
+
+    // Item table, continued on new pages as needed
+    float y = 556;
+    Money subtotal = 0;
+    char money[MONEY_STR_SIZE];
+    for (int i = 0; i < order->item_count; i++) {
+        if (receipt->item_names[i][0] == '\0') continue;
+
+        if (y - 22 < 50) {
+            if (!pdfNewPage(&doc)) break;
+            receiptPageFrame(&doc, 780);
+            y = 756;
+        }
+        Money amount = order->items[i].quantity * order->items[i].price;
+        subtotal += amount;
+        snprintf(line, sizeof(line), "%d", i + 1);
+        pdfText(&doc, 68, y - 15, 0, 10, line);
+        pdfText(&doc, 100, y - 15, 0, 10, receipt->item_names[i]);
+        pdfTextRight(&doc, 370, y - 15, 0, 10, formatMoney(money, order->items[i].price));
+        snprintf(line, sizeof(line), "%d", order->items[i].quantity);
+        pdfTextRight(&doc, 445, y - 15, 0, 10, line);
+        pdfTextRight(&doc, 527, y - 15, 0, 10, formatMoney(money, amount));
+        pdfLine(&doc, 60, y - 22, 535, y - 22, 0.867);
+        y -= 22;
+    }
+
+    // Terms, totals and signature need about 190pt below the table
+    float top = y - 20;
+    if (top < 235 && pdfNewPage(&doc)) {
+        pdfStrokeRect(&doc, 40, 40, 515, 762, RECEIPT_GREEN);
+        top = 780;
+    }
+    pdfColor(&doc, 0.976, 0.976, 0.976);
+    pdfFillRect(&doc, 60, top - 110, 250, 110);
+    pdfColor(&doc, 0, 0, 0);
+    pdfText(&doc, 72, top - 20, 1, 10, "Thank you for your business");
+    pdfText(&doc, 72, top - 45, 1, 10, "Terms & Conditions");
+    pdfText(&doc, 72, top - 60, 0, 9, "1. All prices include VAT");
+    pdfText(&doc, 72, top - 74, 0, 9, "2. No refund after purchase");
+    pdfText(&doc, 72, top - 88, 0, 9, "3. Please keep the receipt for warranty");
+
+    float totals_y = top - 20;
+    snprintf(line, sizeof(line), "Sub Total: %s", formatMoney(money, subtotal));
+    pdfTextRight(&doc, 535, totals_y, 0, 10, line);
+    if (order->manual_discount_percentage > 0) {
+        totals_y -= 16;
+        snprintf(line, sizeof(line), "Discount %.0f%%: %s",
+                 order->manual_discount_percentage,
+                 formatMoney(money, percentOf(subtotal, order->manual_discount_percentage)));
+        pdfTextRight(&doc, 535, totals_y, 0, 10, line);
+    }
+    snprintf(line, sizeof(line), "Total Amount: %s", formatMoney(money, order->total_amount));
+    pdfTextRight(&doc, 535, totals_y - 16, 1, 11, line);
+
+    pdfLine(&doc, 335, top - 170, 535, top - 170, 0);
+    pdfText(&doc, 435 - pdfTextWidth("Authorized Sign", 10, 0) / 2, top - 183, 0, 10, "Authorized Sign");
+
+    int ok = pdfSave(&doc, path);
+    pdfFree(&doc);
+    return ok;
+}
+
+// HTML version of the receipt, for the wkhtmltopdf route
+int writeReceiptHTML(const Receipt* receipt, const char* html_file) {
+    const Order* order = &receipt->order;
+    OutputBuffer out;
+    if (!outOpen(&out, html_file)) return 0;
+    
+    outPrintf(&out, "<html><head>\n");
+    outPrintf(&out, "<meta charset='UTF-8'>\n");
+    outPrintf(&out, "<style>\n");
+    outPrintf(&out, "body { font-family: Arial, sans-serif; margin: 0; padding: 20px; }\n");
+    outPrintf(&out, ".container { width: 800px; margin: 0 auto; border: 1px solid #00a651; padding: 20px; }\n");
+    
+    outPrintf(&out, ".header { position: relative; margin-bottom: 40px; }\n");
+    outPrintf(&out, ".invoice-title { color: #00a651; font-size: 24px; margin-bottom: 10px; }\n");
+    outPrintf(&out, ".company-info { color: #666; font-size: 14px; line-height: 1.5; }\n");
+    outPrintf(&out, ".invoice-number { position: absolute; top: 0; right: 0; background: #00a651; color: white; padding: 10px 20px; }\n");
+    
+    outPrintf(&out, ".info-section { display: flex; justify-content: space-between; margin: 30px 0; }\n");
+    outPrintf(&out, ".payment-info { flex: 1; }\n");
+    outPrintf(&out, ".invoice-to { flex: 1; text-align: right; }\n");
+    
+    outPrintf(&out, "table { width: 100%%; border-collapse: collapse; margin: 20px 0; }\n");
+    outPrintf(&out, "th { background: #00a651; color: white; padding: 12px 8px; text-align: left; }\n");
+    outPrintf(&out, "td { padding: 10px 8px; border-bottom: 1px solid #ddd; }\n");
+    
+    outPrintf(&out, ".footer { display: flex; margin-top: 30px; }\n");
+    outPrintf(&out, ".terms { flex: 1; background: #f9f9f9; padding: 20px; }\n");
+    outPrintf(&out, ".totals { width: 300px; text-align: right; margin-left: auto; }\n");
+    outPrintf(&out, ".signature { margin-top: 100px; text-align: right; }\n");
+    outPrintf(&out, ".signature-line { border-top: 1px solid #000; width: 200px; display: inline-block; text-align: center; padding-top: 5px; }\n");
+    outPrintf(&out, "</style></head><body>\n");
+    
+    outPrintf(&out, "<div class='container'>\n");
+    
+    outPrintf(&out, "<div class='header'>\n");
+    outPrintf(&out, "  <div class='invoice-title'>Invoice</div>\n");
+    outPrintf(&out, "  <div class='company-info'>\n");
+    outPrintf(&out, "    DIU SUPER SHOP<br>\n");
+    outPrintf(&out, "    Daffodil Smart City, Ashulia, Dhaka<br>\n");
+    outPrintf(&out, "    Phone: +880 1234-567890<br>\n");
+    outPrintf(&out, "    Email: info@diusupershop.com\n");
+    outPrintf(&out, "  </div>\n");
+    outPrintf(&out, "  <div class='invoice-number'>\n");
+    outPrintf(&out, "    Invoice No#<br>%ld\n", order->id);
+    outPrintf(&out, "  </div>\n");
+    outPrintf(&out, "</div>\n");
+    
+    outPrintf(&out, "<div class='info-section'>\n");
+    outPrintf(&out, "  <div class='payment-info'>\n");
+    outPrintf(&out, "    <strong>Payment Info</strong><br>\n");
+    outPrintf(&out, "    Invoice ID: %ld<br>\n", order->id);
+    outPrintf(&out, "    Date & Time: %s<br>\n", order->date);
+    outPrintf(&out, "    Payment Method: %s\n",
+            order->payment_method == PAYMENT_CASH ? "Cash" :
+            order->payment_method == PAYMENT_1CARD ? "1Card" :
+            order->payment_method == PAYMENT_BKASH ? "bKash" :
+            order->payment_method == PAYMENT_NAGAD ? "Nagad" : "Bank Transfer");
+    outPrintf(&out, "  </div>\n");
+    
+    outPrintf(&out, "  <div class='invoice-to'>\n");
+    outPrintf(&out, "    <strong>Invoice To:</strong><br>\n");
+    
+    if (receipt->has_customer) {
+        outPrintf(&out, "    Name: %s<br>\n", receipt->customer_name);
+        outPrintf(&out, "    Address: %s<br>\n", receipt->customer_address);
+        outPrintf(&out, "    Phone: %s<br>\n", order->customer_phone);
+    } else {
+        outPrintf(&out, "    Guest Customer<br>\n");
+        outPrintf(&out, "    Phone: %s<br>\n", order->customer_phone);
+    }
+    
+    outPrintf(&out, "  </div>\n");
+    outPrintf(&out, "</div>\n");
+
+    // Table
+    outPrintf(&out, "<table>\n");
+    outPrintf(&out, "<tr><th>SL</th><th>Description</th><th>Price</th><th>Quantity</th><th>Total</th></tr>\n");
+    
+    Money subtotal = 0;
+    char price[MONEY_STR_SIZE], money[MONEY_STR_SIZE];
+    for (int i = 0; i < order->item_count; i++) {
+        if (receipt->item_names[i][0] != '\0') {
+            Money amount = order->items[i].quantity * order->items[i].price;
+            subtotal += amount;
+            outPrintf(&out, "<tr><td>%d</td><td>%s</td><td>%s</td><td>%d</td><td>%s</td></tr>\n",
+                    i + 1,
+                    receipt->item_names[i],
+                    formatMoney(price, order->items[i].price),
+                    order->items[i].quantity,
+                    formatMoney(money, amount));
+        }
+    }
+    outPrintf(&out, "</table>\n");
+    
+    outPrintf(&out, "<div class='footer'>\n");
+    outPrintf(&out, "  <div class='terms'>\n");
+    outPrintf(&out, "    <strong>Thank you for your business</strong><br><br>\n");
+    outPrintf(&out, "    <strong>Terms & Conditions</strong><br>\n");
+    outPrintf(&out, "    1. All prices include VAT<br>\n");
+    outPrintf(&out, "    2. No refund after purchase<br>\n");
+    outPrintf(&out, "    3. Please keep the receipt for warranty\n");
+    outPrintf(&out, "  </div>\n");
+    outPrintf(&out, "  <div class='totals'>\n");
+    outPrintf(&out, "    Sub Total: %s<br>\n", formatMoney(money, subtotal));
+    if (order->manual_discount_percentage > 0) {
+        outPrintf(&out, "    Discount %.0f%%: %s<br>\n", 
+                order->manual_discount_percentage,
+                formatMoney(money, percentOf(subtotal, order->manual_discount_percentage)));
+    }
+    outPrintf(&out, "    <strong>Total Amount: %s</strong>\n", formatMoney(money, order->total_amount));
+    outPrintf(&out, "  </div>\n");
+    outPrintf(&out, "</div>\n");
+    
+    // Signature
+    outPrintf(&out, "<div class='signature'>\n");
+    outPrintf(&out, "  <div class='signature-line'>Authorized Sign</div>\n");
+    outPrintf(&out, "</div>\n");
+    
+    outPrintf(&out, "</div>\n");
+
+    return outClose(&out) == 0;
+}
+
+void prepareReceipt(const Order* order, Receipt* receipt) {
+    memset(receipt, 0, sizeof(*receipt));
+    receipt->order = *order;
+
+    int c = findCustomerIndex(order->customer_phone);
+    if (c != -1) {
+        receipt->has_customer = 1;
+        snprintf(receipt->customer_name, MAX_STRING, "%s", customers[c].name);
+        snprintf(receipt->customer_address, MAX_STRING, "%s", customers[c].address);
+    }
+    for (int i = 0; i < order->item_count; i++) {
+        int j = findProductIndex(order->items[i].product_id);
+        if (j != -1) {
+            snprintf(receipt->item_names[i], MAX_STRING, "%s", products[j].name);
+        }
+    }
+}
+
+// Renders to a temporary name and renames, so an existing PDF is always
+// complete. Safe to call from the receipt workers.
+int renderReceipt(const Receipt* receipt) {
+    char filename[256];
+    char partial[256];
+    char html_file[256];
+    char print_command[512];
+    long id = receipt->order.id;
+
+    #ifdef _WIN32
+        sprintf(html_file, "receipts\\receipt_%ld.html", id);
+        sprintf(partial, "receipts\\receipt_%ld.part.pdf", id);
+        sprintf(filename, "receipts\\receipt_%ld.pdf", id);
+    #else
+        sprintf(html_file, "receipts/receipt_%ld.html", id);  // Forward slash for macOS
+        sprintf(partial, "receipts/receipt_%ld.part.pdf", id);
+        sprintf(filename, "receipts/receipt_%ld.pdf", id);
+    #endif
+
+    // The built-in writer avoids starting a browser engine for every sale
+    int ok;
+    if (RECEIPT_USE_WKHTMLTOPDF) {
+        ok = writeReceiptHTML(receipt, html_file);
+        if (ok) {
+            sprintf(print_command, "wkhtmltopdf %s %s", html_file, partial);
+            ok = system(print_command) == 0;
+            remove(html_file);
+        }
+    } else {
+        ok = writeReceiptPDF(receipt, partial);
+    }
+    if (!ok) {
+        remove(partial);
+        return 0;
+    }
+#ifdef _WIN32
+    remove(filename);
+#endif
+    if (rename(partial, filename) != 0) return 0;
+
+    if (receipt->open_when_done) {
+        #ifdef _WIN32
+            sprintf(print_command, "start %s", filename);
+        #else
+            sprintf(print_command, "xdg-open %s", filename);
+        #endif
+        system(print_command);
+    }
+    return 1;
+}
+
+// Job Scheduler
+// Background work (receipts, report PDFs, snapshot formatting, the
+// daemon's reports) runs on one pool of up to JOB_MAX_WORKERS threads,
+// started on first use. Each worker has a deque per priority. A worker
+// pushes the jobs it submits onto its own deques; other threads' jobs are
+// spread over the workers in turn. A worker takes its newest job and, with
+// none left, steals the oldest from another worker. It drains every deque
+// of one priority before looking at the next, so a receipt never waits
+// behind a queue of report conversions. Without threads (Windows, or if
+// none start) jobs run when they are submitted.
+#ifndef _WIN32
+JobWorker job_workers[JOB_MAX_WORKERS];
+int job_worker_count = 0;
+int job_workers_started = 0;
+int job_next_worker = 0;
+// Guards the counts below; job_available wakes idle workers and job_idle
+// tells stopJobWorkers that everything has run
+pthread_mutex_t job_lock = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t job_available = PTHREAD_COND_INITIALIZER;
+pthread_cond_t job_idle = PTHREAD_COND_INITIALIZER;
+int jobs_queued = 0;
+int jobs_running = 0;
+int job_workers_stopping = 0;
+
+// Caller holds the worker's lock
+void pushJob(JobDeque* deque, Job job) {
+    if (deque->top > 0 && deque->bottom == deque->capacity) {
+        memmove(deque->jobs, deque->jobs + deque->top, (deque->bottom - deque->top) * sizeof(Job));
+        deque->bottom -= deque->top;
+        deque->top = 0;
+    }
+    if (deque->bottom == deque->capacity) {
+        deque->capacity = deque->capacity ? deque->capacity * 2 : 16;
+        deque->jobs = realloc(deque->jobs, deque->capacity * sizeof(Job));
+    }
+    deque->jobs[deque->bottom++] = job;
+}
+
+// The calling thread's place in job_workers, or -1
+int currentJobWorker() {
+    for (int i = 0; i < job_worker_count; i++) {
+        if (pthread_equal(job_workers[i].thread, pthread_self())) return i;
+    }
+    return -1;
+}
+
+// Takes the most urgent job, preferring worker self's own
+int takeJob(int self, Job* job) {
+    for (int p = 0; p < JOB_PRIORITIES; p++) {
+        for (int k = 0; k < job_worker_count; k++) {
+            JobWorker* worker = &job_workers[(self + k) % job_worker_count];
+            JobDeque* deque = &worker->deques[p];
+            pthread_mutex_lock(&worker->lock);
+            int found = deque->top < deque->bottom;
+            if (found) *job = k == 0 ? deque->jobs[--deque->bottom] : deque->jobs[deque->top++];
+            if (deque->top == deque->bottom) deque->top = deque->bottom = 0;
+            pthread_mutex_unlock(&worker->lock);
+            if (found) return 1;
+        }
+    }
+    return 0;
+}
+
+void* jobWorker(void* arg) {
+    int self = (int)(intptr_t)arg;
+    while (1) {
+        Job job;
+        if (takeJob(self, &job)) {
+            pthread_mutex_lock(&job_lock);
+            jobs_queued--;
+            jobs_running++;
+            pthread_mutex_unlock(&job_lock);
+
+            job.run(job.arg);
+
+            pthread_mutex_lock(&job_lock);
+            jobs_running--;
+            if (jobs_queued <= 0 && jobs_running == 0) pthread_cond_broadcast(&job_idle);
+            pthread_mutex_unlock(&job_lock);
+            continue;
+        }
+
+        pthread_mutex_lock(&job_lock);
+        while (jobs_queued <= 0 && !job_workers_stopping) {
+            pthread_cond_wait(&job_available, &job_lock);
+        }
+        int stop = jobs_queued <= 0 && job_workers_stopping;
+        pthread_mutex_unlock(&job_lock);
+        if (stop) break;
+    }
+    return NULL;
+}
+#endif
+
+// Starts the pool, one worker per core, if it has not been; returns how
+// many workers there are
+int startJobWorkers() {
+#ifdef _WIN32
+    return 0;
+#else
+    pthread_mutex_lock(&job_lock);
+    if (!job_workers_started) {
+        job_workers_started = 1;
+        long cores = sysconf(_SC_NPROCESSORS_ONLN);
+        int count = cores < 2 ? 2 : cores > JOB_MAX_WORKERS ? JOB_MAX_WORKERS : (int)cores;
+
+        // Ctrl+C is left to the threads the program started with. Every
+        // worker's slot is set up before any of them runs.
+        sigset_t exit_signals, previous;
+        sigemptyset(&exit_signals);
+        sigaddset(&exit_signals, SIGINT);
+        sigaddset(&exit_signals, SIGTERM);
+        pthread_sigmask(SIG_BLOCK, &exit_signals, &previous);
+        for (int i = 0; i < count; i++) {
+            memset(&job_workers[i], 0, sizeof(JobWorker));
+            pthread_mutex_init(&job_workers[i].lock, NULL);
+        }
+        job_worker_count = count;
+        int started = 0;
+        for (int i = 0; i < count; i++) {
+            if (pthread_create(&job_workers[started].thread, NULL, jobWorker, (void*)(intptr_t)started) == 0) {
+                started++;
+            }
+        }
+        job_worker_count = started;
+        pthread_sigmask(SIG_SETMASK, &previous, NULL);
+        if (started > 0) atexit(stopJobWorkers);
+    }
+    int count = job_worker_count;
+    pthread_mutex_unlock(&job_lock);
+    return count;
+#endif
+}
+
+// Lets everything queued finish, then stops the workers. Anything a crash
+// interrupts is covered by receipts.queue or simply not written.
+void stopJobWorkers() {
+#ifndef _WIN32
+    pthread_mutex_lock(&job_lock);
+    while (jobs_queued > 0 || jobs_running > 0) pthread_cond_wait(&job_idle, &job_lock);
+    job_workers_stopping = 1;
+    pthread_cond_broadcast(&job_available);
+    int count = job_worker_count;
+    pthread_mutex_unlock(&job_lock);
+    for (int i = 0; i < count; i++) pthread_join(job_workers[i].thread, NULL);
+    job_worker_count = 0;
+#endif
+}
+
+// Runs run(arg) on a worker at the given priority, or right away when
+// there are no workers
+void submitJob(int priority, void (*run)(void* arg), void* arg) {
+#ifndef _WIN32
+    if (startJobWorkers() > 0) {
+        Job job = {run, arg};
+        int w = currentJobWorker();
+        pthread_mutex_lock(&job_lock);
+        if (w == -1) w = job_next_worker++ % job_worker_count;
+        pthread_mutex_unlock(&job_lock);
+
+        pthread_mutex_lock(&job_workers[w].lock);
+        pushJob(&job_workers[w].deques[priority], job);
+        pthread_mutex_unlock(&job_workers[w].lock);
+
+        pthread_mutex_lock(&job_lock);
+        jobs_queued++;
+        pthread_cond_signal(&job_available);
+        pthread_mutex_unlock(&job_lock);
+        return;
+    }
+#endif
+    (void)priority;
+    run(arg);
+}
+
+#ifndef _WIN32
+// Claims and runs one part; 0 once every part has been claimed
+int runBatchPart(JobBatch* batch) {
+    pthread_mutex_lock(&batch->lock);
+    int part = batch->next < batch->count ? batch->next++ : -1;
+    pthread_mutex_unlock(&batch->lock);
+    if (part == -1) return 0;
+
+    batch->run(batch->arg, part);
+
+    pthread_mutex_lock(&batch->lock);
+    if (++batch->finished == batch->count) pthread_cond_broadcast(&batch->done);
+    pthread_mutex_unlock(&batch->lock);
+    return 1;
+}
+
+void releaseBatch(JobBatch* batch) {
+    pthread_mutex_lock(&batch->lock);
+    int last = --batch->refs == 0;
+    pthread_mutex_unlock(&batch->lock);
+    if (!last) return;
+    pthread_mutex_destroy(&batch->lock);
+    pthread_cond_destroy(&batch->done);
+    free(batch);
+}
+
+// A helper takes a single part, so that its worker looks for more urgent
+// jobs between parts
+void helpBatch(void* arg) {
+    runBatchPart(arg);
+    releaseBatch(arg);
+}
+#endif
+
+// Runs run(arg, part) for every part below count and returns when all are
+// done. The caller works through the parts too, which is what keeps a job
+// that waits on its own batch from deadlocking the pool.
+void runJobs(int priority, void (*run)(void* arg, int part), void* arg, int count) {
+#ifndef _WIN32
+    if (count > 1 && startJobWorkers() > 0) {
+        JobBatch* batch = calloc(1, sizeof(JobBatch));
+        batch->run = run;
+        batch->arg = arg;
+        batch->count = count;
+        batch->refs = count;
+        pthread_mutex_init(&batch->lock, NULL);
+        pthread_cond_init(&batch->done, NULL);
+        for (int i = 1; i < count; i++) submitJob(priority, helpBatch, batch);
+
+        while (runBatchPart(batch)) {}
+        pthread_mutex_lock(&batch->lock);
+        while (batch->finished < batch->count) pthread_cond_wait(&batch->done, &batch->lock);
+        pthread_mutex_unlock(&batch->lock);
+        releaseBatch(batch);
+        return;
+    }
+#endif
+    (void)priority;
+    for (int i = 0; i < count; i++) run(arg, i);
+}
+
+// Receipt Queue
+// Checkout appends each order to receipts.queue and hands it to the job
+// scheduler ahead of any report, so the next sale doesn't wait for
+// rendering. Tills sharing the directory share the file, so each till
+// only drops the entries it has rendered, with the store locked; anything
+// a crash leaves behind is rendered on the next start of a till or the
+// daemon. Entries are synced like the sales they belong to. Lines are
+// "id,employee_id,phone,date,payment,total,discount,manual_pct,pid:qty:price;...".
+
+void writeReceiptQueueEntry(FILE* file, const Order* order) {
+    char total[MONEY_STR_SIZE], discount[MONEY_STR_SIZE], price[MONEY_STR_SIZE];
+    fprintf(file, "%ld,%d,%s,%s,%d,%s,%s,%.2f,",
+            order->id, order->employee_id, order->customer_phone, order->date,
+            order->payment_method, formatMoney(total, order->total_amount),
+            formatMoney(discount, order->discount), order->manual_discount_percentage);
+    for (int i = 0; i < order->item_count; i++) {
+        fprintf(file, "%s%d:%d:%s", i ? ";" : "", order->items[i].product_id,
+                order->items[i].quantity, formatMoney(price, order->items[i].price));
+    }
+    fprintf(file, "\n");
+}
+
+int readReceiptQueueEntry(char* line, Order* order) {
+    memset(order, 0, sizeof(*order));
+    int consumed = 0;
+    char total[MONEY_STR_SIZE], discount[MONEY_STR_SIZE], price[MONEY_STR_SIZE];
+    if (sscanf(line, "%ld,%d,%99[^,],%29[^,],%d,%31[^,],%31[^,],%f,%n",
+               &order->id, &order->employee_id, order->customer_phone, order->date,
+               &order->payment_method, total, discount,
+               &order->manual_discount_percentage, &consumed) != 8 || consumed == 0) {
+        return 0;
+    }
+    order->total_amount = parseMoney(total);
+    order->discount = parseMoney(discount);
+    for (char* item = strtok(line + consumed, ";\r\n"); item && order->item_count < MAX_CART_ITEMS;
+         item = strtok(NULL, ";\r\n")) {
+        CartItem* c = &order->items[order->item_count];
+        if (sscanf(item, "%d:%d:%31s", &c->product_id, &c->quantity, price) != 3) return 0;
+        c->price = parseMoney(price);
+        order->item_count++;
+    }
+    return order->item_count > 0;
+}
+
+#ifndef _WIN32
+pthread_mutex_t receipt_lock = PTHREAD_MUTEX_INITIALIZER;
+#endif
+long* receipts_done = NULL;  // Rendered, but still listed in the queue file
+int receipts_done_count = 0;
+int receipts_done_capacity = 0;
+
+void receiptDone(long id) {
+#ifndef _WIN32
+    pthread_mutex_lock(&receipt_lock);
+#endif
+    if (receipts_done_count == receipts_done_capacity) {
+        receipts_done_capacity = receipts_done_capacity ? receipts_done_capacity * 2 : 16;
+        receipts_done = realloc(receipts_done, receipts_done_capacity * sizeof(long));
+    }
+    receipts_done[receipts_done_count++] = id;
+#ifndef _WIN32
+    pthread_mutex_unlock(&receipt_lock);
+#endif
+}
+
+// Failed receipts stay queued for the next start
+void renderReceiptJob(void* arg) {
+    Receipt* receipt = arg;
+    if (renderReceipt(receipt)) receiptDone(receipt->order.id);
+    free(receipt);
+}
+
+// Drops the receipts this till has rendered from the queue file. Runs on
+// the main thread, since it takes the store lock.
+void pruneReceiptQueue() {
+#ifndef _WIN32
+    pthread_mutex_lock(&receipt_lock);
+#endif
+    long* done = receipts_done;
+    int done_count = receipts_done_count;
+    receipts_done = NULL;
+    receipts_done_count = receipts_done_capacity = 0;
+#ifndef _WIN32
+    pthread_mutex_unlock(&receipt_lock);
+#endif
+    if (done_count == 0) return;
+
+    lockStore();
+    FILE* file = fopen(RECEIPT_QUEUE_FILE, "r");
+    FILE* kept = file ? fopen(RECEIPT_QUEUE_FILE ".tmp", "w") : NULL;
+    if (kept) {
+        char line[4096];
+        int kept_count = 0;
+        while (fgets(line, sizeof(line), file)) {
+            long id = strtol(line, NULL, 10);
+            int rendered = 0;
+            for (int i = 0; i < done_count && !rendered; i++) rendered = done[i] == id;
+            if (!rendered) {
+                fputs(line, kept);
+                kept_count++;
+            }
+        }
+        fclose(file);
+        file = NULL;
+        if (fclose(kept) == 0 && kept_count > 0) {
+#ifdef _WIN32
+            remove(RECEIPT_QUEUE_FILE);
+#endif
+            rename(RECEIPT_QUEUE_FILE ".tmp", RECEIPT_QUEUE_FILE);
+        } else {
+            remove(RECEIPT_QUEUE_FILE ".tmp");
+            if (kept_count == 0) remove(RECEIPT_QUEUE_FILE);
+        }
+    }
+    if (file) fclose(file);
+    unlockStore();
+    free(done);
+}
+
+// Queues anything a previous session left unrendered
+void resumeReceiptQueue() {
+#ifdef _WIN32
+    CreateDirectory("receipts", NULL);
+#else
+    mkdir("receipts", 0755);
+#endif
+    atexit(pruneReceiptQueue);
+
+    // Read in full first: without job workers each receipt renders as it
+    // is submitted
+    Receipt** pending = NULL;
+    int pending_count = 0, pending_capacity = 0;
+    lockStore();
+    FILE* file = fopen(RECEIPT_QUEUE_FILE, "r");
+    if (file) {
+        char line[4096];
+        while (fgets(line, sizeof(line), file)) {
+            Order order;
+            char filename[256];
+            if (!readReceiptQueueEntry(line, &order)) continue;
+            snprintf(filename, sizeof(filename), "receipts/receipt_%ld.pdf", order.id);
+            if (access(filename, F_OK) == 0) {
+                receiptDone(order.id);
+                continue;
+            }
+            if (pending_count == pending_capacity) {
+                pending_capacity = pending_capacity ? pending_capacity * 2 : 16;
+                pending = realloc(pending, pending_capacity * sizeof(Receipt*));
+            }
+            pending[pending_count] = malloc(sizeof(Receipt));
+            prepareReceipt(&order, pending[pending_count++]);
+        }
+        fclose(file);
+    }
+    unlockStore();
+
+    for (int i = 0; i < pending_count; i++) {
+        submitJob(JOB_PRIORITY_RECEIPT, renderReceiptJob, pending[i]);
+    }
+    free(pending);
+    pruneReceiptQueue();
+}
+
+// Queues the receipt; without job workers it is rendered right away
+void generateReceipt(Order order) {
+    char filename[256];
+    Receipt* receipt = malloc(sizeof(Receipt));
+    prepareReceipt(&order, receipt);
+    receipt->open_when_done = 1;
 
     #ifdef _WIN32
-        sprintf(print_command, "del %s", html_file);
+        sprintf(filename, "receipts\\receipt_%ld.pdf", order.id);
     #else
-        sprintf(print_command, "rm %s", html_file);
+        sprintf(filename, "receipts/receipt_%ld.pdf", order.id);
     #endif
-    system(print_command);
 
+#ifndef _WIN32
+    if (startJobWorkers() > 0) {
+        pruneReceiptQueue();
+        // The sale is already on disk; its receipt entry must be too
+        lockStore();
+        int created = access(RECEIPT_QUEUE_FILE, F_OK) != 0;
+        FILE* file = openJournal(RECEIPT_QUEUE_FILE);
+        if (file) {
+            writeReceiptQueueEntry(file, &order);
+            if (fflush(file) == 0) syncFile(fileno(file));
+            fclose(file);
+            if (created) syncDirectory(".");
+        }
+        unlockStore();
+        submitJob(JOB_PRIORITY_RECEIPT, renderReceiptJob, receipt);
+        printf("\nReceipt queued: %s\n", filename);
+        return;
+    }
+#endif
+
+    int ok = renderReceipt(receipt);
+    free(receipt);
+    if (!ok) {
+        RED_COLOR;
+        printf("\nError creating receipt file!\n");
+        RESET_COLOR;
+        return;
+    }
     printf("\nReceipt generated: %s\n", filename);
 }
 
@@ -1624,7 +3785,7 @@ void customerMenu() {
         printf("\n5. Update Customer");
         printf("\n6. Back to Main Menu");
         printf("\n\nEnter your choice: ");
-        scanf("%d", &choice);
+        promptScanf("%d", &choice);
 
         switch (choice) {
             case 1: addCustomer(); break;
@@ -1637,60 +3798,69 @@ void customerMenu() {
                 RED_COLOR;
                 printf("\nInvalid choice!\n");
                 RESET_COLOR;
-                sleep(1);
+                pauseFor(1);
         }
     }
 }
 
 void addCustomer() {
     Customer new_customer;
+    char phone[MAX_STRING], name[MAX_STRING], address[MAX_STRING];
     printHeader("ADD NEW CUSTOMER");
 
     printf("\nEnter customer details:\n");
     printf("Phone Number: ");
-    scanf("%s", new_customer.phone);
-    getchar(); 
+    promptScanf("%s", phone);
+    promptChar(); 
 
     // Check if phone number already exists
-    for (int i = 0; i < customer_count; i++) {
-        if (strcmp(customers[i].phone, new_customer.phone) == 0) {
-            RED_COLOR;
-            printf("\nCustomer with this phone number already exists!\n");
-            RESET_COLOR;
-            sleep(2);
-            return;
-        }
+    int i = findCustomerIndex(phone);
+    if (i != -1) {
+        RED_COLOR;
+        printf("\nCustomer with this phone number already exists!\n");
+        RESET_COLOR;
+        pauseFor(2);
+        return;
     }
 
     printf("Name: ");
-    fgets(new_customer.name, MAX_STRING, stdin);
-    new_customer.name[strcspn(new_customer.name, "\n")] = 0;
+    promptLine(name, MAX_STRING);
+    name[strcspn(name, "\n")] = 0;
 
     printf("Address: ");
-    fgets(new_customer.address, MAX_STRING, stdin);
-    new_customer.address[strcspn(new_customer.address, "\n")] = 0;
+    promptLine(address, MAX_STRING);
+    address[strcspn(address, "\n")] = 0;
 
+    new_customer.phone = internString(phone);
+    new_customer.name = internString(name);
+    new_customer.address = internString(address);
     new_customer.total_spending = 0;
     new_customer.loyalty_points = 0;
+    new_customer.last_loyalty_milestone = 0;
+    new_customer.dirty = 0;
 
+    ensureCustomerCapacity(customer_count + 1);
     customers[customer_count++] = new_customer;
-    saveCustomers();
+    indexCustomer(customer_count - 1);
+    markCustomerDirty(customer_count - 1);
+    flushCustomers();
 
     GREEN_COLOR;
     printf("\nCustomer added successfully!\n");
     RESET_COLOR;
-    sleep(2);
+    pauseFor(2);
 }
 
 
 void viewCustomerList() {
+    refreshStore();
     printHeader("CUSTOMER LIST");
 
     if (customer_count == 0) {
         YELLOW_COLOR;
         printf("\nNo customers registered!\n");
         RESET_COLOR;
-        sleep(2);
+        pauseFor(2);
         return;
     }
 
@@ -1699,10 +3869,10 @@ void viewCustomerList() {
     printLine();
 
     for (int i = 0; i < customer_count; i++) {
-        printf("%-15s %-20s %-15.2f %-15d\n",
+        printf("%-15s %-20s %-15s %-15d\n",
                customers[i].phone,
                customers[i].name,
-               customers[i].total_spending,
+               moneyStr(customers[i].total_spending),
                customers[i].loyalty_points);
     }
 
@@ -1713,7 +3883,7 @@ void viewCustomerList() {
     printf("\nEnter your choice: ");
 
     int choice;
-    scanf("%d", &choice);
+    promptScanf("%d", &choice);
 
     switch(choice) {
         case 1:
@@ -1727,165 +3897,261 @@ void viewCustomerList() {
     }
 
     printf("\nPress Enter to continue...");
-    getchar();
-    getchar();
+    promptChar();
+    promptChar();
 }
 
-void generateCustomerListPDF() {
-    char filename[256];
-    char temp_html[256];
-    char command[512];
-    time_t t = time(NULL);
-    struct tm* tm = localtime(&t);
-    char date_str[20];
-    strftime(date_str, sizeof(date_str), "%Y%m%d_%H%M%S", tm);
-    
-    #ifdef _WIN32
-        CreateDirectory("reports", NULL);
-        sprintf(temp_html, "temp_%s.html", date_str);
-        sprintf(filename, "reports\\customer_list_%s.pdf", date_str);
-        sprintf(command, "wkhtmltopdf %s %s && del %s", temp_html, filename, temp_html);
-    #else
-        system("mkdir -p reports");
-        sprintf(temp_html, "temp_%s.html", date_str);
-        sprintf(filename, "reports/customer_list_%s.pdf", date_str);
-        sprintf(command, "wkhtmltopdf %s %s && rm %s", temp_html, filename, temp_html);
-    #endif
+// Report Rendering
+// PDF reports are written as HTML to a temp file unique to this process,
+// then converted by wkhtmltopdf. renderReportJobs runs a batch of
+// conversions on the job scheduler, so a full export costs about as long
+// as its slowest report. The menus' single reports convert in the
+// background (see finishReportPDF).
 
-    FILE* file = fopen(temp_html, "w");
-    if (!file) return;
+// reports/<name>_<timestamp>.<ext>, creating the directory
+void reportPath(char* path, size_t size, const char* name, const char* ext) {
+    char date_str[20];
+    time_t t = time(NULL);
+    strftime(date_str, sizeof(date_str), "%Y%m%d_%H%M%S", localtime(&t));
+#ifdef _WIN32
+    CreateDirectory("reports", NULL);
+    snprintf(path, size, "reports\\%s_%s.%s", name, date_str, ext);
+#else
+    mkdir("reports", 0755);
+    snprintf(path, size, "reports/%s_%s.%s", name, date_str, ext);
+#endif
+}
 
-    fprintf(file, "<html><head><style>\n");
-    fprintf(file, "body { font-family: Arial; padding: 20px; }\n");
-    fprintf(file, "table { width: 100%%; border-collapse: collapse; }\n");
-    fprintf(file, "th, td { border: 1px solid #ddd; padding: 8px; text-align: left; }\n");
-    fprintf(file, "th { background: #4CAF50; color: white; }\n");
-    fprintf(file, "</style></head><body>\n");
-    
-    fprintf(file, "<h1>Customer List</h1>\n");
-    fprintf(file, "<p>Generated on: %s</p>\n", getCurrentDateTime());
-    
-    fprintf(file, "<table>\n");
-    fprintf(file, "<tr><th>Phone</th><th>Name</th><th>Total Spending</th><th>Loyalty Points</th></tr>\n");
+void tempReportPath(char* path, size_t size) {
+    static int sequence = 0;
+#ifdef _WIN32
+    long pid = (long)GetCurrentProcessId();
+#else
+    long pid = (long)getpid();
+#endif
+    snprintf(path, size, "temp_%ld_%d_%ld.html", pid, ++sequence, (long)time(NULL));
+}
 
-    for (int i = 0; i < customer_count; i++) {
-        fprintf(file, "<tr><td>%s</td><td>%s</td><td>%.2f</td><td>%d</td></tr>\n",
-                customers[i].phone,
-                customers[i].name,
-                customers[i].total_spending,
-                customers[i].loyalty_points);
+// Converts one job's HTML to its PDF and removes the HTML
+void renderReportJob(void* arg, int part) {
+    ReportJob* job = (ReportJob*)arg + part;
+#ifdef _WIN32
+    char command[600];
+    sprintf(command, "wkhtmltopdf --quiet %s %s", job->html, job->pdf);
+    job->ok = system(command) == 0;
+#else
+    // Reaped by pid, which leaves other children (such as the receipt
+    // viewer) to their own waitpid
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0) {
+        execlp("wkhtmltopdf", "wkhtmltopdf", "--quiet", job->html, job->pdf, (char*)NULL);
+        _exit(127);
     }
+    int status;
+    job->ok = pid > 0 && waitpid(pid, &status, 0) == pid &&
+              WIFEXITED(status) && WEXITSTATUS(status) == 0;
+#endif
+    remove(job->html);
+}
 
-    fprintf(file, "</table></body></html>\n");
-    fclose(file);
+// Converts every job's HTML to its PDF and removes the HTML. Sets each
+// job's ok flag and returns how many PDFs were written.
+int renderReportJobs(ReportJob* jobs, int count) {
+    OutputBuffer* reply = pauseServerRequest();
+    runJobs(JOB_PRIORITY_REPORT, renderReportJob, jobs, count);
+    resumeServerRequest(reply);
 
-    system(command);
+    int rendered = 0;
+    for (int i = 0; i < count; i++) rendered += jobs[i].ok;
+    return rendered;
+}
 
-    GREEN_COLOR;
-    printf("\nCustomer List PDF generated: %s\n", filename);
-    RESET_COLOR;
+// Queued reports that failed to render. Workers leave the terminal to the
+// menu; showReportFailures prints these on the main thread.
+#ifndef _WIN32
+pthread_mutex_t report_failure_lock = PTHREAD_MUTEX_INITIALIZER;
+#endif
+ReportJob** report_failures = NULL;
+int report_failure_count = 0;
+int report_failure_capacity = 0;
+
+void renderQueuedReport(void* arg) {
+    ReportJob* job = arg;
+    if (renderReportJobs(job, 1)) {
+        free(job);
+        return;
+    }
+#ifndef _WIN32
+    pthread_mutex_lock(&report_failure_lock);
+#endif
+    if (report_failure_count == report_failure_capacity) {
+        report_failure_capacity = report_failure_capacity ? report_failure_capacity * 2 : 8;
+        report_failures = realloc(report_failures, report_failure_capacity * sizeof(ReportJob*));
+    }
+    report_failures[report_failure_count++] = job;
+#ifndef _WIN32
+    pthread_mutex_unlock(&report_failure_lock);
+#endif
 }
 
-void generateCustomerListCSV() {
-    char filename[256];
-    time_t t = time(NULL);
-    struct tm* tm = localtime(&t);
-    char date_str[20];
-    strftime(date_str, sizeof(date_str), "%Y%m%d_%H%M%S", tm);
+// Reports queued conversions that have failed since the last call
+void showReportFailures() {
+#ifndef _WIN32
+    pthread_mutex_lock(&report_failure_lock);
+#endif
+    ReportJob** failures = report_failures;
+    int count = report_failure_count;
+    report_failures = NULL;
+    report_failure_count = report_failure_capacity = 0;
+#ifndef _WIN32
+    pthread_mutex_unlock(&report_failure_lock);
+#endif
+
+    for (int i = 0; i < count; i++) {
+        if (headless) {
+            commandError("cannot generate", failures[i]->pdf);
+        } else {
+            RED_COLOR;
+            printf("\nError generating %s. Please make sure wkhtmltopdf is installed.\n", failures[i]->pdf);
+            RESET_COLOR;
+        }
+        free(failures[i]);
+    }
+    free(failures);
+}
+
+// Sets up a single report; the caller writes job->html, then calls
+// finishReportPDF with whether that succeeded. The conversion is queued
+// behind any receipts, and a failure is reported on the next screen.
+void newReportJob(ReportJob* job, const char* name) {
+    memset(job, 0, sizeof(*job));
+    reportPath(job->pdf, sizeof(job->pdf), name, "pdf");
+    tempReportPath(job->html, sizeof(job->html));
+}
+
+int finishReportPDF(ReportJob* job, int written) {
+    if (!written) {
+        remove(job->html);
+        RED_COLOR;
+        printf("\nError creating temporary file!\n");
+        RESET_COLOR;
+        return 0;
+    }
+    ReportJob* queued = malloc(sizeof(ReportJob));
+    *queued = *job;
+    submitJob(JOB_PRIORITY_REPORT, renderQueuedReport, queued);
+    return 1;
+}
+
+int writeCustomerListHTML(const char* path) {
+    OutputBuffer out;
+    if (!outOpen(&out, path)) return 0;
+
+    outPrintf(&out, "<html><head><style>\n");
+    outPrintf(&out, "body { font-family: Arial; padding: 20px; }\n");
+    outPrintf(&out, "table { width: 100%%; border-collapse: collapse; }\n");
+    outPrintf(&out, "th, td { border: 1px solid #ddd; padding: 8px; text-align: left; }\n");
+    outPrintf(&out, "th { background: #4CAF50; color: white; }\n");
+    outPrintf(&out, "</style></head><body>\n");
     
-    #ifdef _WIN32
-        CreateDirectory("reports", NULL);
-        sprintf(filename, "reports\\customer_list_%s.csv", date_str);
-    #else
-        system("mkdir -p reports");
-        sprintf(filename, "reports/customer_list_%s.csv", date_str);
-    #endif
+    outPrintf(&out, "<h1>Customer List</h1>\n");
+    outPrintf(&out, "<p>Generated on: %s</p>\n", getCurrentDateTime());
+    
+    outPrintf(&out, "<table>\n");
+    outPrintf(&out, "<tr><th>Phone</th><th>Name</th><th>Total Spending</th><th>Loyalty Points</th></tr>\n");
 
-    FILE* file = fopen(filename, "w");
-    if (!file) return;
+    for (int i = 0; i < customer_count; i++) {
+        outPrintf(&out, "<tr><td>%s</td><td>%s</td><td>%s</td><td>%d</td></tr>\n",
+                customers[i].phone,
+                customers[i].name,
+                moneyStr(customers[i].total_spending),
+                customers[i].loyalty_points);
+    }
+
+    outPrintf(&out, "</table></body></html>\n");
+    return outClose(&out) == 0;
+}
+
+void generateCustomerListPDF() {
+    ReportJob job;
+    newReportJob(&job, "customer_list");
+    if (!finishReportPDF(&job, writeCustomerListHTML(job.html))) return;
+
+    GREEN_COLOR;
+    printf("\nCustomer List PDF queued: %s\n", job.pdf);
+    RESET_COLOR;
+}
+
+void generateCustomerListCSV() {
+    char filename[256];
+    reportPath(filename, sizeof(filename), "customer_list", "csv");
+
+    OutputBuffer out;
+    if (!outOpen(&out, filename)) return;
 
-    fprintf(file, "Customer List\n");
-    fprintf(file, "Generated on: %s\n\n", getCurrentDateTime());
-    fprintf(file, "Phone,Name,Total Spending,Loyalty Points\n");
+    outPrintf(&out, "Customer List\n");
+    outPrintf(&out, "Generated on: %s\n\n", getCurrentDateTime());
+    outPrintf(&out, "Phone,Name,Total Spending,Loyalty Points\n");
 
     for (int i = 0; i < customer_count; i++) {
-        fprintf(file, "%s,%s,%.2f,%d\n",
+        outPrintf(&out, "%s,%s,%s,%d\n",
                 customers[i].phone,
                 customers[i].name,
-                customers[i].total_spending,
+                moneyStr(customers[i].total_spending),
                 customers[i].loyalty_points);
     }
 
-    fclose(file);
+    outClose(&out);
     GREEN_COLOR;
     printf("\nCustomer List CSV generated: %s\n", filename);
     RESET_COLOR;
 }
 void viewCustomerDetails() {
+    refreshStore();
     printHeader("CUSTOMER DETAILS WITH HISTORY");
 
     if (customer_count == 0) {
         YELLOW_COLOR;
         printf("\nNo customers registered!\n");
         RESET_COLOR;
-        sleep(2);
+        pauseFor(2);
         return;
     }
 
-    printf("\n%-15s %-20s %-20s %-15s %-15s %s\n", 
+    printf("\n%-15s %-20s %-20s %-15s %-15s %s\n",
            "Phone", "Name", "Address", "Total Spend", "Loyalty Points", "Purchase History");
     printLine();
 
+    SalesLedger ledger;
+    loadSalesLedger(&ledger);
+
     for (int i = 0; i < customer_count; i++) {
-        printf("\n%-15s %-20s %-20s %-15.2f %-15d\n",
+        printf("\n%-15s %-20s %-20s %-15s %-15d\n",
                customers[i].phone,
                customers[i].name,
                customers[i].address,
-               customers[i].total_spending,
+               moneyStr(customers[i].total_spending),
                customers[i].loyalty_points);
 
         printf("\nRecent Purchases:\n");
-        printf("%-20s %-10s %-10s %-15s %-10s\n", 
+        printf("%-20s %-10s %-10s %-15s %-10s\n",
                "Date", "Order ID", "Items", "Amount", "Discount");
-        
-        FILE* sales_file = fopen("sales.txt", "r");
-        if (sales_file) {
-            Order order;
-            while (fscanf(sales_file, "%ld,%[^,],%d,%[^,],%f,%f\n",
-                       &order.id,
-                       order.customer_phone,
-                       &order.employee_id,
-                       order.date,
-                       &order.total_amount,
-                       &order.discount) != EOF) {
-                
-                if (strcmp(order.customer_phone, customers[i].phone) == 0) {
-                    int items_count = 0;
-                    FILE* items_file = fopen("sales_items.txt", "r");
-                    if (items_file) {
-                        int order_id, product_id, quantity;
-                        float price;
-                        while (fscanf(items_file, "%d,%d,%d,%f\n", 
-                                    &order_id, &product_id, &quantity, &price) != EOF) {
-                            if (order_id == order.id) {
-                                items_count += quantity;
-                            }
-                        }
-                        fclose(items_file);
-                    }
-                    
-                    printf("%-20s %-10ld %-10d %-15.2f %-10.2f\n",
-                           order.date,
-                           order.id,
-                           items_count,
-                           order.total_amount,
-                           order.discount);
-                }
-            }
-            fclose(sales_file);
+
+        int first;
+        int count = ledgerFindCustomerOrders(&ledger, customers[i].phone, &first);
+        for (int k = 0; k < count; k++) {
+            LedgerOrder* order = &ledger.orders[ledger.by_customer[first + k]];
+            printf("%-20s %-10ld %-10d %-15s %-10s\n",
+                   order->date,
+                   order->id,
+                   order->item_units,
+                   moneyStr(order->total_amount),
+                   moneyStr(order->discount));
         }
         printLine();
     }
+    freeSalesLedger(&ledger);
 
     printf("\nExport Options:\n");
     printf("1. Generate Detailed PDF Report\n");
@@ -1894,7 +4160,7 @@ void viewCustomerDetails() {
     printf("\nEnter your choice: ");
 
     int choice;
-    scanf("%d", &choice);
+    promptScanf("%d", &choice);
 
     switch(choice) {
         case 1:
@@ -1909,108 +4175,74 @@ void viewCustomerDetails() {
             RED_COLOR;
             printf("\nInvalid choice!\n");
             RESET_COLOR;
-            sleep(1);
+            pauseFor(1);
     }
 
     printf("\nPress Enter to continue...");
-    getchar();
-    getchar();
+    promptChar();
+    promptChar();
 }
  
 
-void generateDetailedCustomerListPDF() {
-    char filename[256];
-    char command[512];
-    char temp_html[256];
-    time_t t = time(NULL);
-    struct tm* tm = localtime(&t);
-    char date_str[20];
-    strftime(date_str, sizeof(date_str), "%Y%m%d_%H%M%S", tm);
+int writeDetailedCustomerListHTML(const char* path) {
+    OutputBuffer out;
+    if (!outOpen(&out, path)) return 0;
+
+    outPrintf(&out, "<html><head><style>\n");
+    outPrintf(&out, "body { font-family: Arial; padding: 20px; }\n");
+    outPrintf(&out, "table { width: 100%%; border-collapse: collapse; margin: 10px 0; }\n");
+    outPrintf(&out, "th, td { border: 1px solid #ddd; padding: 8px; text-align: left; }\n");
+    outPrintf(&out, "th { background: #4CAF50; color: white; }\n");
+    outPrintf(&out, ".customer-card { border: 1px solid #ddd; margin: 20px 0; padding: 15px; }\n");
+    outPrintf(&out, ".purchase-history { margin-top: 10px; }\n");
+    outPrintf(&out, "</style></head><body>\n");
     
-    #ifdef _WIN32
-        CreateDirectory("reports", NULL);
-        sprintf(temp_html, "temp_%s.html", date_str);
-        sprintf(filename, "reports\\customer_details_%s.pdf", date_str);
-        sprintf(command, "wkhtmltopdf %s %s && del %s", temp_html, filename, temp_html);
-    #else
-        system("mkdir -p reports");
-        sprintf(temp_html, "temp_%s.html", date_str);
-        sprintf(filename, "reports/customer_list_%s.pdf", date_str);
-        sprintf(command, "wkhtmltopdf %s %s && rm %s", temp_html, filename, temp_html);
-    #endif
-
-    FILE* file = fopen(temp_html, "w");
-    if (!file) return;
+    outPrintf(&out, "<h1>Detailed Customer Report</h1>\n");
+    outPrintf(&out, "<p>Generated on: %s</p>\n", getCurrentDateTime());
 
-    fprintf(file, "<html><head><style>\n");
-    fprintf(file, "body { font-family: Arial; padding: 20px; }\n");
-    fprintf(file, "table { width: 100%%; border-collapse: collapse; margin: 10px 0; }\n");
-    fprintf(file, "th, td { border: 1px solid #ddd; padding: 8px; text-align: left; }\n");
-    fprintf(file, "th { background: #4CAF50; color: white; }\n");
-    fprintf(file, ".customer-card { border: 1px solid #ddd; margin: 20px 0; padding: 15px; }\n");
-    fprintf(file, ".purchase-history { margin-top: 10px; }\n");
-    fprintf(file, "</style></head><body>\n");
-    
-    fprintf(file, "<h1>Detailed Customer Report</h1>\n");
-    fprintf(file, "<p>Generated on: %s</p>\n", getCurrentDateTime());
+    SalesLedger ledger;
+    loadSalesLedger(&ledger);
 
     for (int i = 0; i < customer_count; i++) {
-        fprintf(file, "<div class='customer-card'>\n");
-        fprintf(file, "<h2>Customer Details</h2>\n");
-        fprintf(file, "<table>\n");
-        fprintf(file, "<tr><th>Phone</th><td>%s</td></tr>\n", customers[i].phone);
-        fprintf(file, "<tr><th>Name</th><td>%s</td></tr>\n", customers[i].name);
-        fprintf(file, "<tr><th>Address</th><td>%s</td></tr>\n", customers[i].address);
-        fprintf(file, "<tr><th>Total Spending</th><td>%.2f</td></tr>\n", customers[i].total_spending);
-        fprintf(file, "<tr><th>Loyalty Points</th><td>%d</td></tr>\n", customers[i].loyalty_points);
-        fprintf(file, "</table>\n");
-
-        fprintf(file, "<div class='purchase-history'>\n");
-        fprintf(file, "<h3>Purchase History</h3>\n");
-        fprintf(file, "<table>\n");
-        fprintf(file, "<tr><th>Date</th><th>Order ID</th><th>Items</th><th>Amount</th><th>Discount</th><th>Net Amount</th></tr>\n");
-
-        FILE* sales_file = fopen("sales.txt", "r");
-        if (sales_file) {
-            Order order;
-            while (fscanf(sales_file, "%ld,%[^,],%d,%[^,],%f,%f\n",
-                       &order.id, order.customer_phone, &order.employee_id,
-                       order.date, &order.total_amount, &order.discount) != EOF) {
-                
-                if (strcmp(order.customer_phone, customers[i].phone) == 0) {
-                    int items_count = 0;
-                    FILE* items_file = fopen("sales_items.txt", "r");
-                    if (items_file) {
-                        int order_id, product_id, quantity;
-                        float price;
-                        while (fscanf(items_file, "%d,%d,%d,%f\n", 
-                                    &order_id, &product_id, &quantity, &price) != EOF) {
-                            if (order_id == order.id) {
-                                items_count += quantity;
-                            }
-                        }
-                        fclose(items_file);
-                    }
-                    
-                    fprintf(file, "<tr><td>%s</td><td>%ld</td><td>%d</td><td>%.2f</td><td>%.2f</td><td>%.2f</td></tr>\n",
-                            order.date, order.id, items_count, 
-                            order.total_amount, order.discount,
-                            order.total_amount - order.discount);
-                }
-            }
-            fclose(sales_file);
+        outPrintf(&out, "<div class='customer-card'>\n");
+        outPrintf(&out, "<h2>Customer Details</h2>\n");
+        outPrintf(&out, "<table>\n");
+        outPrintf(&out, "<tr><th>Phone</th><td>%s</td></tr>\n", customers[i].phone);
+        outPrintf(&out, "<tr><th>Name</th><td>%s</td></tr>\n", customers[i].name);
+        outPrintf(&out, "<tr><th>Address</th><td>%s</td></tr>\n", customers[i].address);
+        outPrintf(&out, "<tr><th>Total Spending</th><td>%s</td></tr>\n", moneyStr(customers[i].total_spending));
+        outPrintf(&out, "<tr><th>Loyalty Points</th><td>%d</td></tr>\n", customers[i].loyalty_points);
+        outPrintf(&out, "</table>\n");
+
+        outPrintf(&out, "<div class='purchase-history'>\n");
+        outPrintf(&out, "<h3>Purchase History</h3>\n");
+        outPrintf(&out, "<table>\n");
+        outPrintf(&out, "<tr><th>Date</th><th>Order ID</th><th>Items</th><th>Amount</th><th>Discount</th><th>Net Amount</th></tr>\n");
+
+        int first;
+        int count = ledgerFindCustomerOrders(&ledger, customers[i].phone, &first);
+        for (int k = 0; k < count; k++) {
+            LedgerOrder* order = &ledger.orders[ledger.by_customer[first + k]];
+            outPrintf(&out, "<tr><td>%s</td><td>%ld</td><td>%d</td><td>%s</td><td>%s</td><td>%s</td></tr>\n",
+                    order->date, order->id, order->item_units,
+                    moneyStr(order->total_amount), moneyStr(order->discount),
+                    moneyStr(order->total_amount - order->discount));
         }
-        fprintf(file, "</table></div></div>\n");
+        outPrintf(&out, "</table></div></div>\n");
     }
+    freeSalesLedger(&ledger);
 
-    fprintf(file, "</body></html>\n");
-    fclose(file);
+    outPrintf(&out, "</body></html>\n");
+    return outClose(&out) == 0;
+}
 
-    sprintf(command, "wkhtmltopdf %s %s && rm %s", temp_html, filename, temp_html);
-    system(command);
+void generateDetailedCustomerListPDF() {
+    ReportJob job;
+    newReportJob(&job, "customer_details");
+    if (!finishReportPDF(&job, writeDetailedCustomerListHTML(job.html))) return;
 
     GREEN_COLOR;
-    printf("\nDetailed PDF Report generated: %s\n", filename);
+    printf("\nDetailed PDF Report queued: %s\n", job.pdf);
     RESET_COLOR;
 }
 void generateDetailedCustomerListCSV() {
@@ -2026,62 +4258,45 @@ void generateDetailedCustomerListCSV() {
         sprintf(filename, "reports/customer_details_%s.csv", date_str);
     #endif
 
-    FILE* file = fopen(filename, "w");
-    if (!file) {
+    OutputBuffer out;
+    if (!outOpen(&out, filename)) {
         RED_COLOR;
         printf("\nError creating CSV file!\n");
         RESET_COLOR;
         return;
     }
 
-    fprintf(file, "CUSTOMER DETAILS REPORT\n");
-    fprintf(file, "Generated on: %s\n\n", getCurrentDateTime());
+    outPrintf(&out, "CUSTOMER DETAILS REPORT\n");
+    outPrintf(&out, "Generated on: %s\n\n", getCurrentDateTime());
+
+    SalesLedger ledger;
+    loadSalesLedger(&ledger);
 
     for (int i = 0; i < customer_count; i++) {
-        fprintf(file, "Customer Information\n");
-        fprintf(file, "Phone,%s\n", customers[i].phone);
-        fprintf(file, "Name,%s\n", customers[i].name);
-        fprintf(file, "Address,%s\n", customers[i].address);
-        fprintf(file, "Total Spending,%.2f\n", customers[i].total_spending);
-        fprintf(file, "Loyalty Points,%d\n\n", customers[i].loyalty_points);
-
-        fprintf(file, "Purchase History\n");
-        fprintf(file, "Date,Order ID,Items,Amount,Discount,Net Amount\n");
-
-        FILE* sales_file = fopen("sales.txt", "r");
-        if (sales_file) {
-            Order order;
-            while (fscanf(sales_file, "%ld,%[^,],%d,%[^,],%f,%f\n",
-                       &order.id, order.customer_phone, &order.employee_id,
-                       order.date, &order.total_amount, &order.discount) != EOF) {
-                
-                if (strcmp(order.customer_phone, customers[i].phone) == 0) {
-                    int items_count = 0;
-                    FILE* items_file = fopen("sales_items.txt", "r");
-                    if (items_file) {
-                        int order_id, product_id, quantity;
-                        float price;
-                        while (fscanf(items_file, "%d,%d,%d,%f\n", 
-                                    &order_id, &product_id, &quantity, &price) != EOF) {
-                            if (order_id == order.id) {
-                                items_count += quantity;
-                            }
-                        }
-                        fclose(items_file);
-                    }
-                    
-                    fprintf(file, "%s,%ld,%d,%.2f,%.2f,%.2f\n",
-                            order.date, order.id, items_count, 
-                            order.total_amount, order.discount,
-                            order.total_amount - order.discount);
-                }
-            }
-            fclose(sales_file);
+        outPrintf(&out, "Customer Information\n");
+        outPrintf(&out, "Phone,%s\n", customers[i].phone);
+        outPrintf(&out, "Name,%s\n", customers[i].name);
+        outPrintf(&out, "Address,%s\n", customers[i].address);
+        outPrintf(&out, "Total Spending,%s\n", moneyStr(customers[i].total_spending));
+        outPrintf(&out, "Loyalty Points,%d\n\n", customers[i].loyalty_points);
+
+        outPrintf(&out, "Purchase History\n");
+        outPrintf(&out, "Date,Order ID,Items,Amount,Discount,Net Amount\n");
+
+        int first;
+        int count = ledgerFindCustomerOrders(&ledger, customers[i].phone, &first);
+        for (int k = 0; k < count; k++) {
+            LedgerOrder* order = &ledger.orders[ledger.by_customer[first + k]];
+            outPrintf(&out, "%s,%ld,%d,%s,%s,%s\n",
+                    order->date, order->id, order->item_units,
+                    moneyStr(order->total_amount), moneyStr(order->discount),
+                    moneyStr(order->total_amount - order->discount));
         }
-        fprintf(file, "\n\n"); 
+        outPrintf(&out, "\n\n");
     }
+    freeSalesLedger(&ledger);
 
-    fclose(file);
+    outClose(&out);
     GREEN_COLOR;
     printf("\nDetailed CSV Report generated: %s\n", filename);
     RESET_COLOR;
@@ -2090,11 +4305,12 @@ void searchCustomer() {
     char search_term[MAX_STRING];
     int found = 0;
     
+    refreshStore();
     printHeader("SEARCH CUSTOMER");
     
     printf("\nEnter customer name or phone number: ");
-    getchar();
-    fgets(search_term, MAX_STRING, stdin);
+    promptChar();
+    promptLine(search_term, MAX_STRING);
     search_term[strcspn(search_term, "\n")] = 0;
     
     for (int i = 0; i < customer_count; i++) {
@@ -2105,7 +4321,7 @@ void searchCustomer() {
             printf("\nPhone: %s", customers[i].phone);
             printf("\nName: %s", customers[i].name);
             printf("\nAddress: %s", customers[i].address);
-            printf("\nTotal Spending: %.2f", customers[i].total_spending);
+            printf("\nTotal Spending: %s", moneyStr(customers[i].total_spending));
             printf("\nLoyalty Points: %d\n", customers[i].loyalty_points);
             printLine();
 
@@ -2113,52 +4329,30 @@ void searchCustomer() {
             printf("%-20s %-10s %-10s %-15s %-10s %-10s\n", 
                    "Date", "Order ID", "Items", "Amount", "Discount", "Net Amount");
             printLine();
-            
-            FILE* sales_file = fopen("sales.txt", "r");
-            if (sales_file) {
-                Order order;
-                while (fscanf(sales_file, "%ld,%[^,],%d,%[^,],%f,%f\n",
-                           &order.id,
-                           order.customer_phone,
-                           &order.employee_id,
-                           order.date,
-                           &order.total_amount,
-                           &order.discount) != EOF) {
-                    
-                    if (strcmp(order.customer_phone, search_term) == 0) {
-                        int items_count = 0;
-                        FILE* items_file = fopen("sales_items.txt", "r");
-                        if (items_file) {
-                            int order_id, product_id, quantity;
-                            float price;
-                            while (fscanf(items_file, "%d,%d,%d,%f\n", 
-                                        &order_id, &product_id, &quantity, &price) != EOF) {
-                                if (order_id == order.id) {
-                                    items_count += quantity;
-                                }
-                            }
-                            fclose(items_file);
-                        }
-                        
-                        printf("%-20s %-10ld %-10d %-15.2f %-10.2f %-10.2f\n",
-                               order.date,
-                               order.id,
-                               items_count,
-                               order.total_amount,
-                               order.discount,
-                               order.total_amount - order.discount);
-                    }
-                }
-                fclose(sales_file);
+
+            SalesLedger ledger;
+            loadSalesLedger(&ledger);
+            int first;
+            int count = ledgerFindCustomerOrders(&ledger, search_term, &first);
+            for (int k = 0; k < count; k++) {
+                LedgerOrder* order = &ledger.orders[ledger.by_customer[first + k]];
+                printf("%-20s %-10ld %-10d %-15s %-10s %-10s\n",
+                       order->date,
+                       order->id,
+                       order->item_units,
+                       moneyStr(order->total_amount),
+                       moneyStr(order->discount),
+                       moneyStr(order->total_amount - order->discount));
             }
-            
+            freeSalesLedger(&ledger);
+
             printf("\nExport Options:\n");
             printf("1. Generate PDF Report\n");
             printf("2. Back\n");
             printf("\nEnter your choice: ");
             
             int choice;
-            scanf("%d", &choice);
+            promptScanf("%d", &choice);
             
             switch(choice) {
                 case 1:
@@ -2171,7 +4365,7 @@ void searchCustomer() {
                     RED_COLOR;
                     printf("\nInvalid choice!\n");
                     RESET_COLOR;
-                    sleep(1);
+                    pauseFor(1);
             }
             break;  
         }
@@ -2184,103 +4378,67 @@ void searchCustomer() {
     }
     
     printf("\nPress Enter to continue...");
-    getchar();
-    getchar();
+    promptChar();
+    promptChar();
 }
 
-void generateCustomerSearchPDF(const char* phone) {
-    char filename[256];
-    char temp_html[256];
-    char command[512];
-    time_t t = time(NULL);
-    struct tm* tm = localtime(&t);
-    char date_str[20];
-    strftime(date_str, sizeof(date_str), "%Y%m%d_%H%M%S", tm);
-    
-    #ifdef _WIN32
-        CreateDirectory("reports", NULL);
-        sprintf(temp_html, "temp_%s.html", date_str);
-        sprintf(filename, "reports\\customer_search_%s.pdf", date_str);
-        sprintf(command, "wkhtmltopdf %s %s && del %s", temp_html, filename, temp_html);
-    #else
-        system("mkdir -p reports");
-        sprintf(temp_html, "temp_%s.html", date_str);
-        sprintf(filename, "reports/customer_search_%s.pdf", date_str);
-        sprintf(command, "wkhtmltopdf %s %s && rm %s", temp_html, filename, temp_html);
-    #endif
-
-    FILE* file = fopen(temp_html, "w");
-    if (!file) return;
+int writeCustomerSearchHTML(const char* phone, const char* path) {
+    OutputBuffer out;
+    if (!outOpen(&out, path)) return 0;
 
     // Write HTML content
-    fprintf(file, "<html><head><style>\n");
-    fprintf(file, "body { font-family: Arial; padding: 20px; }\n");
-    fprintf(file, "table { width: 100%%; border-collapse: collapse; margin: 20px 0; }\n");
-    fprintf(file, "th, td { border: 1px solid #ddd; padding: 8px; text-align: left; }\n");
-    fprintf(file, "th { background: #4CAF50; color: white; }\n");
-    fprintf(file, ".customer-info { margin-bottom: 30px; }\n");
-    fprintf(file, "</style></head><body>\n");
+    outPrintf(&out, "<html><head><style>\n");
+    outPrintf(&out, "body { font-family: Arial; padding: 20px; }\n");
+    outPrintf(&out, "table { width: 100%%; border-collapse: collapse; margin: 20px 0; }\n");
+    outPrintf(&out, "th, td { border: 1px solid #ddd; padding: 8px; text-align: left; }\n");
+    outPrintf(&out, "th { background: #4CAF50; color: white; }\n");
+    outPrintf(&out, ".customer-info { margin-bottom: 30px; }\n");
+    outPrintf(&out, "</style></head><body>\n");
 
     // Find customer
-    for (int i = 0; i < customer_count; i++) {
-        if (strcmp(customers[i].phone, phone) == 0) {
-            // Customer details
-            fprintf(file, "<div class='customer-info'>\n");
-            fprintf(file, "<h2>Customer Details</h2>\n");
-            fprintf(file, "<p><strong>Phone:</strong> %s</p>\n", customers[i].phone);
-            fprintf(file, "<p><strong>Name:</strong> %s</p>\n", customers[i].name);
-            fprintf(file, "<p><strong>Address:</strong> %s</p>\n", customers[i].address);
-            fprintf(file, "<p><strong>Total Spending:</strong> %.2f</p>\n", customers[i].total_spending);
-            fprintf(file, "<p><strong>Loyalty Points:</strong> %d</p>\n", customers[i].loyalty_points);
-            fprintf(file, "</div>\n");
-
-            // Purchase history
-            fprintf(file, "<h2>Purchase History</h2>\n");
-            fprintf(file, "<table>\n");
-            fprintf(file, "<tr><th>Date</th><th>Order ID</th><th>Items</th><th>Amount</th><th>Discount</th><th>Net Amount</th></tr>\n");
-
-            FILE* sales_file = fopen("sales.txt", "r");
-            if (sales_file) {
-                Order order;
-                while (fscanf(sales_file, "%ld,%[^,],%d,%[^,],%f,%f\n",
-                           &order.id, order.customer_phone, &order.employee_id,
-                           order.date, &order.total_amount, &order.discount) != EOF) {
-                    
-                    if (strcmp(order.customer_phone, phone) == 0) {
-                        int items_count = 0;
-                        FILE* items_file = fopen("sales_items.txt", "r");
-                        if (items_file) {
-                            int order_id, product_id, quantity;
-                            float price;
-                            while (fscanf(items_file, "%d,%d,%d,%f\n", 
-                                        &order_id, &product_id, &quantity, &price) != EOF) {
-                                if (order_id == order.id) {
-                                    items_count += quantity;
-                                }
-                            }
-                            fclose(items_file);
-                        }
-                        
-                        fprintf(file, "<tr><td>%s</td><td>%ld</td><td>%d</td><td>%.2f</td><td>%.2f</td><td>%.2f</td></tr>\n",
-                                order.date, order.id, items_count, 
-                                order.total_amount, order.discount,
-                                order.total_amount - order.discount);
-                    }
-                }
-                fclose(sales_file);
-            }
-            fprintf(file, "</table>\n");
-            break;
+    int i = findCustomerIndex(phone);
+    if (i != -1) {
+        // Customer details
+        outPrintf(&out, "<div class='customer-info'>\n");
+        outPrintf(&out, "<h2>Customer Details</h2>\n");
+        outPrintf(&out, "<p><strong>Phone:</strong> %s</p>\n", customers[i].phone);
+        outPrintf(&out, "<p><strong>Name:</strong> %s</p>\n", customers[i].name);
+        outPrintf(&out, "<p><strong>Address:</strong> %s</p>\n", customers[i].address);
+        outPrintf(&out, "<p><strong>Total Spending:</strong> %s</p>\n", moneyStr(customers[i].total_spending));
+        outPrintf(&out, "<p><strong>Loyalty Points:</strong> %d</p>\n", customers[i].loyalty_points);
+        outPrintf(&out, "</div>\n");
+
+        // Purchase history
+        outPrintf(&out, "<h2>Purchase History</h2>\n");
+        outPrintf(&out, "<table>\n");
+        outPrintf(&out, "<tr><th>Date</th><th>Order ID</th><th>Items</th><th>Amount</th><th>Discount</th><th>Net Amount</th></tr>\n");
+
+        SalesLedger ledger;
+        loadSalesLedger(&ledger);
+        int first;
+        int count = ledgerFindCustomerOrders(&ledger, phone, &first);
+        for (int k = 0; k < count; k++) {
+            LedgerOrder* order = &ledger.orders[ledger.by_customer[first + k]];
+            outPrintf(&out, "<tr><td>%s</td><td>%ld</td><td>%d</td><td>%s</td><td>%s</td><td>%s</td></tr>\n",
+                    order->date, order->id, order->item_units,
+                    moneyStr(order->total_amount), moneyStr(order->discount),
+                    moneyStr(order->total_amount - order->discount));
         }
+        freeSalesLedger(&ledger);
+        outPrintf(&out, "</table>\n");
     }
 
-    fprintf(file, "</body></html>\n");
-    fclose(file);
+    outPrintf(&out, "</body></html>\n");
+    return outClose(&out) == 0;
+}
 
-    system(command);
+void generateCustomerSearchPDF(const char* phone) {
+    ReportJob job;
+    newReportJob(&job, "customer_search");
+    if (!finishReportPDF(&job, writeCustomerSearchHTML(phone, job.html))) return;
 
     GREEN_COLOR;
-    printf("\nCustomer Search PDF generated: %s\n", filename);
+    printf("\nCustomer Search PDF queued: %s\n", job.pdf);
     RESET_COLOR;
 }
 
@@ -2297,7 +4455,7 @@ void reportMenu() {
         printf("\n5. Back to Main Menu");
         printf("\n\nEnter your choice: ");
 
-        scanf("%d", &choice);
+        promptScanf("%d", &choice);
 
         switch (choice) {
             case 1: 
@@ -2321,7 +4479,7 @@ void reportMenu() {
                 RED_COLOR;
                 printf("\nInvalid choice! Please try again.\n");
                 RESET_COLOR;
-                sleep(1);
+                pauseFor(1);
         }
     }
 }
@@ -2333,7 +4491,8 @@ void exportOptions(const char* report_type) {
     printf("2. Generate CSV\n");
     printf("3. Skip\n");
     printf("Enter your choice: ");
-    scanf("%d", &choice);
+    promptScanf("%d", &choice);
+    refreshStore();
 
     switch(choice) {
         case 1:
@@ -2349,371 +4508,235 @@ void exportOptions(const char* report_type) {
     }
 }
 
-void generateReportPDF(const char* report_type) {
-    char filename[256];
-    char temp_html[256];
-    char print_command[512];
-    time_t t = time(NULL);
-    struct tm* tm = localtime(&t);
-    char date_str[20];
-    strftime(date_str, sizeof(date_str), "%Y%m%d_%H%M%S", tm);
-    
-    #ifdef _WIN32
-        CreateDirectory("reports", NULL);
-        sprintf(temp_html, "temp_%s.html", date_str);
-        sprintf(filename, "reports\\%s_%s.pdf", report_type, date_str);
-    #else
-        system("mkdir -p reports"); 
-        sprintf(temp_html, "temp_%s.html", date_str);
-        sprintf(filename, "reports/%s_%s.pdf", report_type, date_str); 
-    #endif
+// Writes the HTML version of a report, as fed to wkhtmltopdf
+int writeReportHTML(const char* report_type, const char* path) {
+    OutputBuffer out;
+    if (!outOpen(&out, path)) return 0;
+
+    outPrintf(&out, "<html><head>\n");
+    outPrintf(&out, "<meta charset='UTF-8'>\n");
+    outPrintf(&out, "<style>\n");
+    outPrintf(&out, "body { font-family: Arial, sans-serif; margin: 20px; }\n");
+    outPrintf(&out, "table { width: 100%%; border-collapse: collapse; margin: 20px 0; }\n");
+    outPrintf(&out, "th, td { padding: 10px; border: 1px solid #ddd; text-align: left; }\n");
+    outPrintf(&out, "th { background-color: #00a651; color: white; }\n");
+    outPrintf(&out, ".summary { margin: 20px 0; padding: 20px; background: #f9f9f9; }\n");
+    outPrintf(&out, ".header { text-align: center; margin-bottom: 30px; }\n");
+    outPrintf(&out, ".header h1 { color: #00a651; }\n");
+    outPrintf(&out, "</style></head><body>\n");
+
+    outPrintf(&out, "<div class='header'>\n");
+    outPrintf(&out, "<h1>DIU SUPER SHOP</h1>\n");
+    outPrintf(&out, "<p>Generated on: %s</p>\n", getCurrentDateTime());
+    outPrintf(&out, "</div>\n");
 
-    FILE* file = fopen(temp_html, "w");
-    if (!file) {
-        RED_COLOR;
-        printf("\nError creating temporary file!\n");
-        RESET_COLOR;
-        return;
+    if (strcmp(report_type, "profit") == 0) {
+        generateProfitReportContent(&out);
+    } else if (strcmp(report_type, "daily_sales") == 0) {
+        generateDailySalesReportContent(&out);
+    } else if (strcmp(report_type, "monthly_sales") == 0) {
+        generateMonthlySalesReportContent(&out);
+    } else if (strcmp(report_type, "employee_sales") == 0) {
+        generateEmployeeSalesReportContent(&out);
     }
 
-    fprintf(file, "<html><head>\n");
-    fprintf(file, "<meta charset='UTF-8'>\n");
-    fprintf(file, "<style>\n");
-    fprintf(file, "body { font-family: Arial, sans-serif; margin: 20px; }\n");
-    fprintf(file, "table { width: 100%%; border-collapse: collapse; margin: 20px 0; }\n");
-    fprintf(file, "th, td { padding: 10px; border: 1px solid #ddd; text-align: left; }\n");
-    fprintf(file, "th { background-color: #00a651; color: white; }\n");
-    fprintf(file, ".summary { margin: 20px 0; padding: 20px; background: #f9f9f9; }\n");
-    fprintf(file, ".header { text-align: center; margin-bottom: 30px; }\n");
-    fprintf(file, ".header h1 { color: #00a651; }\n");
-    fprintf(file, "</style></head><body>\n");
+    outPrintf(&out, "</body></html>\n");
+    return outClose(&out) == 0;
+}
 
-    fprintf(file, "<div class='header'>\n");
-    fprintf(file, "<h1>DIU SUPER SHOP</h1>\n");
-    fprintf(file, "<p>Generated on: %s</p>\n", getCurrentDateTime());
-    fprintf(file, "</div>\n");
+int writeReportCSV(const char* report_type, const char* path) {
+    OutputBuffer out;
+    if (!outOpen(&out, path)) return 0;
 
     if (strcmp(report_type, "profit") == 0) {
-        generateProfitReportContent(file);
+        generateProfitReportCSV(&out);
     } else if (strcmp(report_type, "daily_sales") == 0) {
-        generateDailySalesReportContent(file);
+        generateDailySalesReportCSV(&out);
     } else if (strcmp(report_type, "monthly_sales") == 0) {
-        generateMonthlySalesReportContent(file);
+        generateMonthlySalesReportCSV(&out);
     } else if (strcmp(report_type, "employee_sales") == 0) {
-        generateEmployeeSalesReportContent(file);
+        generateEmployeeSalesReportCSV(&out);
     }
 
-    fprintf(file, "</body></html>\n");
-    fclose(file);
+    return outClose(&out) == 0;
+}
 
-    #ifdef _WIN32
-        sprintf(print_command, "wkhtmltopdf %s %s && del %s", temp_html, filename, temp_html);
-    #else
-        sprintf(print_command, "wkhtmltopdf %s %s && rm %s", temp_html, filename, temp_html);
-    #endif
-    
-    if (system(print_command) == 0) {
-        GREEN_COLOR;
-        printf("\nPDF Report generated: %s\n", filename);
-        RESET_COLOR;
-    } else {
-        RED_COLOR;
-        printf("\nError generating PDF. Please make sure wkhtmltopdf is installed.\n");
-        RESET_COLOR;
-    }
+void generateReportPDF(const char* report_type) {
+    ReportJob job;
+    newReportJob(&job, report_type);
+    if (!finishReportPDF(&job, writeReportHTML(report_type, job.html))) return;
+
+    GREEN_COLOR;
+    printf("\nPDF Report queued: %s\n", job.pdf);
+    RESET_COLOR;
 }
 
 void generateReportCSV(const char* report_type) {
     char filename[256];
-    time_t t = time(NULL);
-    struct tm* tm = localtime(&t);
-    char date_str[20];
-    strftime(date_str, sizeof(date_str), "%Y%m%d_%H%M%S", tm);
-    
-    #ifdef _WIN32
-        CreateDirectory("reports", NULL);
-        sprintf(filename, "reports\\%s_%s.csv", report_type, date_str);
-    #else
-        system("mkdir -p reports");
-        sprintf(filename, "reports/%s_%s.csv", report_type, date_str);
-    #endif
+    reportPath(filename, sizeof(filename), report_type, "csv");
 
-    FILE* file = fopen(filename, "w");
-    if (!file) {
+    if (!writeReportCSV(report_type, filename)) {
         RED_COLOR;
         printf("\nError creating CSV file!\n");
         RESET_COLOR;
         return;
     }
-
-    if (strcmp(report_type, "profit") == 0) {
-        generateProfitReportCSV(file);
-    } else if (strcmp(report_type, "daily_sales") == 0) {
-        generateDailySalesReportCSV(file);
-    } else if (strcmp(report_type, "monthly_sales") == 0) {
-        generateMonthlySalesReportCSV(file);
-    } else if (strcmp(report_type, "employee_sales") == 0) {
-        generateEmployeeSalesReportCSV(file);
-    }
-
-    fclose(file);
     GREEN_COLOR;
     printf("\nCSV Report generated: %s\n", filename);
     RESET_COLOR;
 }
 
-void generateProfitReportContent(FILE* file) {
-    fprintf(file, "<h2>Profit Report</h2>\n");
-    fprintf(file, "<table>\n");
-    fprintf(file, "<tr><th>Product Name</th><th>Qty Sold</th><th>Revenue</th><th>Cost</th><th>Profit</th></tr>\n");
+void generateProfitReportContent(OutputBuffer* out) {
+    outPrintf(out, "<h2>Profit Report</h2>\n");
+    outPrintf(out, "<table>\n");
+    outPrintf(out, "<tr><th>Product Name</th><th>Qty Sold</th><th>Revenue</th><th>Cost</th><th>Profit</th></tr>\n");
 
-    float total_revenue = 0, total_cost = 0, total_profit = 0;
-    struct {
-        int product_id;
-        int qty_sold;
-        float revenue;
-        float cost;
-    } product_summary[MAX_PRODUCTS] = {0};
+    Money total_revenue = 0, total_cost = 0, total_profit = 0;
+    ProductSummary* product_summary = calloc(product_count + 1, sizeof(ProductSummary));
 
     // Calculate product summaries
-    FILE* sales_file = fopen("sales_items.txt", "r");
-    if (sales_file) {
-        int order_id, product_id, quantity;
-        float price;
-        
-        while (fscanf(sales_file, "%d,%d,%d,%f\n", 
-                     &order_id, &product_id, &quantity, &price) != EOF) {
-            for (int i = 0; i < product_count; i++) {
-                if (products[i].id == product_id) {
-                    product_summary[i].product_id = product_id;
-                    product_summary[i].qty_sold += quantity;
-                    product_summary[i].revenue += quantity * price;
-                    product_summary[i].cost += quantity * products[i].purchase_price;
-                    break;
-                }
-            }
-        }
-        fclose(sales_file);
-    }
+    collectProductSales(product_summary);
 
     for (int i = 0; i < product_count; i++) {
         if (product_summary[i].qty_sold > 0) {
-            float profit = product_summary[i].revenue - product_summary[i].cost;
-            fprintf(file, "<tr><td>%s</td><td>%d</td><td>%.2f</td><td>%.2f</td><td>%.2f</td></tr>\n",
+            Money profit = product_summary[i].revenue - product_summary[i].cost;
+            outPrintf(out, "<tr><td>%s</td><td>%d</td><td>%s</td><td>%s</td><td>%s</td></tr>\n",
                    products[i].name,
                    product_summary[i].qty_sold,
-                   product_summary[i].revenue,
-                   product_summary[i].cost,
-                   profit);
+                   moneyStr(product_summary[i].revenue),
+                   moneyStr(product_summary[i].cost),
+                   moneyStr(profit));
             
             total_revenue += product_summary[i].revenue;
             total_cost += product_summary[i].cost;
             total_profit += profit;
         }
     }
-
-    fprintf(file, "</table>\n");
-    fprintf(file, "<div class='summary'>\n");
-    fprintf(file, "<h3>Overall Summary</h3>\n");
-    fprintf(file, "<p><strong>Total Revenue:</strong> %.2f</p>\n", total_revenue);
-    fprintf(file, "<p><strong>Total Cost:</strong> %.2f</p>\n", total_cost);
-    fprintf(file, "<p><strong>Total Profit:</strong> %.2f</p>\n", total_profit);
-    fprintf(file, "<p><strong>Profit Margin:</strong> %.2f%%</p>\n", 
-            (total_revenue > 0) ? (total_profit/total_revenue)*100 : 0);
-    fprintf(file, "</div>\n");
+    free(product_summary);
+
+    outPrintf(out, "</table>\n");
+    outPrintf(out, "<div class='summary'>\n");
+    outPrintf(out, "<h3>Overall Summary</h3>\n");
+    outPrintf(out, "<p><strong>Total Revenue:</strong> %s</p>\n", moneyStr(total_revenue));
+    outPrintf(out, "<p><strong>Total Cost:</strong> %s</p>\n", moneyStr(total_cost));
+    outPrintf(out, "<p><strong>Total Profit:</strong> %s</p>\n", moneyStr(total_profit));
+    outPrintf(out, "<p><strong>Profit Margin:</strong> %.2f%%</p>\n", 
+            (total_revenue > 0) ? total_profit * 100.0 / total_revenue : 0);
+    outPrintf(out, "</div>\n");
 }
 
-void generateProfitReportCSV(FILE* file) {
-    fprintf(file, "Product Name,Qty Sold,Revenue,Cost,Profit\n");
+void generateProfitReportCSV(OutputBuffer* out) {
+    outPrintf(out, "Product Name,Qty Sold,Revenue,Cost,Profit\n");
 
-    float total_revenue = 0, total_cost = 0, total_profit = 0;
-    struct {
-        int product_id;
-        int qty_sold;
-        float revenue;
-        float cost;
-    } product_summary[MAX_PRODUCTS] = {0};
+    Money total_revenue = 0, total_cost = 0, total_profit = 0;
+    ProductSummary* product_summary = calloc(product_count + 1, sizeof(ProductSummary));
 
-    FILE* sales_file = fopen("sales_items.txt", "r");
-    if (sales_file) {
-        int order_id, product_id, quantity;
-        float price;
-        
-        while (fscanf(sales_file, "%d,%d,%d,%f\n", 
-                     &order_id, &product_id, &quantity, &price) != EOF) {
-            for (int i = 0; i < product_count; i++) {
-                if (products[i].id == product_id) {
-                    product_summary[i].product_id = product_id;
-                    product_summary[i].qty_sold += quantity;
-                    product_summary[i].revenue += quantity * price;
-                    product_summary[i].cost += quantity * products[i].purchase_price;
-                    break;
-                }
-            }
-        }
-        fclose(sales_file);
-    }
+    collectProductSales(product_summary);
 
     for (int i =0; i < product_count; i++) {
         if (product_summary[i].qty_sold > 0) {
-            float profit = product_summary[i].revenue - product_summary[i].cost;
-            fprintf(file, "%s,%d,%.2f,%.2f,%.2f\n",
+            Money profit = product_summary[i].revenue - product_summary[i].cost;
+            outPrintf(out, "%s,%d,%s,%s,%s\n",
                    products[i].name,
                    product_summary[i].qty_sold,
-                   product_summary[i].revenue,
-                   product_summary[i].cost,
-                   profit);
+                   moneyStr(product_summary[i].revenue),
+                   moneyStr(product_summary[i].cost),
+                   moneyStr(profit));
             
             total_revenue += product_summary[i].revenue;
             total_cost += product_summary[i].cost;
             total_profit += profit;
         }
     }
-
-    fprintf(file, "\nOverall Summary\n");
-    fprintf(file, "Total Revenue,%.2f\n", total_revenue);
-    fprintf(file, "Total Cost,%.2f\n", total_cost);
-    fprintf(file, "Total Profit,%.2f\n", total_profit);
-    fprintf(file, "Profit Margin,%.2f%%\n", 
-            (total_revenue > 0) ? (total_profit/total_revenue)*100 : 0);
+    free(product_summary);
+
+    outPrintf(out, "\nOverall Summary\n");
+    outPrintf(out, "Total Revenue,%s\n", moneyStr(total_revenue));
+    outPrintf(out, "Total Cost,%s\n", moneyStr(total_cost));
+    outPrintf(out, "Total Profit,%s\n", moneyStr(total_profit));
+    outPrintf(out, "Profit Margin,%.2f%%\n", 
+            (total_revenue > 0) ? total_profit * 100.0 / total_revenue : 0);
 }
 
 void dailySalesReport() {
     char date[MAX_STRING];
-    float total_sales = 0;
+    Money total_sales = 0;
     int total_orders = 0;
 
+    refreshStore();
     printHeader("DAILY SALES REPORT");
 
     printf("\nEnter date (YYYY-MM-DD): ");
-    scanf("%s", date);
+    promptScanf("%s", date);
 
-    FILE* file = fopen("sales.txt", "r");
-    if (!file) {
+    // A full YYYY-MM-DD only needs its month's partition; anything else is
+    // matched against every order as before
+    int month = strlen(date) >= 10 && date[4] == '-' && date[7] == '-' ? dayKey(date) / 100 : 0;
+    SalesLedger ledger;
+    if (!(month ? loadSalesLedgerRange(&ledger, month, month) : loadSalesLedger(&ledger))) {
         RED_COLOR;
         printf("\nNo sales records found!\n");
         RESET_COLOR;
-        sleep(2);
+        pauseFor(2);
         return;
     }
 
-    Order order;
     printf("\nOrders for %s:\n", date);
     printLine();
 
-    while (fscanf(file, "%ld,%[^,],%d,%[^,],%f,%f\n",
-                  &order.id,
-                  order.customer_phone,
-                  &order.employee_id,
-                  order.date,
-                  &order.total_amount,
-                  &order.discount) != EOF) {
-        if (strstr(order.date, date)) {
-            printf("\nOrder ID: %ld", order.id);
-            printf("\nAmount: %.2f", order.total_amount);
-            printf("\nDiscount: %.2f\n", order.discount);
-            total_sales += order.total_amount;
+    for (int i = 0; i < ledger.order_count; i++) {
+        LedgerOrder* order = &ledger.orders[i];
+        if (strstr(order->date, date)) {
+            printf("\nOrder ID: %ld", order->id);
+            printf("\nAmount: %s", moneyStr(order->total_amount));
+            printf("\nDiscount: %s\n", moneyStr(order->discount));
+            total_sales += order->total_amount;
             total_orders++;
         }
     }
 
-    fclose(file);
+    freeSalesLedger(&ledger);
 
     printLine();
     printf("\nSummary for %s:", date);
     printf("\nTotal Orders: %d", total_orders);
-    printf("\nTotal Sales: %.2f\n", total_sales);
+    printf("\nTotal Sales: %s\n", moneyStr(total_sales));
 
     printf("\nPress Enter to continue...");
-    getchar();
-    getchar();
+    promptChar();
+    promptChar();
 }
 
 void monthlySalesReport() {
     char month[8];
     char input[10];
-    time_t t = time(NULL);
-    struct tm* tm = localtime(&t);
-    
+
+    refreshStore();
     printHeader("MONTHLY SALES REPORT");
     
     printf("\nEnter month (YYYY-MM): ");
-    scanf("%s", input);
+    promptScanf("%s", input);
     strncpy(month, input, 7);
     month[7] = '\0';
 
-    struct {
-        char date[11];
-        int orders;
-        int items;
-        float sales;
-        float discount;
-    } daily_summary[31] = {0};
-    int days_count = 0;
-
-    float monthly_total = 0, monthly_discount = 0;
-    int monthly_orders = 0, monthly_items = 0;
-    
-    FILE* sales_file = fopen("sales.txt", "r");
-    if (!sales_file) {
+    if (aggregates.count == 0) {
         RED_COLOR;
         printf("\nNo sales records found!\n");
         RESET_COLOR;
         return;
     }
 
-    Order order;
-    while (fscanf(sales_file, "%ld,%[^,],%d,%[^,],%f,%f\n",
-                  &order.id,
-                  order.customer_phone,
-                  &order.employee_id,
-                  order.date,
-                  &order.total_amount,
-                  &order.discount) != EOF) {
-        
-        if (strncmp(order.date, month, 7) == 0) {
-            char date_str[11];
-            strncpy(date_str, order.date, 10);
-            date_str[10] = '\0';
-
-            int day_index = -1;
-            for (int i = 0; i < days_count; i++) {
-                if (strcmp(daily_summary[i].date, date_str) == 0) {
-                    day_index = i;
-                    break;
-                }
-            }
-            if (day_index == -1) {
-                day_index = days_count++;
-                strcpy(daily_summary[day_index].date, date_str);
-            }
-
-            int items_count = 0;
-            FILE* items_file = fopen("sales_items.txt", "r");
-            if (items_file) {
-                int order_id, product_id, quantity;
-                float price;
-                while (fscanf(items_file, "%d,%d,%d,%f\n", 
-                            &order_id, &product_id, &quantity, &price) != EOF) {
-                    if (order_id == order.id) {
-                        items_count += quantity;
-                    }
-                }
-                fclose(items_file);
-            }
-
-            daily_summary[day_index].orders++;
-            daily_summary[day_index].items += items_count;
-            daily_summary[day_index].sales += order.total_amount;
-            daily_summary[day_index].discount += order.discount;
+    DailySummary daily_summary[31];
+    int days_count = collectMonthlySales(monthKey(month), daily_summary);
 
-            monthly_orders++;
-            monthly_items += items_count;
-            monthly_total += order.total_amount;
-            monthly_discount += order.discount;
-        }
+    Money monthly_total = 0, monthly_discount = 0;
+    int monthly_orders = 0, monthly_items = 0;
+    for (int i = 0; i < days_count; i++) {
+        monthly_orders += daily_summary[i].orders;
+        monthly_items += daily_summary[i].items;
+        monthly_total += daily_summary[i].sales;
+        monthly_discount += daily_summary[i].discount;
     }
-    fclose(sales_file);
 
     printf("\nSales Summary for %s:\n", month);
     printLine();
@@ -2723,13 +4746,13 @@ void monthlySalesReport() {
     printLine();
 
     for (int i = 0; i < days_count; i++) {
-        printf("%-12s%-10d%-12d%-15.2f%-15.2f%-15.2f\n",
+        printf("%-12s%-10d%-12d%-15s%-15s%-15s\n",
                daily_summary[i].date,
                daily_summary[i].orders,
                daily_summary[i].items,
-               daily_summary[i].sales,
-               daily_summary[i].discount,
-               daily_summary[i].sales - daily_summary[i].discount);
+               moneyStr(daily_summary[i].sales),
+               moneyStr(daily_summary[i].discount),
+               moneyStr(daily_summary[i].sales - daily_summary[i].discount));
     }
     
     printLine();
@@ -2738,104 +4761,52 @@ void monthlySalesReport() {
     printf("Total Days with Sales : %d\n", days_count);
     printf("Total Orders         : %d\n", monthly_orders);
     printf("Total Items Sold     : %d\n", monthly_items);
-    printf("Total Sales          : %.2f\n", monthly_total);
-    printf("Total Discounts      : %.2f\n", monthly_discount);
-    printf("Net Sales            : %.2f\n", monthly_total - monthly_discount);
-    printf("Average Daily Sales  : %.2f\n", 
-           days_count > 0 ? (monthly_total - monthly_discount)/days_count : 0);
-    printf("Average Order Value  : %.2f\n", 
-           monthly_orders > 0 ? (monthly_total - monthly_discount)/monthly_orders : 0);
+    printf("Total Sales          : %s\n", moneyStr(monthly_total));
+    printf("Total Discounts      : %s\n", moneyStr(monthly_discount));
+    printf("Net Sales            : %s\n", moneyStr(monthly_total - monthly_discount));
+    printf("Average Daily Sales  : %s\n", 
+           moneyStr(days_count > 0 ? (monthly_total - monthly_discount)/days_count : 0));
+    printf("Average Order Value  : %s\n", 
+           moneyStr(monthly_orders > 0 ? (monthly_total - monthly_discount)/monthly_orders : 0));
     RESET_COLOR;
 
     printf("\nPress Enter to continue...");
-    getchar();
-    getchar();
+    promptChar();
+    promptChar();
 }
 
 void employeeSalesReport() {
+    refreshStore();
     printHeader("EMPLOYEE SALES REPORT");
 
     printf("\nLoading employee and admin sales data...\n");
 
-    struct {
-        int id;
-        char name[MAX_STRING];
-        char role[MAX_STRING];
-        int orders;
-        int items;
-        float sales;
-        float discount;
-    } emp_summary[MAX_EMPLOYEES] = {0};
-    int emp_count = 0;
-
-    FILE* emp_file = fopen("employees.txt", "r");
-    if (!emp_file) {
+    if (employee_count == 0) {
         RED_COLOR;
-        printf("\nError: Cannot open employees.txt!\n");
+        printf("\nNo employees found!\n");
         RESET_COLOR;
-        sleep(2);
+        pauseFor(2);
         return;
     }
 
-    Employee emp;
-    while (fscanf(emp_file, "%d,%[^,],%[^,],%[^,],%[^,],%f\n",
-           &emp.id, emp.name, emp.username, emp.password,
-           emp.role, &emp.total_sales) != EOF) {
-        emp_summary[emp_count].id = emp.id;
-        strcpy(emp_summary[emp_count].name, emp.name);
-        strcpy(emp_summary[emp_count].role, emp.role);
-        printf("Loaded: %s (%s)\n", emp.name, emp.role);
-        emp_count++;
+    for (int i = 0; i < employee_count; i++) {
+        printf("Loaded: %s (%s)\n", employees[i].name, employees[i].role);
     }
-    fclose(emp_file);
 
-    FILE* sales_file = fopen("sales.txt", "r");
-    if (!sales_file) {
+    if (aggregates.count == 0) {
         RED_COLOR;
         printf("\nNo sales records found!\n");
         RESET_COLOR;
-        sleep(2);
+        pauseFor(2);
         return;
     }
 
-    Order order;
-    float total_sales = 0, total_discount = 0;
-    int total_orders = 0, total_items = 0;
-
-    while (fscanf(sales_file, "%ld,%[^,],%d,%[^,],%f,%f\n",
-                  &order.id,
-                  order.customer_phone,
-                  &order.employee_id,
-                  order.date,
-                  &order.total_amount,
-                  &order.discount) != EOF) {
-        
-        for (int i = 0; i < emp_count; i++) {
-            if (emp_summary[i].id == order.employee_id) {
-                // Count items
-                int items_count = 0;
-                FILE* items_file = fopen("sales_items.txt", "r");
-                if (items_file) {
-                    int order_id, product_id, quantity;
-                    float price;
-                    while (fscanf(items_file, "%d,%d,%d,%f\n", 
-                                &order_id, &product_id, &quantity, &price) != EOF) {
-                        if (order_id == order.id) {
-                            items_count += quantity;
-                        }
-                    }
-                    fclose(items_file);
-                }
+    // One slot per row of employees[]
+    EmployeeSummary* emp_summary = calloc(employee_count, sizeof(EmployeeSummary));
+    collectEmployeeSales(emp_summary);
 
-                emp_summary[i].orders++;
-                emp_summary[i].items += items_count;
-                emp_summary[i].sales += order.total_amount;
-                emp_summary[i].discount += order.discount;
-                break;
-            }
-        }
-    }
-    fclose(sales_file);
+    Money total_sales = 0, total_discount = 0;
+    int total_orders = 0, total_items = 0;
 
     system("cls");
     printHeader("EMPLOYEE SALES REPORT");
@@ -2847,16 +4818,16 @@ void employeeSalesReport() {
     printLine();
 
     int staff_with_sales = 0;
-    for (int i = 0; i < emp_count; i++) {
+    for (int i = 0; i < employee_count; i++) {
         if (emp_summary[i].orders > 0) {  // Show anyone with sales
-            printf("%-20s %-10s %-10d %-12d %-15.2f %-15.2f %-15.2f\n",
-                   emp_summary[i].name,
-                   emp_summary[i].role,
+            printf("%-20s %-10s %-10d %-12d %-15s %-15s %-15s\n",
+                   employees[i].name,
+                   employees[i].role,
                    emp_summary[i].orders,
                    emp_summary[i].items,
-                   emp_summary[i].sales,
-                   emp_summary[i].discount,
-                   emp_summary[i].sales - emp_summary[i].discount);
+                   moneyStr(emp_summary[i].sales),
+                   moneyStr(emp_summary[i].discount),
+                   moneyStr(emp_summary[i].sales - emp_summary[i].discount));
 
             total_orders += emp_summary[i].orders;
             total_items += emp_summary[i].items;
@@ -2877,17 +4848,18 @@ void employeeSalesReport() {
         printf("Total Staff with Sales: %d\n", staff_with_sales);
         printf("Total Orders         : %d\n", total_orders);
         printf("Total Items Sold     : %d\n", total_items);
-        printf("Total Sales          : %.2f\n", total_sales);
-        printf("Total Discounts      : %.2f\n", total_discount);
-        printf("Net Sales            : %.2f\n", total_sales - total_discount);
-        printf("Average Sale         : %.2f\n", 
-               total_orders > 0 ? (total_sales - total_discount)/total_orders : 0);
+        printf("Total Sales          : %s\n", moneyStr(total_sales));
+        printf("Total Discounts      : %s\n", moneyStr(total_discount));
+        printf("Net Sales            : %s\n", moneyStr(total_sales - total_discount));
+        printf("Average Sale         : %s\n", 
+               moneyStr(total_orders > 0 ? (total_sales - total_discount + total_orders / 2) / total_orders : 0));
         RESET_COLOR;
     }
+    free(emp_summary);
 
     printf("\nPress Enter to continue...");
-    getchar();
-    getchar();
+    promptChar();
+    promptChar();
 }
 
 void profitReport() {
@@ -2895,114 +4867,78 @@ void profitReport() {
         RED_COLOR;
         printf("\nAccess denied! Only administrators can view profit reports.\n");
         RESET_COLOR;
-        sleep(2);
+        pauseFor(2);
         return;
     }
     
+    refreshStore();
     printHeader("PROFIT REPORT");
     
-    float total_revenue = 0;
-    float total_cost = 0;
-    float total_profit = 0;
-    int records_found = 0;
+    Money total_revenue = 0;
+    Money total_cost = 0;
+    Money total_profit = 0;
     
-    FILE* file = fopen("sales.txt", "r");
-    if (!file) {
+    if (aggregates.count == 0) {
         RED_COLOR;
         printf("\nNo sales records found!\n");
         RESET_COLOR;
-        sleep(2);
+        pauseFor(2);
         return;
     }
-    
+
     printf("\nProduct-wise Profit Summary:\n");
     printLine();
     printf("%-20s%-12s%-15s%-15s%-15s\n", 
            "Product Name", "Qty Sold", "Revenue", "Cost", "Profit");
     printLine();
     
-    struct {
-        int product_id;
-        int qty_sold;
-        float revenue;
-        float cost;
-    } product_summary[MAX_PRODUCTS] = {0};
+    ProductSummary* product_summary = calloc(product_count + 1, sizeof(ProductSummary));
     
-    Order order;
-   while (fscanf(file, "%ld,%[^,],%d,%[^,],%f,%f\n",
-               &order.id,
-               order.customer_phone,
-               &order.employee_id,
-               order.date,
-               &order.total_amount,
-               &order.discount) != EOF) {
-        
-        FILE* items_file = fopen("sales_items.txt", "r");
-        if (items_file) {
-            int order_id, product_id, quantity;
-            float price;
-            
-            while (fscanf(items_file, "%d,%d,%d,%f\n", 
-                         &order_id, &product_id, &quantity, &price) != EOF) {
-                if (order_id == order.id) {
-                    for (int i = 0; i < product_count; i++) {
-                        if (products[i].id == product_id) {
-                            product_summary[i].product_id = product_id;
-                            product_summary[i].qty_sold += quantity;
-                            product_summary[i].revenue += quantity * price;
-                            product_summary[i].cost += quantity * products[i].purchase_price;
-                            records_found = 1;
-                            break;
-                        }
-                    }
-                }
-            }
-            fclose(items_file);
-        }
-    }
-    fclose(file);
+    int records_found = collectProductSales(product_summary);
     
     if (!records_found) {
+        free(product_summary);
         YELLOW_COLOR;
         printf("\nNo sales data found for analysis.\n");
         RESET_COLOR;
         printf("\nPress Enter to continue...");
-        getchar();
-        getchar();
+        promptChar();
+        promptChar();
         return;
     }
     
     // Print product-wise summary
     for (int i = 0; i < product_count; i++) {
         if (product_summary[i].qty_sold > 0) {
-            float profit = product_summary[i].revenue - product_summary[i].cost;
-            printf("%-20s%-12d%-15.2f%-15.2f%-15.2f\n",
+            Money profit = product_summary[i].revenue - product_summary[i].cost;
+            printf("%-20s%-12d%-15s%-15s%-15s\n",
                    products[i].name,
                    product_summary[i].qty_sold,
-                   product_summary[i].revenue,
-                   product_summary[i].cost,
-                   profit);
+                   moneyStr(product_summary[i].revenue),
+                   moneyStr(product_summary[i].cost),
+                   moneyStr(profit));
             
             total_revenue += product_summary[i].revenue;
             total_cost += product_summary[i].cost;
         }
     }
+    free(product_summary);
     
     total_profit = total_revenue - total_cost;
-    float profit_margin = (total_revenue > 0) ? (total_profit/total_revenue)*100 : 0;
+    float profit_margin = (total_revenue > 0) ? total_profit * 100.0 / total_revenue : 0;
     
     printLine();
     printf("\nOverall Summary:\n");
     GREEN_COLOR;
-    printf("Total Revenue  : %-15.2f\n", total_revenue);
-    printf("Total Cost     : %-15.2f\n", total_cost);
-    printf("Total Profit   : %-15.2f\n", total_profit);
+    printf("Total Revenue  : %-15s\n", moneyStr(total_revenue));
+    printf("Total Cost     : %-15s\n", moneyStr(total_cost));
+    printf("Total Profit   : %-15s\n", moneyStr(total_profit));
     printf("Profit Margin  : %-14.2f%%\n", profit_margin);
     RESET_COLOR;
     
     printf("\nPress Enter to continue...");
-    getchar();
-    getchar();
+    promptChar();
+    promptChar();
 }
 
 void settingsMenu() {
@@ -3015,7 +4951,7 @@ void settingsMenu() {
         printf("\n3. Back to Main Menu");
         printf("\n\nEnter your choice: ");
 
-        scanf("%d", &choice);
+        promptScanf("%d", &choice);
 
         switch (choice) {
             case 1: changePassword(); break;
@@ -3025,862 +4961,4414 @@ void settingsMenu() {
                 RED_COLOR;
                 printf("\nInvalid choice! Please try again.\n");
                 RESET_COLOR;
-                sleep(1);
+                pauseFor(1);
         }
     }
 }
 
 // Main Function
-int main() {
+int main(int argc, char* argv[]) {
+    if (argc > 1 && strcmp(argv[1], "bench") == 0) {
+        return runBenchmark(argc, argv);
+    }
+    if (argc > 1 && strcmp(argv[1], "client") == 0) {
+        return runClient(argc - 1, argv + 1);
+    }
+    if (argc > 1 && strcmp(argv[1], "serve") == 0) {
+        headless = 1;
+        loadSystem();
+        return runServer(argc - 1, argv + 1);
+    }
+    if (argc > 1 && isHeadlessCommand(argv[1])) {
+        headless = 1;
+        loadSystem();
+        int result = runCommand(argc - 1, argv + 1);
+        checkExitRequest();
+        return result;
+    }
+
     initializeSystem();
     return 0;
 }
 
 // File Operations
-void saveTransactionToFile(Order order) {
-    // Save main order details to sales.txt
-    FILE* file = fopen("sales.txt", "a");
-    if (!file) {
-        RED_COLOR;
-        printf("\nError saving transaction!\n");
-        RESET_COLOR;
-        return;
+// Records a sale; 0 if it could not be written, in which case the caller
+// must leave stock and totals alone
+int saveTransactionToFile(Order order) {
+    // Order and items go to the month's sales partition as a single record
+    costOrderItems(&order);
+    if (!appendOrderToLog(&order)) {
+        if (!headless) {
+            RED_COLOR;
+            printf("\nError saving transaction!\n");
+            RESET_COLOR;
+        }
+        return 0;
     }
+    recordOrderAggregates(&order);
 
-    fprintf(file, "%ld,%s,%d,%s,%.2f,%.2f\n",
-            order.id,
-            order.customer_phone,
-            order.employee_id,
-            order.date,
-            order.total_amount,
-            order.discount);
-
-    fclose(file);
+    // Update customer spending and loyalty points
+    int i = findCustomerIndex(order.customer_phone);
+    if (i != -1) {
+        customers[i].total_spending += order.total_amount;
+        customers[i].loyalty_points = (int)(customers[i].total_spending / TAKA(100));
+        markCustomerDirty(i);
+    }
+    return 1;
+}
 
-    // Save order items to sales_items.txt
-    FILE* items_file = fopen("sales_items.txt", "a");
-    if (!items_file) {
-        RED_COLOR;
-        printf("\nError saving transaction items!\n");
-        RESET_COLOR;
-        return;
+// Sales Ledger
+// Reports used to reopen sales_items.txt for every row of sales.txt. The
+// ledger reads the order history once and records each order's item
+// range, so a report is a single walk over the orders.
+//
+// Orders are stored in sales/YYYY-MM.log, one append-only binary file per
+// month of order dates (see salesPartitionPath):
+//
+//   file header   "SSLG", u16 version, u16 header size, 8 reserved bytes
+//   each record   u32 payload length, u32 CRC-32 of the payload, payload
+//   payload       i64 order id, i32 employee id, i64 total and i64
+//                 discount in paisa, u8 payment method, u8 phone length +
+//                 phone, u8 date length + date, u16 item count, then per
+//                 item i32 product id, i32 quantity, i64 price and i64
+//                 unit cost in paisa
+//
+// Version 1 records have no unit cost, 16 bytes an item; which kind a
+// record is follows from its length, so one partition can hold both. A
+// partition's header version is raised before a newer record goes in.
+// All integers are little-endian. A record is written with one fwrite, so
+// an order and its items can no longer be split across two files; a torn
+// or corrupt record at the tail is detected by its length or checksum,
+// ignored by readers and cut off before the next append.
+unsigned int crc_table[256];
+int crc_table_ready = 0;
+
+unsigned int crc32(const unsigned char* data, size_t len) {
+    if (!crc_table_ready) {
+        for (unsigned int n = 0; n < 256; n++) {
+            unsigned int c = n;
+            for (int k = 0; k < 8; k++) {
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            }
+            crc_table[n] = c;
+        }
+        crc_table_ready = 1;
     }
 
-    // Save each item in the cart
-    for (int i = 0; i < order.item_count; i++) {
-        fprintf(items_file, "%ld,%d,%d,%.2f\n",
-                order.id,                    
-                order.items[i].product_id,   
-                order.items[i].quantity,     
-                order.items[i].price);      
+    unsigned int crc = 0xFFFFFFFFu;
+    for (size_t i = 0; i < len; i++) {
+        crc = crc_table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
     }
+    return crc ^ 0xFFFFFFFFu;
+}
 
-    fclose(items_file);
+void putU16(unsigned char* p, uint16_t v) {
+    p[0] = v & 0xFF;
+    p[1] = (v >> 8) & 0xFF;
+}
 
-    // Update customer spending and loyalty points
-    for (int i = 0; i < customer_count; i++) {
-        if (strcmp(customers[i].phone, order.customer_phone) == 0) {
-            customers[i].total_spending += order.total_amount;
-            customers[i].loyalty_points = (int)(customers[i].total_spending / 100);
-            saveCustomers();
-            break;
-        }
-    }
+void putU32(unsigned char* p, uint32_t v) {
+    for (int i = 0; i < 4; i++) p[i] = (v >> (8 * i)) & 0xFF;
 }
 
-void saveCustomers() {
-    FILE* file = fopen("customers.txt", "w");
-    if (!file) {
-        RED_COLOR;
-        printf("\nError saving customers!\n");
-        RESET_COLOR;
-        return;
-    }
-    
-    for (int i = 0; i < customer_count; i++) {
-        fprintf(file, "%s,%s,%s,%.2f,%d,%d\n",
-                customers[i].phone,
-                customers[i].name,
-                customers[i].address,
-                customers[i].total_spending,
-                customers[i].loyalty_points,
-                customers[i].last_loyalty_milestone);
+void putU64(unsigned char* p, uint64_t v) {
+    for (int i = 0; i < 8; i++) p[i] = (v >> (8 * i)) & 0xFF;
+}
+
+uint16_t getU16(const unsigned char* p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+uint32_t getU32(const unsigned char* p) {
+    uint32_t v = 0;
+    for (int i = 3; i >= 0; i--) v = (v << 8) | p[i];
+    return v;
+}
+
+uint64_t getU64(const unsigned char* p) {
+    uint64_t v = 0;
+    for (int i = 7; i >= 0; i--) v = (v << 8) | p[i];
+    return v;
+}
+
+// Builds the record (header + payload) for order into buf and returns its
+// total size. items may differ from order->items so converted history is
+// not limited to MAX_CART_ITEMS; buf must hold
+// SALES_LOG_RECORD_SIZE(item_count) bytes.
+size_t encodeOrderRecord(const Order* order, const CartItem* items, int item_count,
+                         unsigned char* buf) {
+    unsigned char* p = buf + SALES_LOG_RECORD_HEADER;
+    size_t phone_len = strlen(order->customer_phone);
+    size_t date_len = strlen(order->date);
+    if (phone_len > 255) phone_len = 255;
+    if (date_len > 255) date_len = 255;
+
+    putU64(p, (uint64_t)order->id); p += 8;
+    putU32(p, (uint32_t)order->employee_id); p += 4;
+    putU64(p, (uint64_t)order->total_amount); p += 8;
+    putU64(p, (uint64_t)order->discount); p += 8;
+    *p++ = (unsigned char)order->payment_method;
+    *p++ = (unsigned char)phone_len;
+    memcpy(p, order->customer_phone, phone_len); p += phone_len;
+    *p++ = (unsigned char)date_len;
+    memcpy(p, order->date, date_len); p += date_len;
+    putU16(p, (uint16_t)item_count); p += 2;
+    for (int i = 0; i < item_count; i++) {
+        putU32(p, (uint32_t)items[i].product_id); p += 4;
+        putU32(p, (uint32_t)items[i].quantity); p += 4;
+        putU64(p, (uint64_t)items[i].price); p += 8;
+        putU64(p, (uint64_t)items[i].cost); p += 8;
     }
-    
-    fclose(file);
+
+    uint32_t payload_len = (uint32_t)(p - buf - SALES_LOG_RECORD_HEADER);
+    putU32(buf, payload_len);
+    putU32(buf + 4, crc32(buf + SALES_LOG_RECORD_HEADER, payload_len));
+    return SALES_LOG_RECORD_HEADER + payload_len;
 }
 
-void loadCustomers() {
-    FILE* file = fopen("customers.txt", "r");
+// Sales partitions
+// Orders are stored by the month of their date, so a report on one day or
+// month maps only that month's file instead of the whole history. Each
+// partition is a complete sales log with its own header; orders whose date
+// doesn't parse go to month 0.
+void salesPartitionPath(char* path, int month) {
+    sprintf(path, "%s/%04d-%02d.log", SALES_DIR, month / 100 % 10000, month % 100);
+}
+
+// Opens one partition for appending, writing the file header if it is new
+// Partition bytes known to be whole records, so that each append only
+// checks what other tills have added since
+int sales_checked_month = 0;
+long sales_checked_size = 0;
+
+// Length of the records in path that are whole and pass their checksum,
+// or -1 if it is not a sales log. A crash mid-write leaves a torn record
+// at the end, which must go before anything is appended after it: every
+// reader stops at the first bad record.
+long intactSalesLength(const char* path, int month) {
+    MappedFile log;
+    if (!mapFile(path, &log)) return -1;
+    const unsigned char* data = (const unsigned char*)log.data;
+    if (log.size < SALES_LOG_HEADER_SIZE) {
+        unmapFile(&log);
+        return 0;  // Torn header; the file starts over
+    }
+    if (memcmp(data, SALES_LOG_MAGIC, 4) != 0 || getU16(data + 4) > SALES_LOG_VERSION ||
+        getU16(data + 6) > log.size) {
+        unmapFile(&log);
+        return -1;
+    }
+
+    size_t offset = getU16(data + 6);
+    if (month == sales_checked_month && sales_checked_size > (long)offset &&
+        sales_checked_size <= (long)log.size) {
+        offset = (size_t)sales_checked_size;
+    }
+    while (log.size - offset >= SALES_LOG_RECORD_HEADER) {
+        uint32_t len = getU32(data + offset);
+        const unsigned char* payload = data + offset + SALES_LOG_RECORD_HEADER;
+        if (len > SALES_LOG_MAX_RECORD || len > log.size - offset - SALES_LOG_RECORD_HEADER ||
+            crc32(payload, len) != getU32(data + offset + 4)) {
+            break;
+        }
+        offset += SALES_LOG_RECORD_HEADER + len;
+    }
+    unmapFile(&log);
+    return (long)offset;
+}
+
+// Marks an older sales log as holding current records, so that a build
+// which cannot read them refuses the file rather than misreading it
+void raiseSalesLogVersion(const char* path) {
+    FILE* file = fopen(path, "r+b");
     if (!file) return;
-    
-    customer_count = 0;
-    while (!feof(file) && customer_count < MAX_CUSTOMERS) {
-        fscanf(file, "%[^,],%[^,],%[^,],%f,%d,%d\n",
-               customers[customer_count].phone,
-               customers[customer_count].name,
-               customers[customer_count].address,
-               &customers[customer_count].total_spending,
-               &customers[customer_count].loyalty_points,
-               &customers[customer_count].last_loyalty_milestone);
-        customer_count++;
+    unsigned char header[6];
+    if (fread(header, 1, sizeof(header), file) == sizeof(header) &&
+        memcmp(header, SALES_LOG_MAGIC, 4) == 0 && getU16(header + 4) < SALES_LOG_VERSION) {
+        putU16(header + 4, SALES_LOG_VERSION);
+        fseek(file, 4, SEEK_SET);
+        fwrite(header + 4, 1, 2, file);
     }
-    
     fclose(file);
 }
 
-float applyDiscount(float amount, const char* phone) {
-    float discount = 0;
-    
-    // Find customer
-    for (int i = 0; i < customer_count; i++) {
-        if (strcmp(customers[i].phone, phone) == 0) {
-            // Loyalty discount
-            if (customers[i].total_spending >= LOYALTY_THRESHOLD) {
-                discount = amount * 0.1; // 10% discount for loyal customers
-            }
-            break;
+// Opens month's partition for appending, with the store locked. A torn
+// record left at its end is cut off first.
+FILE* openSalesPartition(int month) {
+    char path[SALES_PARTITION_PATH_SIZE];
+    salesPartitionPath(path, month);
+    FILE* file = fopen(path, "ab");
+    if (!file) {
+        // First order ever; create the directory
+#ifdef _WIN32
+        _mkdir(SALES_DIR);
+#else
+        mkdir(SALES_DIR, 0755);
+#endif
+        file = fopen(path, "ab");
+        if (!file) return NULL;
+        syncDirectory(".");
+    }
+
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    long intact = size > 0 ? intactSalesLength(path, month) : 0;
+    if (intact >= 0 && intact < size) {
+        if (!truncateStream(file, intact)) {
+            fclose(file);
+            return NULL;
         }
+        size = intact;
     }
-    
-    return discount;
+    if (size > 0 && month != sales_checked_month) raiseSalesLogVersion(path);
+    if (intact >= 0) {
+        sales_checked_month = month;
+        sales_checked_size = size;
+    }
+    if (size == 0) {
+        unsigned char header[SALES_LOG_HEADER_SIZE] = {0};
+        memcpy(header, SALES_LOG_MAGIC, 4);
+        putU16(header + 4, SALES_LOG_VERSION);
+        putU16(header + 6, SALES_LOG_HEADER_SIZE);
+        fwrite(header, 1, sizeof(header), file);
+        // A synced order is no use in a file the directory forgets
+        syncDirectory(SALES_DIR);
+    }
+    return file;
 }
 
-void viewSalesHistory() {
-    printHeader("SALES HISTORY");
-    
-    FILE* file = fopen("sales.txt", "r");
-    if (!file) {
-        YELLOW_COLOR;
-        printf("\nNo sales history found!\n");
-        RESET_COLOR;
-        sleep(2);
+// Cuts month's partition back to length, removing it if that leaves no
+// header. Undoes a batch of appends that could not all be written.
+void truncateSalesPartition(int month, long length) {
+    char path[SALES_PARTITION_PATH_SIZE];
+    salesPartitionPath(path, month);
+    if (month == sales_checked_month) sales_checked_month = 0;
+    if (length < SALES_LOG_HEADER_SIZE) {
+        remove(path);
         return;
     }
-    
-    Order order;
-    float total_sales = 0;
-    int total_orders = 0;
-    
-    printf("\nID\tDate\t\t\tCustomer\t\tPhone\t\tAmount\t\tDiscount\n");
-    printLine();
-    
-    while (fscanf(file, "%ld,%[^,],%d,%[^,],%f,%f\n",
-                  &order.id,
-                  order.customer_phone,
-                  &order.employee_id,
-                  order.date,
-                  &order.total_amount,
-                  &order.discount) != EOF) {
-        
-        if (strcmp(current_user.role, "admin") != 0 && 
-            order.employee_id != current_user.id) {
-            continue;
+    FILE* file = fopen(path, "r+b");
+    if (!file) return;
+    if (truncateStream(file, length)) syncFile(fileno(file));
+    fclose(file);
+}
+
+// Flushes a file's data to disk; 0 on failure
+int syncFile(int fd) {
+#ifdef _WIN32
+    return _commit(fd) == 0;
+#elif defined(__linux__)
+    return fdatasync(fd) == 0;
+#else
+    return fsync(fd) == 0;
+#endif
+}
+
+// Makes files just created in path survive a crash
+void syncDirectory(const char* path) {
+#ifndef _WIN32
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return;
+    fsync(fd);
+    close(fd);
+#else
+    (void)path;
+#endif
+}
+
+int closeSalesPartition(SalesLogWriter* writer) {
+    FILE* file = writer->file;
+    writer->file = NULL;
+    if (writer->durable && (fflush(file) != 0 || !syncFile(fileno(file)))) {
+        fclose(file);
+        return 0;
+    }
+    return fclose(file) == 0;
+}
+
+// Writes one encoded record to month's partition. Returns 0 once any write
+// through writer has failed.
+int writeSalesRecord(SalesLogWriter* writer, int month, const unsigned char* record, size_t size) {
+    if (!writer->file || writer->month != month) {
+        if (writer->file && !closeSalesPartition(writer)) writer->ok = 0;
+        writer->file = openSalesPartition(month);
+        writer->month = month;
+        if (!writer->file) writer->ok = 0;
+    }
+    if (writer->file && fwrite(record, 1, size, writer->file) != size) writer->ok = 0;
+    return writer->ok;
+}
+
+int closeSalesLogWriter(SalesLogWriter* writer) {
+    if (writer->file && !closeSalesPartition(writer)) writer->ok = 0;
+    return writer->ok;
+}
+
+// Sales Commit
+// An order is only reported sold once its record is on disk. Syncing each
+// order by itself would hold a busy daemon to one order per disk flush, so
+// the daemon commits in groups: checkouts append their records, and a
+// committer thread waits up to the commit window for more before syncing
+// every partition written to since its last pass. Checkout replies wait
+// for the sync (see processSession). Without a committer, appendOrderToLog
+// syncs each order before returning.
+int sales_commit_window_ms = SALES_COMMIT_WINDOW_MS;
+int sales_committer_running = 0;
+unsigned long long sales_appended = 0;  // Orders this process has written
+
+#ifndef _WIN32
+pthread_mutex_t sales_commit_lock = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t sales_commit_pending = PTHREAD_COND_INITIALIZER;
+pthread_t sales_committer;
+int sales_committer_stopping = 0;
+unsigned long long sales_durable = 0;  // Orders known to be on disk
+unsigned long long sales_failed = 0;   // Last order of a pass whose sync failed
+int* sales_dirty_months = NULL;        // Partitions written since the last sync
+int sales_dirty_count = 0;
+int sales_dirty_capacity = 0;
+void (*sales_commit_notify)(void) = NULL;
+
+// Called with the store locked once an order's record is written
+void noteSalesAppend(int month) {
+    pthread_mutex_lock(&sales_commit_lock);
+    int i = 0;
+    while (i < sales_dirty_count && sales_dirty_months[i] != month) i++;
+    if (i == sales_dirty_count) {
+        if (sales_dirty_count == sales_dirty_capacity) {
+            sales_dirty_capacity = sales_dirty_capacity ? sales_dirty_capacity * 2 : 4;
+            sales_dirty_months = realloc(sales_dirty_months, sales_dirty_capacity * sizeof(int));
         }
-        
-        char customer_name[MAX_STRING] = "Guest";
-        for (int i = 0; i < customer_count; i++) {
-            if (strcmp(customers[i].phone, order.customer_phone) == 0) {
-                strcpy(customer_name, customers[i].name);
+        sales_dirty_months[sales_dirty_count++] = month;
+    }
+    sales_appended++;
+    pthread_cond_signal(&sales_commit_pending);
+    pthread_mutex_unlock(&sales_commit_lock);
+}
+
+int syncSalesPartition(int month) {
+    char path[SALES_PARTITION_PATH_SIZE];
+    salesPartitionPath(path, month);
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return 0;
+    int ok = syncFile(fd);
+    close(fd);
+    return ok;
+}
+
+void* runSalesCommitter(void* arg) {
+    (void)arg;
+    pthread_mutex_lock(&sales_commit_lock);
+    while (1) {
+        while (!sales_committer_stopping && sales_durable == sales_appended) {
+            pthread_cond_wait(&sales_commit_pending, &sales_commit_lock);
+        }
+        if (sales_durable == sales_appended) break;
+
+        // Let the orders right behind this one share its sync
+        if (sales_commit_window_ms > 0 && !sales_committer_stopping) {
+            pthread_mutex_unlock(&sales_commit_lock);
+            struct timespec window = {sales_commit_window_ms / 1000,
+                                      (sales_commit_window_ms % 1000) * 1000000L};
+            nanosleep(&window, NULL);
+            pthread_mutex_lock(&sales_commit_lock);
+        }
+        unsigned long long target = sales_appended;
+        int* months = sales_dirty_months;
+        int count = sales_dirty_count;
+        sales_dirty_months = NULL;
+        sales_dirty_count = sales_dirty_capacity = 0;
+        pthread_mutex_unlock(&sales_commit_lock);
+
+        int synced = 1;
+        for (int i = 0; i < count; i++) {
+            if (!syncSalesPartition(months[i])) {
+                fprintf(stderr, "Error: cannot sync %s: %s\n", SALES_DIR, strerror(errno));
+                synced = 0;
+            }
+        }
+        free(months);
+
+        pthread_mutex_lock(&sales_commit_lock);
+        if (!synced) sales_failed = target;
+        sales_durable = target;
+        if (sales_commit_notify) sales_commit_notify();
+    }
+    pthread_mutex_unlock(&sales_commit_lock);
+    return NULL;
+}
+
+// Orders from here on are synced by the committer, which calls notify
+// after each sync; see salesDurable
+void startSalesCommitter(void (*notify)(void)) {
+    if (sales_committer_running) return;
+    sales_commit_notify = notify;
+    sales_committer_stopping = 0;
+    if (pthread_create(&sales_committer, NULL, runSalesCommitter, NULL) == 0) {
+        sales_committer_running = 1;
+    }
+}
+
+// Syncs what is left, then goes back to syncing each order as it is written
+void stopSalesCommitter() {
+    if (!sales_committer_running) return;
+    pthread_mutex_lock(&sales_commit_lock);
+    sales_committer_stopping = 1;
+    pthread_cond_signal(&sales_commit_pending);
+    pthread_mutex_unlock(&sales_commit_lock);
+    pthread_join(sales_committer, NULL);
+    sales_committer_running = 0;
+}
+
+// How many of this process's orders are on disk
+unsigned long long salesDurable() {
+    pthread_mutex_lock(&sales_commit_lock);
+    unsigned long long durable = sales_durable;
+    pthread_mutex_unlock(&sales_commit_lock);
+    return durable;
+}
+
+// The last order whose sync failed, or 0; orders up to it may not be on disk
+unsigned long long salesFailed() {
+    pthread_mutex_lock(&sales_commit_lock);
+    unsigned long long failed = sales_failed;
+    pthread_mutex_unlock(&sales_commit_lock);
+    return failed;
+}
+#else
+void noteSalesAppend(int month) {
+    (void)month;
+    sales_appended++;
+}
+
+void startSalesCommitter(void (*notify)(void)) {
+    (void)notify;
+}
+
+void stopSalesCommitter() {}
+
+unsigned long long salesDurable() {
+    return sales_appended;
+}
+
+unsigned long long salesFailed() {
+    return 0;
+}
+#endif
+
+int compareMonths(const void* a, const void* b) {
+    return *(const int*)a - *(const int*)b;
+}
+
+// Sets *months to the partitions on disk, oldest first, and returns how
+// many there are. The caller frees *months.
+int listSalesPartitions(int** months) {
+    int count = 0, capacity = 16;
+    *months = malloc(capacity * sizeof(int));
+
+#ifdef _WIN32
+    WIN32_FIND_DATA found;
+    HANDLE search = FindFirstFile(SALES_DIR "\\*.log", &found);
+    if (search == INVALID_HANDLE_VALUE) return 0;
+    do {
+        const char* name = found.cFileName;
+#else
+    DIR* dir = opendir(SALES_DIR);
+    if (!dir) return 0;
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != NULL) {
+        const char* name = entry->d_name;
+#endif
+        // Only names salesPartitionPath makes: YYYY-MM.log
+        if (strlen(name) == 11 && strcmp(name + 7, ".log") == 0 && name[4] == '-') {
+            const char* p = name;
+            int year, month;
+            if (parseDigits(&p, 4, &year) && p == name + 4 && *p++ == '-' &&
+                parseDigits(&p, 2, &month) && p == name + 7) {
+                if (count == capacity) {
+                    capacity *= 2;
+                    *months = realloc(*months, capacity * sizeof(int));
+                }
+                (*months)[count++] = year * 100 + month;
+            }
+        }
+#ifdef _WIN32
+    } while (FindNextFile(search, &found));
+    FindClose(search);
+#else
+    }
+    closedir(dir);
+#endif
+
+    qsort(*months, count, sizeof(int), compareMonths);
+    return count;
+}
+
+void removeSalesPartitions() {
+    int* months;
+    int count = listSalesPartitions(&months);
+    for (int i = 0; i < count; i++) {
+        char path[SALES_PARTITION_PATH_SIZE];
+        salesPartitionPath(path, months[i]);
+        remove(path);
+    }
+    free(months);
+}
+
+// Partition month of an encoded payload, from its date field
+int recordMonth(const unsigned char* payload, uint32_t len) {
+    char date[256];
+    if (len < 30) return 0;
+    size_t phone_len = payload[29];
+    if (len < 31 + phone_len) return 0;
+    size_t date_len = payload[30 + phone_len];
+    if (len < 31 + phone_len + date_len) return 0;
+    memcpy(date, payload + 31 + phone_len, date_len);
+    date[date_len] = '\0';
+    return monthKey(date);
+}
+
+int appendOrderToLog(const Order* order) {
+    unsigned char buf[SALES_LOG_RECORD_SIZE(MAX_CART_ITEMS)];
+    size_t size = encodeOrderRecord(order, order->items, order->item_count, buf);
+
+    int month = monthKey(order->date);
+    lockStore();
+    SalesLogWriter writer = {NULL, 0, 1, !sales_committer_running};
+    writeSalesRecord(&writer, month, buf, size);
+    int ok = closeSalesLogWriter(&writer);
+    if (ok) noteSalesAppend(month);
+    unlockStore();
+    return ok;
+}
+
+// Bytes per item in a payload with rest bytes left after its item count
+long salesItemSize(long rest, int item_count) {
+    return item_count > 0 && rest == (long)item_count * SALES_LOG_ITEM_SIZE ? SALES_LOG_ITEM_SIZE : 16;
+}
+
+// Decodes one verified payload into the ledger. Returns 0 if the payload
+// is shorter than its own fields claim.
+int decodeOrderRecord(SalesLedger* ledger, const unsigned char* p, uint32_t len,
+                      int* order_capacity, int* item_capacity) {
+    const unsigned char* end = p + len;
+    LedgerOrder order;
+    memset(&order, 0, sizeof(order));
+
+    if (end - p < 30) return 0;
+    order.id = (long)(int64_t)getU64(p); p += 8;
+    order.employee_id = (int)getU32(p); p += 4;
+    order.total_amount = (int64_t)getU64(p); p += 8;
+    order.discount = (int64_t)getU64(p); p += 8;
+    p++;    // payment method
+    size_t phone_len = *p++;
+    if (end - p < (long)phone_len + 1) return 0;
+    memcpy(order.customer_phone, p, phone_len < MAX_STRING ? phone_len : MAX_STRING - 1);
+    p += phone_len;
+    size_t date_len = *p++;
+    if (end - p < (long)date_len + 2) return 0;
+    memcpy(order.date, p, date_len < sizeof(order.date) ? date_len : sizeof(order.date) - 1);
+    p += date_len;
+    int item_count = getU16(p); p += 2;
+    long item_size = salesItemSize(end - p, item_count);
+    if (end - p < (long)item_count * item_size) return 0;
+
+    if (ledger->item_count + item_count > *item_capacity) {
+        while (ledger->item_count + item_count > *item_capacity) {
+            *item_capacity = *item_capacity ? *item_capacity * 2 : 256;
+        }
+        ledger->items = realloc(ledger->items, *item_capacity * sizeof(LedgerItem));
+    }
+    order.item_start = ledger->item_count;
+    for (int i = 0; i < item_count; i++) {
+        LedgerItem* item = &ledger->items[ledger->item_count++];
+        item->order_id = order.id;
+        item->product_id = (int)getU32(p); p += 4;
+        item->quantity = (int)getU32(p); p += 4;
+        item->price = (int64_t)getU64(p);
+        p += item_size - 8;
+        item->seq = ledger->item_count - 1;
+        order.item_count++;
+        order.item_units += item->quantity;
+    }
+
+    if (ledger->order_count == *order_capacity) {
+        *order_capacity = *order_capacity ? *order_capacity * 2 : 256;
+        ledger->orders = realloc(ledger->orders, *order_capacity * sizeof(LedgerOrder));
+    }
+    ledger->orders[ledger->order_count++] = order;
+    return 1;
+}
+
+// Decodes one verified payload into order. Returns 0 if the payload is
+// shorter than its own fields claim or holds more items than an order can.
+int decodeOrder(const unsigned char* p, uint32_t len, Order* order) {
+    const unsigned char* end = p + len;
+    if (end - p < 30) return 0;
+    order->id = (long)(int64_t)getU64(p); p += 8;
+    order->employee_id = (int)getU32(p); p += 4;
+    order->total_amount = (int64_t)getU64(p); p += 8;
+    order->discount = (int64_t)getU64(p); p += 8;
+    order->payment_method = *p++;
+    size_t phone_len = *p++;
+    if (end - p < (long)phone_len + 1) return 0;
+    size_t copy = phone_len < sizeof(order->customer_phone) ? phone_len : sizeof(order->customer_phone) - 1;
+    memcpy(order->customer_phone, p, copy);
+    order->customer_phone[copy] = '\0';
+    p += phone_len;
+    size_t date_len = *p++;
+    if (end - p < (long)date_len + 2) return 0;
+    copy = date_len < sizeof(order->date) ? date_len : sizeof(order->date) - 1;
+    memcpy(order->date, p, copy);
+    order->date[copy] = '\0';
+    p += date_len;
+    order->item_count = getU16(p); p += 2;
+    long item_size = salesItemSize(end - p, order->item_count);
+    if (order->item_count > MAX_CART_ITEMS || end - p < (long)order->item_count * item_size) return 0;
+    for (int i = 0; i < order->item_count; i++) {
+        CartItem* item = &order->items[i];
+        item->product_id = (int)getU32(p); p += 4;
+        item->quantity = (int)getU32(p); p += 4;
+        item->price = (int64_t)getU64(p); p += 8;
+        if (item_size == SALES_LOG_ITEM_SIZE) {
+            item->cost = (int64_t)getU64(p); p += 8;
+        } else {
+            // Sold before costs were recorded; today's price is all there is
+            item->cost = productCost(item->product_id, 1);
+        }
+    }
+    return 1;
+}
+
+// Maps one sales log and sets start to its first record. Returns 0 if
+// there is no such log or it isn't one this build can read.
+int mapSalesLog(const char* path, MappedFile* log, size_t* start) {
+    if (!mapFile(path, log)) return 0;
+
+    const unsigned char* data = (const unsigned char*)log->data;
+    if (log->size < SALES_LOG_HEADER_SIZE || memcmp(data, SALES_LOG_MAGIC, 4) != 0 ||
+        getU16(data + 4) > SALES_LOG_VERSION || getU16(data + 6) > log->size) {
+        if (headless) {
+            commandError("not a supported sales log", path);
+        } else {
+            RED_COLOR;
+            printf("\n%s is not a supported sales log!\n", path);
+            RESET_COLOR;
+        }
+        unmapFile(log);
+        return 0;
+    }
+    *start = getU16(data + 6);
+    return 1;
+}
+
+// Fills bounds[0..n] with record-aligned offsets that cut the log into n
+// ranges of about equal size, n <= count, and returns n. Only the length
+// fields are read; the walk ends where a length can't be right, the same
+// place a sequential read gives up.
+int splitSalesLog(const unsigned char* data, size_t size, size_t start, size_t* bounds, int count) {
+    size_t step = (size - start) / count + 1;
+    size_t offset = start;
+    int ranges = 0;
+    bounds[0] = start;
+    while (size - offset >= SALES_LOG_RECORD_HEADER) {
+        uint32_t len = getU32(data + offset);
+        if (len > SALES_LOG_MAX_RECORD || len > size - offset - SALES_LOG_RECORD_HEADER) break;
+        offset += SALES_LOG_RECORD_HEADER + len;
+        if (ranges < count - 1 && offset - start >= step * (ranges + 1)) {
+            bounds[++ranges] = offset;
+        }
+    }
+    if (offset > bounds[ranges]) bounds[++ranges] = offset;
+    return ranges;
+}
+
+int loadSalesLedger(SalesLedger* ledger) {
+    return loadSalesLedgerRange(ledger, 0, 999999);
+}
+
+// Loads the orders of the yyyymm months first_month..last_month, oldest
+// month first; partitions outside the range are never opened. Returns 0
+// if there is no sales history at all.
+int loadSalesLedgerRange(SalesLedger* ledger, int first_month, int last_month) {
+    memset(ledger, 0, sizeof(*ledger));
+
+    int* months;
+    int count = listSalesPartitions(&months);
+    int order_capacity = 0, item_capacity = 0;
+    for (int i = 0; i < count; i++) {
+        if (months[i] < first_month || months[i] > last_month) continue;
+
+        char path[SALES_PARTITION_PATH_SIZE];
+        MappedFile log;
+        size_t offset;
+        salesPartitionPath(path, months[i]);
+        if (!mapSalesLog(path, &log, &offset)) continue;
+
+        // Records are checked and decoded where they lie in the mapping
+        const unsigned char* data = (const unsigned char*)log.data;
+        while (log.size - offset >= SALES_LOG_RECORD_HEADER) {
+            uint32_t len = getU32(data + offset);
+            const unsigned char* payload = data + offset + SALES_LOG_RECORD_HEADER;
+            if (len > SALES_LOG_MAX_RECORD || len > log.size - offset - SALES_LOG_RECORD_HEADER ||
+                crc32(payload, len) != getU32(data + offset + 4) ||
+                !decodeOrderRecord(ledger, payload, len, &order_capacity, &item_capacity)) {
+                // Torn or damaged tail; everything before it is intact
                 break;
             }
+            offset += SALES_LOG_RECORD_HEADER + len;
         }
-        
-        printf("%ld\t%-20s%-16s%-16s%.2f\t\t%.2f\n",
-               order.id,
-               order.date,
-               customer_name,
-               order.customer_phone,
-               order.total_amount,
-               order.discount);
-        
-        total_sales += order.total_amount;
-        total_orders++;
+        unmapFile(&log);
     }
-    
-    fclose(file);
-    
-    printLine();
-    printf("\nTotal Orders: %d", total_orders);
-    printf("\nTotal Sales: %.2f\n", total_sales);
-    
-    printf("\nPress Enter to continue...");
-    getchar();
+    free(months);
+    return count > 0;
 }
 
-void updateCustomer() {
-    char phone[MAX_STRING];
-    printHeader("UPDATE CUSTOMER");
-    
-    printf("\nEnter Customer Phone Number: ");
-    scanf("%s", phone);
-    
-    for (int i = 0; i < customer_count; i++) {
-        if (strcmp(customers[i].phone, phone) == 0) {
-            printf("\nCurrent Details:");
-            printf("\nName: %s", customers[i].name);
-            printf("\nPhone: %s", customers[i].phone);
-            printf("\nAddress: %s", customers[i].address);
-            printf("\nTotal Spending: %.2f", customers[i].total_spending);
-            printf("\nLoyalty Points: %d", customers[i].loyalty_points);
-            
-            printf("\n\nEnter new details (press Enter to keep current value):\n");
-            char input[MAX_STRING];
-            getchar();
-            
-            printf("Name: ");
-            fgets(input, MAX_STRING, stdin);
-            if (input[0] != '\n') {
-                input[strcspn(input, "\n")] = 0;
-                strcpy(customers[i].name, input);
+int compareLedgerItems(const void* a, const void* b) {
+    const LedgerItem* x = (const LedgerItem*)a;
+    const LedgerItem* y = (const LedgerItem*)b;
+    if (x->order_id != y->order_id) return x->order_id < y->order_id ? -1 : 1;
+    return x->seq - y->seq;
+}
+
+// Reads the old sales.txt / sales_items.txt pair and joins items to orders
+// by id. Only used to convert existing history into the sales partitions.
+int loadLegacySalesLedger(SalesLedger* ledger) {
+    memset(ledger, 0, sizeof(*ledger));
+
+    MappedFile file;
+    if (!mapFile("sales.txt", &file)) return 0;
+
+    int capacity = 0;
+    LedgerOrder order;
+    memset(&order, 0, sizeof(order));
+    const char* cursor = file.data;
+    StringView line;
+    while (nextLine(&cursor, file.data + file.size, &line)) {
+        // id,phone,employee_id,date,total,discount
+        if (line.len == 0) continue;
+        if (!viewLong(nextField(&line, ','), &order.id)) break;
+        viewCopy(order.customer_phone, sizeof(order.customer_phone), nextField(&line, ','));
+        if (!viewInt(nextField(&line, ','), &order.employee_id)) break;
+        viewCopy(order.date, sizeof(order.date), nextField(&line, ','));
+        StringView total = nextField(&line, ',');
+        if (line.len == 0) break;
+        order.total_amount = viewMoney(total);
+        order.discount = viewMoney(line);
+        if (ledger->order_count == capacity) {
+            capacity = capacity ? capacity * 2 : 256;
+            ledger->orders = realloc(ledger->orders, capacity * sizeof(LedgerOrder));
+        }
+        ledger->orders[ledger->order_count++] = order;
+    }
+    unmapFile(&file);
+
+    MappedFile items_file;
+    if (mapFile("sales_items.txt", &items_file)) {
+        int sorted = 1;
+        capacity = 0;
+        LedgerItem item;
+        cursor = items_file.data;
+        while (nextLine(&cursor, items_file.data + items_file.size, &line)) {
+            // order_id,product_id,quantity,price
+            if (line.len == 0) continue;
+            if (!viewLong(nextField(&line, ','), &item.order_id) ||
+                !viewInt(nextField(&line, ','), &item.product_id) ||
+                !viewInt(nextField(&line, ','), &item.quantity) || line.len == 0) {
+                break;
             }
-            
-            printf("Address: ");
-            fgets(input, MAX_STRING, stdin);
-            if (input[0] != '\n') {
-                input[strcspn(input, "\n")] = 0;
-                strcpy(customers[i].address, input);
+            item.price = viewMoney(line);
+            if (ledger->item_count == capacity) {
+                capacity = capacity ? capacity * 2 : 256;
+                ledger->items = realloc(ledger->items, capacity * sizeof(LedgerItem));
             }
-            
-            saveCustomers();
-            
-            GREEN_COLOR;
-            printf("\nCustomer updated successfully!\n");
-            RESET_COLOR;
-            sleep(2);
-            return;
+            item.seq = ledger->item_count;
+            if (item.seq > 0 && ledger->items[item.seq - 1].order_id > item.order_id) {
+                sorted = 0;
+            }
+            ledger->items[ledger->item_count++] = item;
+        }
+        unmapFile(&items_file);
+
+        // Items are normally appended in order id order already
+        if (!sorted) {
+            qsort(ledger->items, ledger->item_count, sizeof(LedgerItem), compareLedgerItems);
         }
     }
-    
-    RED_COLOR;
-    printf("\nCustomer not found!\n");
-    RESET_COLOR;
-    sleep(2);
+
+    // Attach each order to its item range
+    for (int i = 0; i < ledger->order_count; i++) {
+        LedgerOrder* o = &ledger->orders[i];
+        int lo = 0, hi = ledger->item_count;
+        while (lo < hi) {
+            int mid = lo + (hi - lo) / 2;
+            if (ledger->items[mid].order_id < o->id) lo = mid + 1;
+            else hi = mid;
+        }
+        o->item_start = lo;
+        o->item_count = 0;
+        o->item_units = 0;
+        while (lo < ledger->item_count && ledger->items[lo].order_id == o->id) {
+            o->item_units += ledger->items[lo].quantity;
+            o->item_count++;
+            lo++;
+        }
+    }
+
+    return 1;
+}
+
+void freeSalesLedger(SalesLedger* ledger) {
+    free(ledger->orders);
+    free(ledger->items);
+    free(ledger->by_customer);
+    memset(ledger, 0, sizeof(*ledger));
+}
+
+// One-time split of a single sales.log into month partitions. Records are
+// copied as they are, up to the first damaged one; the old log is kept as
+// sales.log.migrated.
+void partitionSalesLog() {
+    MappedFile log;
+    size_t offset;
+    if (access(SALES_LOG_FILE, F_OK) != 0 || !mapSalesLog(SALES_LOG_FILE, &log, &offset)) {
+        return;
+    }
+
+    const unsigned char* data = (const unsigned char*)log.data;
+    SalesLogWriter writer = {NULL, 0, 1, 1};
+    while (log.size - offset >= SALES_LOG_RECORD_HEADER && writer.ok) {
+        uint32_t len = getU32(data + offset);
+        const unsigned char* payload = data + offset + SALES_LOG_RECORD_HEADER;
+        if (len > SALES_LOG_MAX_RECORD || len > log.size - offset - SALES_LOG_RECORD_HEADER ||
+            crc32(payload, len) != getU32(data + offset + 4)) {
+            break;
+        }
+        writeSalesRecord(&writer, recordMonth(payload, len), data + offset, SALES_LOG_RECORD_HEADER + len);
+        offset += SALES_LOG_RECORD_HEADER + len;
+    }
+    unmapFile(&log);
+
+    if (!closeSalesLogWriter(&writer)) {
+        RED_COLOR;
+        printf("\nError splitting %s into %s/!\n", SALES_LOG_FILE, SALES_DIR);
+        RESET_COLOR;
+        removeSalesPartitions();
+        return;
+    }
+#ifdef _WIN32
+    remove(SALES_LOG_FILE ".migrated");
+#endif
+    rename(SALES_LOG_FILE, SALES_LOG_FILE ".migrated");
+}
+
+// One-time conversion of sales.txt / sales_items.txt into the sales log.
+// The text files are left as they are, so nothing is lost if it goes
+// wrong and sample data stays untouched; nothing reads them once sales/
+// holds a partition.
+void convertLegacySales() {
+    int* months;
+    int partitions = listSalesPartitions(&months);
+    free(months);
+    if (partitions > 0 || access(SALES_LOG_FILE, F_OK) == 0 || access("sales.txt", F_OK) != 0) {
+        return;
+    }
+
+    SalesLedger legacy;
+    if (!loadLegacySalesLedger(&legacy)) return;
+
+    SalesLogWriter writer = {NULL, 0, 1, 1};
+    CartItem* items = malloc((legacy.item_count + 1) * sizeof(CartItem));
+    unsigned char* buf = NULL;
+    size_t buf_size = 0;
+    for (int o = 0; o < legacy.order_count && writer.ok; o++) {
+        LedgerOrder* lo = &legacy.orders[o];
+        Order order;
+        memset(&order, 0, sizeof(order));
+        order.id = lo->id;
+        strcpy(order.customer_phone, lo->customer_phone);
+        order.employee_id = lo->employee_id;
+        strcpy(order.date, lo->date);
+        order.total_amount = lo->total_amount;
+        order.discount = lo->discount;
+
+        int item_count = lo->item_count < 65535 ? lo->item_count : 65535;
+        for (int i = 0; i < item_count; i++) {
+            LedgerItem* item = &legacy.items[lo->item_start + i];
+            items[i].product_id = item->product_id;
+            items[i].quantity = item->quantity;
+            items[i].price = item->price;
+            items[i].cost = productCost(item->product_id, 1);
+        }
+        if ((size_t)SALES_LOG_RECORD_SIZE(item_count) > buf_size) {
+            buf_size = SALES_LOG_RECORD_SIZE(item_count);
+            buf = realloc(buf, buf_size);
+        }
+        size_t size = encodeOrderRecord(&order, items, item_count, buf);
+        writeSalesRecord(&writer, monthKey(order.date), buf, size);
+    }
+    free(buf);
+    free(items);
+    freeSalesLedger(&legacy);
+
+    if (!closeSalesLogWriter(&writer)) {
+        RED_COLOR;
+        printf("\nError converting sales history!\n");
+        RESET_COLOR;
+        removeSalesPartitions();
+    }
+}
+
+SalesLedger* sort_ledger;
+
+int compareLedgerByCustomer(const void* a, const void* b) {
+    int x = *(const int*)a;
+    int y = *(const int*)b;
+    int cmp = strcmp(sort_ledger->orders[x].customer_phone,
+                     sort_ledger->orders[y].customer_phone);
+    return cmp != 0 ? cmp : x - y;
+}
+
+// Returns how many orders belong to phone; their ledger positions are
+// by_customer[*first] .. by_customer[*first + count - 1], oldest first.
+int ledgerFindCustomerOrders(SalesLedger* ledger, const char* phone, int* first) {
+    if (!ledger->by_customer) {
+        ledger->by_customer = malloc((ledger->order_count + 1) * sizeof(int));
+        for (int i = 0; i < ledger->order_count; i++) {
+            ledger->by_customer[i] = i;
+        }
+        sort_ledger = ledger;
+        qsort(ledger->by_customer, ledger->order_count, sizeof(int), compareLedgerByCustomer);
+    }
+
+    int lo = 0, hi = ledger->order_count;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (strcmp(ledger->orders[ledger->by_customer[mid]].customer_phone, phone) < 0) lo = mid + 1;
+        else hi = mid;
+    }
+    *first = lo;
+
+    int count = 0;
+    while (lo + count < ledger->order_count &&
+           strcmp(ledger->orders[ledger->by_customer[lo + count]].customer_phone, phone) == 0) {
+        count++;
+    }
+    return count;
+}
+
+// Sales Aggregates
+// Running totals keyed by (day, employee, product), kept up to date by
+// checkout so the monthly, staff and profit reports no longer walk the
+// whole order history. Each order adds one row with product_id
+// AGGREGATE_ORDER_ROW holding its order count, units, total and discount,
+// plus one row per product line holding quantity, revenue and cost at the
+// purchase price of the day. Days are stored as yyyymmdd integers and
+// amounts in paisa.
+//
+// sales.agg holds "day,employee,product,orders,items,gross,discount,cost"
+// increment lines. Every append ends with "@<size>", the total size of the
+// sales partitions the rows account for (see salesLogSize); if that does
+// not match the partitions on startup the store is rebuilt from them.
+
+// Reads up to max digits, as scanf's %<max>d would without the locale
+// and whitespace handling; returns 0 if there are none
+int parseDigits(const char** text, int max, int* value) {
+    const char* p = *text;
+    int result = 0, count = 0;
+    while (count < max && *p >= '0' && *p <= '9') {
+        result = result * 10 + (*p++ - '0');
+        count++;
+    }
+    *text = p;
+    *value = result;
+    return count > 0;
+}
+
+int dayKey(const char* date) {
+    int year, month, day;
+    if (!parseDigits(&date, 4, &year) || *date++ != '-' ||
+        !parseDigits(&date, 2, &month) || *date++ != '-' ||
+        !parseDigits(&date, 2, &day)) {
+        return 0;
+    }
+    return year * 10000 + month * 100 + day;
+}
+
+int monthKey(const char* month) {
+    int year, mon;
+    if (!parseDigits(&month, 4, &year) || *month++ != '-' || !parseDigits(&month, 2, &mon)) return 0;
+    return year * 100 + mon;
+}
+
+// Total size of the partitions; sales.agg records it to spot a stale store
+long salesLogSize() {
+    int* months;
+    int count = listSalesPartitions(&months);
+    long total = 0;
+    for (int i = 0; i < count; i++) {
+        char path[SALES_PARTITION_PATH_SIZE];
+        struct stat st;
+        salesPartitionPath(path, months[i]);
+        if (stat(path, &st) == 0) total += (long)st.st_size;
+    }
+    free(months);
+    return total;
+}
+
+unsigned int hashAggregateKey(int day, int employee_id, int product_id) {
+    unsigned int hash = (unsigned int)day * 2654435761u;
+    hash ^= (unsigned int)employee_id * 2246822519u;
+    hash ^= (unsigned int)product_id * 3266489917u;
+    return hash;
+}
+
+void rebuildAggregateIndex(AggregateTable* table) {
+    int capacity = 64;
+    while (capacity < table->count * 2) capacity *= 2;
+
+    if (capacity != table->slot_capacity) {
+        free(table->slots);
+        table->slots = malloc(capacity * sizeof(int));
+        table->slot_capacity = capacity;
+    }
+    memset(table->slots, 0, capacity * sizeof(int));
+
+    for (int i = 0; i < table->count; i++) {
+        SalesAggregate* a = &table->rows[i];
+        unsigned int slot = hashAggregateKey(a->day, a->employee_id, a->product_id) & (capacity - 1);
+        while (table->slots[slot] != 0) {
+            slot = (slot + 1) & (capacity - 1);
+        }
+        table->slots[slot] = i + 1;
+    }
+}
+
+// Adds row's counts to the row with the same key, creating it if needed
+void addAggregate(AggregateTable* table, const SalesAggregate* row) {
+    if (table->slot_capacity == 0) rebuildAggregateIndex(table);
+
+    unsigned int mask = table->slot_capacity - 1;
+    unsigned int slot = hashAggregateKey(row->day, row->employee_id, row->product_id) & mask;
+    while (table->slots[slot] != 0) {
+        SalesAggregate* a = &table->rows[table->slots[slot] - 1];
+        if (a->day == row->day && a->employee_id == row->employee_id && a->product_id == row->product_id) {
+            a->orders += row->orders;
+            a->items += row->items;
+            a->gross += row->gross;
+            a->discount += row->discount;
+            a->cost += row->cost;
+            return;
+        }
+        slot = (slot + 1) & mask;
+    }
+
+    if (table->count == table->capacity) {
+        table->capacity = table->capacity ? table->capacity * 2 : 256;
+        table->rows = realloc(table->rows, table->capacity * sizeof(SalesAggregate));
+    }
+    table->rows[table->count++] = *row;
+
+    if (table->count * 2 > table->slot_capacity) {
+        rebuildAggregateIndex(table);
+    } else {
+        table->slots[slot] = table->count;
+    }
+}
+
+void freeAggregateTable(AggregateTable* table) {
+    free(table->rows);
+    free(table->slots);
+    memset(table, 0, sizeof(*table));
+}
+
+Money productCost(int product_id, int quantity) {
+    int i = findProductIndex(product_id);
+    if (i == -1) return 0;
+    return quantity * products[i].purchase_price;
+}
+
+// Records the cost of each item at today's purchase price, so profit for
+// a sale stays what it was when the price changes later
+void costOrderItems(Order* order) {
+    for (int i = 0; i < order->item_count; i++) {
+        order->items[i].cost = productCost(order->items[i].product_id, 1);
+    }
+}
+
+void writeAggregateRow(FILE* file, const SalesAggregate* a) {
+    fprintf(file, "%d,%d,%d,%d,%d,%lld,%lld,%lld\n",
+            a->day, a->employee_id, a->product_id, a->orders, a->items,
+            (long long)a->gross, (long long)a->discount, (long long)a->cost);
+}
+
+// Rewrites sales.agg as one row per key
+void saveAggregates() {
+    lockStore();
+    FILE* file = fopen(AGGREGATE_FILE ".tmp", "w");
+    if (!file) {
+        unlockStore();
+        return;
+    }
+
+    for (int i = 0; i < aggregates.count; i++) {
+        writeAggregateRow(file, &aggregates.rows[i]);
+    }
+    fprintf(file, "@%ld\n", salesLogSize());
+
+    if (fclose(file) != 0) {
+        remove(AGGREGATE_FILE ".tmp");
+        unlockStore();
+        return;
+    }
+#ifdef _WIN32
+    remove(AGGREGATE_FILE);
+#endif
+    rename(AGGREGATE_FILE ".tmp", AGGREGATE_FILE);
+    stampFile(AGGREGATE_FILE, &aggregate_sync.journal);
+    unlockStore();
+}
+
+// Aggregates one range of the log, stopping at the first damaged record
+void aggregateLogRange(AggregateChunk* chunk) {
+    Order order;
+    size_t offset = chunk->start;
+    while (offset < chunk->end) {
+        const unsigned char* record = chunk->data + offset;
+        uint32_t len = getU32(record);
+        const unsigned char* payload = record + SALES_LOG_RECORD_HEADER;
+        if (crc32(payload, len) != getU32(record + 4) || !decodeOrder(payload, len, &order)) break;
+        applyOrderAggregates(chunk->table, &order, NULL);
+        offset += SALES_LOG_RECORD_HEADER + len;
+    }
+    chunk->stopped_at = offset;
+}
+
+void aggregateChunks(AggregateWork* work) {
+    for (int i = work->first; i < work->count; i += work->step) {
+        aggregateLogRange(&work->chunks[i]);
+    }
+}
+
+#ifndef _WIN32
+void* aggregateWorker(void* arg) {
+    aggregateChunks((AggregateWork*)arg);
+    return NULL;
+}
+#endif
+
+int aggregateThreadCount(size_t bytes) {
+#ifdef _WIN32
+    (void)bytes;
+    return 1;
+#else
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    long threads = (long)(bytes / AGGREGATE_MIN_CHUNK) + 1;
+    if (threads > cores) threads = cores;
+    if (threads > AGGREGATE_MAX_THREADS) threads = AGGREGATE_MAX_THREADS;
+    return threads < 1 ? 1 : (int)threads;
+#endif
+}
+
+// Recomputes the store from the sales partitions. Each partition is cut
+// into up to one byte range per core, every range is summed into its own
+// table, and the ranges are shared out over one thread per core. A damaged
+// record ends its partition's history there, as it does for
+// loadSalesLedger, so later ranges of that partition are dropped.
+void rebuildAggregates() {
+    aggregates.count = 0;
+    rebuildAggregateIndex(&aggregates);
+
+    int* months;
+    int partition_count = listSalesPartitions(&months);
+    MappedFile* logs = malloc((partition_count + 1) * sizeof(MappedFile));
+    AggregateChunk* chunks = NULL;
+    int count = 0, capacity = 0;
+    size_t total = 0;
+    for (int p = 0; p < partition_count; p++) {
+        char path[SALES_PARTITION_PATH_SIZE];
+        size_t start;
+        salesPartitionPath(path, months[p]);
+        if (!mapSalesLog(path, &logs[p], &start)) {
+            logs[p].data = NULL;
+            continue;
+        }
+
+        const unsigned char* data = (const unsigned char*)logs[p].data;
+        size_t bounds[AGGREGATE_MAX_THREADS + 1];
+        int ranges = splitSalesLog(data, logs[p].size, start, bounds,
+                                   aggregateThreadCount(logs[p].size - start));
+        if (count + ranges > capacity) {
+            capacity = capacity * 2 + ranges;
+            chunks = realloc(chunks, capacity * sizeof(AggregateChunk));
+        }
+        for (int i = 0; i < ranges; i++) {
+            chunks[count++] = (AggregateChunk){data, bounds[i], bounds[i + 1], bounds[i], p, NULL};
+        }
+        total += logs[p].size - start;
+    }
+
+    if (count > 0) {
+        // The first range can't be cut short by an earlier one, so it is
+        // summed straight into the store
+        AggregateTable* tables = calloc(count, sizeof(AggregateTable));
+        for (int i = 0; i < count; i++) {
+            chunks[i].table = i == 0 ? &aggregates : &tables[i];
+        }
+
+        int thread_count = aggregateThreadCount(total);
+        if (thread_count > count) thread_count = count;
+        AggregateWork work[AGGREGATE_MAX_THREADS];
+        for (int t = 0; t < thread_count; t++) {
+            work[t] = (AggregateWork){chunks, count, t, thread_count};
+        }
+
+        crc32(chunks[0].data, 0);  // Builds the CRC table before the workers share it
+#ifndef _WIN32
+        pthread_t threads[AGGREGATE_MAX_THREADS];
+        int started[AGGREGATE_MAX_THREADS] = {0};
+        for (int t = 1; t < thread_count; t++) {
+            started[t] = pthread_create(&threads[t], NULL, aggregateWorker, &work[t]) == 0;
+        }
+#endif
+        for (int t = 0; t < thread_count; t++) {
+#ifndef _WIN32
+            if (started[t]) {
+                pthread_join(threads[t], NULL);
+                continue;
+            }
+#endif
+            aggregateChunks(&work[t]);
+        }
+
+        int cut = 0;
+        for (int i = 1; i < count; i++) {
+            if (chunks[i].partition != chunks[i - 1].partition) {
+                cut = 0;
+            } else if (chunks[i - 1].stopped_at != chunks[i - 1].end) {
+                cut = 1;
+            }
+            if (!cut) {
+                for (int k = 0; k < tables[i].count; k++) {
+                    addAggregate(&aggregates, &tables[i].rows[k]);
+                }
+            }
+            freeAggregateTable(&tables[i]);
+        }
+        free(tables);
+    }
+
+    for (int p = 0; p < partition_count; p++) {
+        if (logs[p].data) unmapFile(&logs[p]);
+    }
+    free(logs);
+    free(chunks);
+    free(months);
+
+    saveAggregates();
+}
+
+// Parses one "day,employee,product,orders,items,gross,discount,cost" row
+int parseAggregateRow(StringView line, SalesAggregate* a) {
+    return viewInt(nextField(&line, ','), &a->day) &&
+           viewInt(nextField(&line, ','), &a->employee_id) &&
+           viewInt(nextField(&line, ','), &a->product_id) &&
+           viewInt(nextField(&line, ','), &a->orders) &&
+           viewInt(nextField(&line, ','), &a->items) &&
+           viewInt64(nextField(&line, ','), &a->gross) &&
+           viewInt64(nextField(&line, ','), &a->discount) &&
+           viewInt64(line, &a->cost);
+}
+
+void loadAggregates() {
+    aggregates.count = 0;
+    rebuildAggregateIndex(&aggregates);
+
+    long covered = -1;
+    int lines = 0;
+    MappedFile file;
+    if (mapFile(AGGREGATE_FILE, &file)) {
+        const char* cursor = file.data;
+        StringView line;
+        while (nextLine(&cursor, file.data + file.size, &line)) {
+            SalesAggregate a;
+            if (line.len > 0 && line.data[0] == '@') {
+                line.data++;
+                line.len--;
+                if (!viewLong(line, &covered)) covered = -1;
+            } else if (parseAggregateRow(line, &a)) {
+                addAggregate(&aggregates, &a);
+                lines++;
+            }
+        }
+        unmapFile(&file);
+    }
+
+    if (covered != salesLogSize()) {
+        rebuildAggregates();
+    } else if (lines > aggregates.count * 2 + 1000) {
+        saveAggregates();
+    } else {
+        stampFile(AGGREGATE_FILE, &aggregate_sync.journal);
+    }
+}
+
+// Adds the rows other tills appended to sales.agg since the last sync.
+// A rewritten file is loaded again from the top.
+void syncAggregates() {
+    FileStamp stamp;
+    stampFile(AGGREGATE_FILE, &stamp);
+    if (stamp.inode != aggregate_sync.journal.inode || stamp.size < aggregate_sync.journal.size) {
+        loadAggregates();
+        return;
+    }
+    if (stamp.size == aggregate_sync.journal.size) return;
+
+    MappedFile file;
+    if (!mapFile(AGGREGATE_FILE, &file)) return;
+    const char* cursor = file.data + (aggregate_sync.journal.size < (long long)file.size
+                                      ? aggregate_sync.journal.size : (long long)file.size);
+    StringView line;
+    while (nextLine(&cursor, file.data + file.size, &line)) {
+        SalesAggregate a;
+        if (line.len > 0 && line.data[0] != '@' && parseAggregateRow(line, &a)) {
+            addAggregate(&aggregates, &a);
+        }
+    }
+    aggregate_sync.journal = stamp;
+    aggregate_sync.journal.size = (long long)file.size;
+    unmapFile(&file);
+}
+
+// Adds one order's rows to table, also writing them to file when one is
+// given
+void applyOrderAggregates(AggregateTable* table, const Order* order, FILE* file) {
+    int day = dayKey(order->date);
+    int units = 0;
+    for (int i = 0; i < order->item_count; i++) {
+        units += order->items[i].quantity;
+    }
+
+    SalesAggregate rows[MAX_CART_ITEMS + 1];
+    int row_count = 0;
+    rows[row_count++] = (SalesAggregate){day, order->employee_id, AGGREGATE_ORDER_ROW, 1, units,
+                                         order->total_amount, order->discount, 0};
+    for (int i = 0; i < order->item_count; i++) {
+        const CartItem* item = &order->items[i];
+        rows[row_count++] = (SalesAggregate){day, order->employee_id, item->product_id, 0, item->quantity,
+                                             (item->quantity * item->price), 0,
+                                             item->quantity * item->cost};
+    }
+
+    for (int i = 0; i < row_count; i++) {
+        addAggregate(table, &rows[i]);
+        if (file) writeAggregateRow(file, &rows[i]);
+    }
+}
+
+// Adds a just-logged order to the store and appends its rows to sales.agg
+void recordOrderAggregates(const Order* order) {
+    lockStore();
+    FILE* file = fopen(AGGREGATE_FILE, "a");
+    applyOrderAggregates(&aggregates, order, file);
+    if (file) {
+        fprintf(file, "@%ld\n", salesLogSize());
+        fclose(file);
+        stampFile(AGGREGATE_FILE, &aggregate_sync.journal);
+    }
+    // Without the file the marker is stale and the store is rebuilt on
+    // next start
+    unlockStore();
+}
+
+// Per-day totals for one yyyymm month, in date order. days must hold 31.
+int collectMonthlySales(int month, DailySummary* days) {
+    DailySummary by_day[32];
+    memset(by_day, 0, sizeof(by_day));
+
+    for (int i = 0; i < aggregates.count; i++) {
+        SalesAggregate* a = &aggregates.rows[i];
+        int d = a->day % 100;
+        if (a->product_id != AGGREGATE_ORDER_ROW || a->day / 100 != month || d < 1 || d > 31) {
+            continue;
+        }
+        by_day[d].orders += a->orders;
+        by_day[d].items += a->items;
+        by_day[d].sales += a->gross;
+        by_day[d].discount += a->discount;
+    }
+
+    int days_count = 0;
+    for (int d = 1; d <= 31; d++) {
+        if (by_day[d].orders == 0) continue;
+        days[days_count] = by_day[d];
+        snprintf(days[days_count].date, sizeof(days[days_count].date), "%04u-%02u-%02u",
+                 (unsigned)month / 100 % 10000, (unsigned)month % 100, (unsigned)d);
+        days_count++;
+    }
+    return days_count;
+}
+
+// All-time totals per row of employees[]
+void collectEmployeeSales(EmployeeSummary* summary) {
+    for (int k = 0; k < aggregates.count; k++) {
+        SalesAggregate* a = &aggregates.rows[k];
+        if (a->product_id != AGGREGATE_ORDER_ROW) continue;
+        int i = findEmployeeIndex(a->employee_id);
+        if (i != -1) {
+            summary[i].orders += a->orders;
+            summary[i].items += a->items;
+            summary[i].sales += a->gross;
+            summary[i].discount += a->discount;
+        }
+    }
+}
+
+// All-time totals per row of products[]; returns 0 if nothing was sold
+int collectProductSales(ProductSummary* summary) {
+    int found = 0;
+    for (int k = 0; k < aggregates.count; k++) {
+        SalesAggregate* a = &aggregates.rows[k];
+        if (a->product_id == AGGREGATE_ORDER_ROW) continue;
+        int i = findProductIndex(a->product_id);
+        if (i != -1) {
+            summary[i].product_id = a->product_id;
+            summary[i].qty_sold += a->items;
+            summary[i].revenue += a->gross;
+            summary[i].cost += a->cost;
+            found = 1;
+        }
+    }
+    return found;
+}
+
+void writeCustomerRecord(FILE* file, const Customer* customer) {
+    fprintf(file, "%s,%s,%s,%s,%d,%d\n",
+            customer->phone,
+            customer->name,
+            customer->address,
+            moneyStr(customer->total_spending),
+            customer->loyalty_points,
+            customer->last_loyalty_milestone);
+}
+
+// Parses one customers.txt / customers.journal line
+int parseCustomerRecord(StringView line, Customer* customer) {
+    StringView phone = nextField(&line, ',');
+    StringView name = nextField(&line, ',');
+    StringView address = nextField(&line, ',');
+    StringView total_spending = nextField(&line, ',');
+    if (phone.len == 0 || name.len == 0 || address.len == 0 || total_spending.len == 0 ||
+        !viewInt(nextField(&line, ','), &customer->loyalty_points) ||
+        !viewInt(line, &customer->last_loyalty_milestone)) {
+        return 0;
+    }
+    customer->total_spending = viewMoney(total_spending);
+    customer->phone = internView(phone);
+    customer->name = internView(name);
+    customer->address = internView(address);
+    customer->dirty = 0;
+    return 1;
+}
+
+// Writes a full snapshot to customers.txt and clears the journal
+void saveCustomers() {
+    lockStore();
+    FILE* file = fopen("customers.txt.tmp", "w");
+    if (!file) {
+        RED_COLOR;
+        printf("\nError saving customers!\n");
+        RESET_COLOR;
+        unlockStore();
+        return;
+    }
+    
+    for (int i = 0; i < customer_count; i++) {
+        writeCustomerRecord(file, &customers[i]);
+    }
+    
+    if (fclose(file) != 0) {
+        RED_COLOR;
+        printf("\nError saving customers!\n");
+        RESET_COLOR;
+        remove("customers.txt.tmp");
+        unlockStore();
+        return;
+    }
+#ifdef _WIN32
+    remove("customers.txt");
+#endif
+    rename("customers.txt.tmp", "customers.txt");
+    remove(CUSTOMER_JOURNAL_FILE);
+    customer_journal_entries = 0;
+    stampFile("customers.txt", &customer_sync.snapshot);
+    memset(&customer_sync.journal, 0, sizeof(customer_sync.journal));
+
+    for (int i = 0; i < dirty_customer_count; i++) {
+        customers[dirty_customers[i]].dirty = 0;
+    }
+    dirty_customer_count = 0;
+    unlockStore();
+}
+
+// Upserts a row read from disk. A row this till has changed but not yet
+// flushed keeps its name, address and loyalty milestone, the things a till
+// edits before committing; spending on disk is newer, since it is only
+// added under the lock.
+void applyCustomerRecord(const Customer* record) {
+    int i = findCustomerIndex(record->phone);
+    if (i == -1) {
+        i = customer_count;
+        ensureCustomerCapacity(customer_count + 1);
+        customer_count++;
+        customers[i] = *record;
+        indexCustomer(i);
+        return;
+    }
+
+    Customer* customer = &customers[i];
+    if (customer->dirty) {
+        customer->total_spending = record->total_spending;
+        customer->loyalty_points = record->loyalty_points;
+        if (record->last_loyalty_milestone > customer->last_loyalty_milestone) {
+            customer->last_loyalty_milestone = record->last_loyalty_milestone;
+        }
+    } else {
+        *customer = *record;
+    }
+}
+
+// Applies customers.journal from byte offset on
+void replayCustomerJournal(long offset) {
+    if (offset == 0) customer_journal_entries = 0;
+
+    MappedFile journal;
+    FileStamp stamp;
+    stampFile(CUSTOMER_JOURNAL_FILE, &stamp);
+    if (!mapFile(CUSTOMER_JOURNAL_FILE, &journal)) {
+        customer_sync.journal = stamp;
+        return;
+    }
+
+    // Later rows for the same phone replace earlier ones
+    const char* cursor = journal.data + (offset < (long)journal.size ? offset : (long)journal.size);
+    StringView line;
+    Customer customer;
+    while (nextLine(&cursor, journal.data + journal.size, &line)) {
+        // A damaged line is skipped; the ones after it still count
+        if (line.len == 0 || !parseCustomerRecord(line, &customer)) continue;
+        applyCustomerRecord(&customer);
+        customer_journal_entries++;
+    }
+
+    customer_sync.journal = stamp;
+    customer_sync.journal.size = (long long)journal.size;
+    unmapFile(&journal);
+}
+
+// Catches up with other tills' customer changes. Rows this till hasn't
+// flushed yet are carried across a full reload.
+void syncCustomers() {
+    FileStamp snapshot, journal;
+    stampFile("customers.txt", &snapshot);
+    stampFile(CUSTOMER_JOURNAL_FILE, &journal);
+    if (sameFile(&snapshot, &customer_sync.snapshot) && journal.inode == customer_sync.journal.inode &&
+        journal.size >= customer_sync.journal.size) {
+        if (journal.size > customer_sync.journal.size) {
+            replayCustomerJournal((long)customer_sync.journal.size);
+        }
+        return;
+    }
+
+    int pending_count = dirty_customer_count;
+    Customer* pending = malloc((pending_count + 1) * sizeof(Customer));
+    for (int k = 0; k < pending_count; k++) {
+        pending[k] = customers[dirty_customers[k]];
+    }
+    dirty_customer_count = 0;
+
+    loadCustomers();
+    for (int k = 0; k < pending_count; k++) {
+        int i = findCustomerIndex(pending[k].phone);
+        if (i == -1) {
+            pending[k].dirty = 0;
+            applyCustomerRecord(&pending[k]);
+            i = findCustomerIndex(pending[k].phone);
+        } else {
+            // Same merge as applyCustomerRecord, from the other side
+            customers[i].name = pending[k].name;
+            customers[i].address = pending[k].address;
+            if (pending[k].last_loyalty_milestone > customers[i].last_loyalty_milestone) {
+                customers[i].last_loyalty_milestone = pending[k].last_loyalty_milestone;
+            }
+        }
+        markCustomerDirty(i);
+    }
+    free(pending);
+}
+
+void loadCustomers() {
+    customer_count = 0;
+
+    MappedFile file;
+    const char* cursor;
+    StringView line;
+    stampFile("customers.txt", &customer_sync.snapshot);
+    if (mapFile("customers.txt", &file)) {
+        Customer customer;
+        cursor = file.data;
+        while (nextLine(&cursor, file.data + file.size, &line)) {
+            if (line.len == 0) continue;
+            if (!parseCustomerRecord(line, &customer)) break;
+            ensureCustomerCapacity(customer_count + 1);
+            customers[customer_count++] = customer;
+        }
+        unmapFile(&file);
+    }
+    rebuildCustomerIndex();
+    replayCustomerJournal(0);
+}
+
+// Customer journal
+// Each sale touches one customer row, but rewriting customers.txt for
+// every change made a checkout cost O(customers) several times over.
+// Changed rows are now marked dirty and flushCustomers appends them, in
+// the customers.txt format, to customers.journal with one write at the
+// end of the operation; loadCustomers replays the journal as upserts.
+// saveCustomers folds it back into a snapshot once it grows past
+// CUSTOMER_JOURNAL_COMPACT_AT rows.
+void markCustomerDirty(int index) {
+    if (customers[index].dirty) return;
+    customers[index].dirty = 1;
+
+    if (dirty_customer_count == dirty_customer_capacity) {
+        dirty_customer_capacity = dirty_customer_capacity ? dirty_customer_capacity * 2 : 16;
+        dirty_customers = realloc(dirty_customers, dirty_customer_capacity * sizeof(int));
+    }
+    dirty_customers[dirty_customer_count++] = index;
+}
+
+void flushCustomers() {
+    if (dirty_customer_count == 0) return;
+
+    lockStore();
+    if (customer_journal_entries + dirty_customer_count >= CUSTOMER_JOURNAL_COMPACT_AT) {
+        saveCustomers();
+        unlockStore();
+        return;
+    }
+
+    FILE* file = openJournal(CUSTOMER_JOURNAL_FILE);
+    if (!file) {
+        // Rows stay dirty and go out with the next flush
+        RED_COLOR;
+        printf("\nError saving customers!\n");
+        RESET_COLOR;
+        unlockStore();
+        return;
+    }
+
+    for (int i = 0; i < dirty_customer_count; i++) {
+        writeCustomerRecord(file, &customers[dirty_customers[i]]);
+        customers[dirty_customers[i]].dirty = 0;
+    }
+    customer_journal_entries += dirty_customer_count;
+    dirty_customer_count = 0;
+
+    fclose(file);
+    stampFile(CUSTOMER_JOURNAL_FILE, &customer_sync.journal);
+    unlockStore();
+}
+
+void rebuildCustomerIndex() {
+    int capacity = 64;
+    while (capacity < customer_count * 2) capacity *= 2;
+
+    if (capacity != customer_slot_capacity) {
+        free(customer_slots);
+        customer_slots = malloc(capacity * sizeof(int));
+        customer_slot_capacity = capacity;
+    }
+    memset(customer_slots, 0, capacity * sizeof(int));
+
+    for (int i = 0; i < customer_count; i++) {
+        unsigned int slot = hashString(customers[i].phone) & (capacity - 1);
+        while (customer_slots[slot] != 0) {
+            slot = (slot + 1) & (capacity - 1);
+        }
+        customer_slots[slot] = i + 1;
+    }
+}
+
+void indexCustomer(int index) {
+    if (customer_count * 2 > customer_slot_capacity) {
+        rebuildCustomerIndex();
+        return;
+    }
+
+    unsigned int slot = hashString(customers[index].phone) & (customer_slot_capacity - 1);
+    while (customer_slots[slot] != 0) {
+        slot = (slot + 1) & (customer_slot_capacity - 1);
+    }
+    customer_slots[slot] = index + 1;
+}
+
+int findCustomerIndex(const char* phone) {
+    if (customer_slot_capacity == 0) return -1;
+
+    unsigned int slot = hashString(phone) & (customer_slot_capacity - 1);
+    while (customer_slots[slot] != 0) {
+        int index = customer_slots[slot] - 1;
+        if (strcmp(customers[index].phone, phone) == 0) return index;
+        slot = (slot + 1) & (customer_slot_capacity - 1);
+    }
+    return -1;
+}
+
+Money applyDiscount(Money amount, const char* phone) {
+    Money discount = 0;
+    
+    // Find customer
+    int i = findCustomerIndex(phone);
+    if (i != -1) {
+        // Loyalty discount
+        if (customers[i].total_spending >= TAKA(LOYALTY_THRESHOLD)) {
+            discount = percentOf(amount, 10); // 10% discount for loyal customers
+        }
+    }
+    
+    return discount;
+}
+
+void viewSalesHistory() {
+    printHeader("SALES HISTORY");
+    
+    SalesLedger ledger;
+    if (!loadSalesLedger(&ledger)) {
+        YELLOW_COLOR;
+        printf("\nNo sales history found!\n");
+        RESET_COLOR;
+        pauseFor(2);
+        return;
+    }
+    
+    Money total_sales = 0;
+    int total_orders = 0;
+    
+    printf("\nID\tDate\t\t\tCustomer\t\tPhone\t\tAmount\t\tDiscount\n");
+    printLine();
+    
+    for (int o = 0; o < ledger.order_count; o++) {
+        LedgerOrder* order = &ledger.orders[o];
+        
+        if (strcmp(current_user.role, "admin") != 0 && 
+            order->employee_id != current_user.id) {
+            continue;
+        }
+        
+        char customer_name[MAX_STRING] = "Guest";
+        int i = findCustomerIndex(order->customer_phone);
+        if (i != -1) {
+            strcpy(customer_name, customers[i].name);
+        }
+        
+        printf("%ld\t%-20s%-16s%-16s%s\t\t%s\n",
+               order->id,
+               order->date,
+               customer_name,
+               order->customer_phone,
+               moneyStr(order->total_amount),
+               moneyStr(order->discount));
+        
+        total_sales += order->total_amount;
+        total_orders++;
+    }
+    
+    freeSalesLedger(&ledger);
+    
+    printLine();
+    printf("\nTotal Orders: %d", total_orders);
+    printf("\nTotal Sales: %s\n", moneyStr(total_sales));
+    
+    printf("\nPress Enter to continue...");
+    promptChar();
+}
+
+void updateCustomer() {
+    char phone[MAX_STRING];
+    printHeader("UPDATE CUSTOMER");
+    
+    printf("\nEnter Customer Phone Number: ");
+    promptScanf("%s", phone);
+    
+    int i = findCustomerIndex(phone);
+    if (i != -1) {
+        printf("\nCurrent Details:");
+        printf("\nName: %s", customers[i].name);
+        printf("\nPhone: %s", customers[i].phone);
+        printf("\nAddress: %s", customers[i].address);
+        printf("\nTotal Spending: %s", moneyStr(customers[i].total_spending));
+        printf("\nLoyalty Points: %d", customers[i].loyalty_points);
+        
+        printf("\n\nEnter new details (press Enter to keep current value):\n");
+        char input[MAX_STRING];
+        promptChar();
+        
+        printf("Name: ");
+        promptLine(input, MAX_STRING);
+        if (input[0] != '\n') {
+            input[strcspn(input, "\n")] = 0;
+            customers[i].name = internString(input);
+        }
+        
+        printf("Address: ");
+        promptLine(input, MAX_STRING);
+        if (input[0] != '\n') {
+            input[strcspn(input, "\n")] = 0;
+            customers[i].address = internString(input);
+        }
+        
+        markCustomerDirty(i);
+        flushCustomers();
+        
+        GREEN_COLOR;
+        printf("\nCustomer updated successfully!\n");
+        RESET_COLOR;
+        pauseFor(2);
+        return;
+    }
+    
+    RED_COLOR;
+    printf("\nCustomer not found!\n");
+    RESET_COLOR;
+    pauseFor(2);
+}
+void updateEmployeeTotalSales(int employee_id, Money sale_amount) {
+    int i = findEmployeeIndex(employee_id);
+    if (i == -1) {
+        RED_COLOR;
+        printf("\nEmployee ID %d not found!\n", employee_id);
+        RESET_COLOR;
+        return;
+    }
+
+    employees[i].total_sales += sale_amount;
+    employees[i].unsaved_sales += sale_amount;
+    if (employees[i].id == current_user.id) {
+        current_user.total_sales = employees[i].total_sales;
+    }
+    employees_dirty = 1;
+    flushEmployees(0);
+
+    if (!headless) {
+        GREEN_COLOR;
+        printf("\nEmployee sales updated successfully!\n");
+        RESET_COLOR;
+    }
+}
+
+// Employee table
+// employees.txt is small but was re-read by login and every staff report,
+// and rewritten through temp.txt for every sale. It is now loaded once
+// into employees[] with open-addressing indexes on id and username.
+// total_sales changes only mark the table dirty; flushEmployees writes it
+// back at most every EMPLOYEE_FLUSH_INTERVAL seconds, on logout and at
+// exit. Sales themselves are durable in the sales log, so a crash can only
+// lose a few seconds of this running total. Other tills save their own
+// totals, so saveEmployees adds this till's unsaved sales to what is on
+// disk rather than writing its own view over it.
+
+// Parses one employees.txt line: id,name,username,password,role,total_sales
+int parseEmployeeRecord(StringView line, Employee* emp) {
+    if (!viewInt(nextField(&line, ','), &emp->id)) return 0;
+    viewCopy(emp->name, sizeof(emp->name), nextField(&line, ','));
+    viewCopy(emp->username, sizeof(emp->username), nextField(&line, ','));
+    viewCopy(emp->password, sizeof(emp->password), nextField(&line, ','));
+    viewCopy(emp->role, sizeof(emp->role), nextField(&line, ','));
+    if (line.len == 0) return 0;
+    emp->total_sales = viewMoney(line);
+    emp->unsaved_sales = 0;
+    return 1;
+}
+
+void loadEmployees() {
+    employee_count = 0;
+
+    MappedFile file;
+    if (mapFile("employees.txt", &file)) {
+        const char* cursor = file.data;
+        StringView line;
+        while (nextLine(&cursor, file.data + file.size, &line)) {
+            Employee emp;
+            if (line.len == 0) continue;
+            if (!parseEmployeeRecord(line, &emp)) break;
+            ensureEmployeeCapacity(employee_count + 1);
+            employees[employee_count++] = emp;
+        }
+        unmapFile(&file);
+    }
+
+    rebuildEmployeeIndex();
+    employees_dirty = 0;
+    employees_flushed_at = time(NULL);
+}
+
+// Takes the saved totals from employees.txt, plus this till's unsaved
+// sales, and picks up employees registered on other tills
+void mergeEmployeeTotals() {
+    MappedFile file;
+    if (!mapFile("employees.txt", &file)) return;
+
+    int added = 0;
+    const char* cursor = file.data;
+    StringView line;
+    while (nextLine(&cursor, file.data + file.size, &line)) {
+        Employee emp;
+        if (line.len == 0) continue;
+        if (!parseEmployeeRecord(line, &emp)) break;
+        int i = findEmployeeIndex(emp.id);
+        if (i == -1) {
+            ensureEmployeeCapacity(employee_count + 1);
+            employees[employee_count++] = emp;
+            added = 1;
+        } else {
+            employees[i].total_sales = emp.total_sales + employees[i].unsaved_sales;
+            if (employees[i].id == current_user.id) {
+                current_user.total_sales = employees[i].total_sales;
+            }
+        }
+    }
+    unmapFile(&file);
+    if (added) rebuildEmployeeIndex();
+}
+
+void saveEmployees() {
+    lockStore();
+    mergeEmployeeTotals();
+    FILE* file = fopen("employees.txt.tmp", "w");
+    if (!file) {
+        RED_COLOR;
+        printf("\nError saving employees!\n");
+        RESET_COLOR;
+        unlockStore();
+        return;
+    }
+
+    for (int i = 0; i < employee_count; i++) {
+        fprintf(file, "%d,%s,%s,%s,%s,%s\n",
+                employees[i].id, employees[i].name, employees[i].username,
+                employees[i].password, employees[i].role, moneyStr(employees[i].total_sales));
+    }
+
+    if (fclose(file) != 0) {
+        RED_COLOR;
+        printf("\nError saving employees!\n");
+        RESET_COLOR;
+        remove("employees.txt.tmp");
+        unlockStore();
+        return;
+    }
+#ifdef _WIN32
+    remove("employees.txt");
+#endif
+    rename("employees.txt.tmp", "employees.txt");
+    for (int i = 0; i < employee_count; i++) {
+        employees[i].unsaved_sales = 0;
+    }
+    employees_dirty = 0;
+    employees_flushed_at = time(NULL);
+    unlockStore();
+}
+
+void flushEmployees(int force) {
+    if (!employees_dirty) return;
+    if (!force && time(NULL) - employees_flushed_at < EMPLOYEE_FLUSH_INTERVAL) return;
+    saveEmployees();
+}
+
+void flushEmployeesAtExit() {
+    flushEmployees(1);
+}
+
+// Ctrl+C is how most sessions end. exit() and the flushes it runs are not
+// safe inside a signal handler, so the handler only notes the signal and
+// the next prompt, pause or command exits.
+volatile sig_atomic_t exit_signal = 0;
+
+void handleExitSignal(int sig) {
+    exit_signal = sig;
+}
+
+void checkExitRequest() {
+    if (exit_signal) exit(128 + exit_signal);
+}
+
+void installExitHandlers() {
+#ifdef _WIN32
+    signal(SIGINT, handleExitSignal);
+    signal(SIGTERM, handleExitSignal);
+#else
+    // Without SA_RESTART, a prompt waiting for input returns at once
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = handleExitSignal;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+#endif
+}
+
+void rebuildEmployeeIndex() {
+    int capacity = 64;
+    while (capacity < employee_count * 2) capacity *= 2;
+
+    if (capacity != employee_slot_capacity) {
+        free(employee_id_slots);
+        free(employee_username_slots);
+        employee_id_slots = malloc(capacity * sizeof(int));
+        employee_username_slots = malloc(capacity * sizeof(int));
+        employee_slot_capacity = capacity;
+    }
+    memset(employee_id_slots, 0, capacity * sizeof(int));
+    memset(employee_username_slots, 0, capacity * sizeof(int));
+
+    // Earlier rows win on duplicates, as the old linear scans did
+    for (int i = 0; i < employee_count; i++) {
+        unsigned int slot = hashProductId(employees[i].id) & (capacity - 1);
+        while (employee_id_slots[slot] != 0) {
+            slot = (slot + 1) & (capacity - 1);
+        }
+        employee_id_slots[slot] = i + 1;
+
+        slot = hashString(employees[i].username) & (capacity - 1);
+        while (employee_username_slots[slot] != 0) {
+            slot = (slot + 1) & (capacity - 1);
+        }
+        employee_username_slots[slot] = i + 1;
+    }
+}
+
+int findEmployeeIndex(int id) {
+    if (employee_slot_capacity == 0) return -1;
+    unsigned int slot = hashProductId(id) & (employee_slot_capacity - 1);
+    while (employee_id_slots[slot] != 0) {
+        int i = employee_id_slots[slot] - 1;
+        if (employees[i].id == id) return i;
+        slot = (slot + 1) & (employee_slot_capacity - 1);
+    }
+    return -1;
+}
+
+int findEmployeeByUsername(const char* username) {
+    if (employee_slot_capacity == 0) return -1;
+    unsigned int slot = hashString(username) & (employee_slot_capacity - 1);
+    while (employee_username_slots[slot] != 0) {
+        int i = employee_username_slots[slot] - 1;
+        if (strcmp(employees[i].username, username) == 0) return i;
+        slot = (slot + 1) & (employee_slot_capacity - 1);
+    }
+    return -1;
+}
+void generateMonthlySalesReportContent(OutputBuffer* out) {
+    char month[8];
+    time_t t = time(NULL);
+    struct tm* tm = localtime(&t);
+    strftime(month, sizeof(month), "%Y-%m", tm);
+
+    outPrintf(out, "<style>\n");
+    outPrintf(out, "table { width: 100%%; border-collapse: collapse; margin: 20px 0; }\n");
+    outPrintf(out, "th, td { padding: 10px; border: 1px solid #ddd; text-align: left; }\n");
+    outPrintf(out, "th { background-color: #4CAF50; color: white; }\n");
+    outPrintf(out, "tr:nth-child(even) { background-color: #f2f2f2; }\n");
+    outPrintf(out, ".summary { margin: 20px 0; padding: 20px; background: #f9f9f9; border: 1px solid #ddd; }\n");
+    outPrintf(out, "</style>\n");
+
+    outPrintf(out, "<div style='text-align: center; margin-bottom: 30px;'>\n");
+    outPrintf(out, "<h1 style='color: #4CAF50;'>Monthly Sales Report</h1>\n");
+    outPrintf(out, "<h2>%s</h2>\n", month);
+    outPrintf(out, "</div>\n");
+
+    outPrintf(out, "<div class='content'>\n");
+    outPrintf(out, "<h3>Daily Sales Breakdown</h3>\n");
+    outPrintf(out, "<table>\n");
+    outPrintf(out, "<thead>\n");
+    outPrintf(out, "<tr>\n");
+    outPrintf(out, "<th>Date</th>\n");
+    outPrintf(out, "<th>Orders</th>\n");
+    outPrintf(out, "<th>Items Sold</th>\n");
+    outPrintf(out, "<th>Total Sales</th>\n");
+    outPrintf(out, "<th>Total Discount</th>\n");
+    outPrintf(out, "<th>Net Sales</th>\n");
+    outPrintf(out, "</tr>\n");
+    outPrintf(out, "</thead>\n");
+    outPrintf(out, "<tbody>\n");
+
+    DailySummary daily_summary[31];
+    int days_count = collectMonthlySales(monthKey(month), daily_summary);
+
+    Money monthly_total = 0, monthly_discount = 0;
+    int monthly_orders = 0, monthly_items = 0;
+    for (int i = 0; i < days_count; i++) {
+        monthly_orders += daily_summary[i].orders;
+        monthly_items += daily_summary[i].items;
+        monthly_total += daily_summary[i].sales;
+        monthly_discount += daily_summary[i].discount;
+    }
+
+    for (int i =0; i < days_count; i++) {
+        outPrintf(out, "<tr>\n");
+        outPrintf(out, "<td>%s</td>\n", daily_summary[i].date);
+        outPrintf(out, "<td>%d</td>\n", daily_summary[i].orders);
+        outPrintf(out, "<td>%d</td>\n", daily_summary[i].items);
+        outPrintf(out, "<td>%s</td>\n", moneyStr(daily_summary[i].sales));
+        outPrintf(out, "<td>%s</td>\n", moneyStr(daily_summary[i].discount));
+        outPrintf(out, "<td>%s</td>\n", moneyStr(daily_summary[i].sales - daily_summary[i].discount));
+        outPrintf(out, "</tr>\n");
+    }
+
+    outPrintf(out, "</tbody>\n");
+    outPrintf(out, "</table>\n");
+
+    outPrintf(out, "<div class='summary'>\n");
+    outPrintf(out, "<h3 style='color: #4CAF50;'>Monthly Summary</h3>\n");
+    outPrintf(out, "<table style='width: 50%%; margin: 20px auto;'>\n");
+    outPrintf(out, "<tr><td><strong>Total Days with Sales:</strong></td><td>%d</td></tr>\n", days_count);
+    outPrintf(out, "<tr><td><strong>Total Orders:</strong></td><td>%d</td></tr>\n", monthly_orders);
+    outPrintf(out, "<tr><td><strong>Total Items Sold:</strong></td><td>%d</td></tr>\n", monthly_items);
+    outPrintf(out, "<tr><td><strong>Total Sales:</strong></td><td>%s</td></tr>\n", moneyStr(monthly_total));
+    outPrintf(out, "<tr><td><strong>Total Discounts:</strong></td><td>%s</td></tr>\n", moneyStr(monthly_discount));
+    outPrintf(out, "<tr><td><strong>Net Sales:</strong></td><td>%s</td></tr>\n", moneyStr(monthly_total - monthly_discount));
+    outPrintf(out, "<tr><td><strong>Average Daily Sales:</strong></td><td>%s</td></tr>\n", 
+            moneyStr(days_count > 0 ? (monthly_total - monthly_discount)/days_count : 0));
+    outPrintf(out, "<tr><td><strong>Average Order Value:</strong></td><td>%s</td></tr>\n", 
+            moneyStr(monthly_orders > 0 ? (monthly_total - monthly_discount)/monthly_orders : 0));
+    outPrintf(out, "</table>\n");
+    outPrintf(out, "</div>\n");
+    outPrintf(out, "</div>\n");
+}
+
+void generateMonthlySalesReportCSV(OutputBuffer* out) {
+    char month[8];
+    time_t t = time(NULL);
+    struct tm* tm = localtime(&t);
+    strftime(month, sizeof(month), "%Y-%m", tm);
+
+    outPrintf(out, "Monthly Sales Report - %s\n\n", month);
+    outPrintf(out, "Date,Orders,Items Sold,Total Sales,Total Discount,Net Sales\n");
+
+    if (aggregates.count == 0) return;
+
+    DailySummary daily_summary[31];
+    int days_count = collectMonthlySales(monthKey(month), daily_summary);
+
+    Money monthly_total = 0, monthly_discount = 0;
+    int monthly_orders = 0, monthly_items = 0;
+    for (int i = 0; i < days_count; i++) {
+        monthly_orders += daily_summary[i].orders;
+        monthly_items += daily_summary[i].items;
+        monthly_total += daily_summary[i].sales;
+        monthly_discount += daily_summary[i].discount;
+    }
+
+    for (int i =0; i < days_count; i++) {
+        outPrintf(out, "%s,%d,%d,%s,%s,%s\n",
+               daily_summary[i].date,
+               daily_summary[i].orders,
+               daily_summary[i].items,
+               moneyStr(daily_summary[i].sales),
+               moneyStr(daily_summary[i].discount),
+               moneyStr(daily_summary[i].sales - daily_summary[i].discount));
+    }
+
+    outPrintf(out, "\nMonthly Summary\n");
+    outPrintf(out, "Total Days with Sales,%d\n", days_count);
+    outPrintf(out, "Total Orders,%d\n", monthly_orders);
+    outPrintf(out, "Total Items Sold,%d\n", monthly_items);
+    outPrintf(out, "Total Sales,%s\n", moneyStr(monthly_total));
+    outPrintf(out, "Total Discounts,%s\n", moneyStr(monthly_discount));
+    outPrintf(out, "Net Sales,%s\n", moneyStr(monthly_total - monthly_discount));
+    outPrintf(out, "Average Daily Sales,%s\n", 
+            moneyStr(days_count > 0 ? (monthly_total - monthly_discount)/days_count : 0));
+    outPrintf(out, "Average Order Value,%s\n", 
+            moneyStr(monthly_orders > 0 ? (monthly_total - monthly_discount)/monthly_orders : 0));
+}
+
+// Employee Sales Report Generators
+void generateEmployeeSalesReportContent(OutputBuffer* out) {
+    outPrintf(out, "<h2>Employee Sales Report</h2>\n");
+    
+    outPrintf(out, "<style>\n");
+    outPrintf(out, "table { width: 100%%; border-collapse: collapse; margin: 20px 0; }\n");
+    outPrintf(out, "th, td { padding: 8px; border: 1px solid #ddd; text-align: left; }\n");
+    outPrintf(out, "th { background-color: #4CAF50; color: white; }\n");
+    outPrintf(out, ".summary { margin-top: 20px; }\n");
+    outPrintf(out, "</style>\n");
+
+    // Start employee sales table
+    outPrintf(out, "<table>\n");
+    outPrintf(out, "<tr><th>Name</th><th>Orders</th><th>Items</th>");
+    outPrintf(out, "<th>Sales</th><th>Discount</th><th>Net Sales</th></tr>\n");
+    
+    if (aggregates.count == 0) return;
+
+    EmployeeSummary* emp_summary = calloc(employee_count + 1, sizeof(EmployeeSummary));
+    collectEmployeeSales(emp_summary);
+
+    Money total_sales = 0, total_discount = 0;
+    int total_orders = 0, total_items = 0;
+
+    for (int i = 0; i < employee_count; i++) {
+        if (emp_summary[i].orders > 0) {
+            outPrintf(out, "<tr><td>%s</td><td>%d</td><td>%d</td><td>%s</td><td>%s</td><td>%s</td></tr>\n",
+                   employees[i].name,
+                   emp_summary[i].orders,
+                   emp_summary[i].items,
+                   moneyStr(emp_summary[i].sales),
+                   moneyStr(emp_summary[i].discount),
+                   moneyStr(emp_summary[i].sales - emp_summary[i].discount));
+
+            total_orders += emp_summary[i].orders;
+            total_items += emp_summary[i].items;
+            total_sales += emp_summary[i].sales;
+            total_discount += emp_summary[i].discount;
+        }
+    }
+    free(emp_summary);
+    outPrintf(out, "</table>\n");
+
+    outPrintf(out, "<div class='summary'>\n");
+    outPrintf(out, "<h3>Overall Summary</h3>\n");
+    outPrintf(out, "<p><strong>Total Orders:</strong> %d</p>\n", total_orders);
+    outPrintf(out, "<p><strong>Total Items Sold:</strong> %d</p>\n", total_items);
+    outPrintf(out, "<p><strong>Total Sales:</strong> %s</p>\n", moneyStr(total_sales));
+    outPrintf(out, "<p><strong>Total Discounts:</strong> %s</p>\n", moneyStr(total_discount));
+    outPrintf(out, "<p><strong>Net Sales:</strong> %s</p>\n", moneyStr(total_sales - total_discount));
+    outPrintf(out, "</div>\n");
+}
+
+void generateEmployeeSalesReportCSV(OutputBuffer* out) {
+    outPrintf(out, "Employee Sales Report\n\n");
+    outPrintf(out, "Employee,Orders,Items Sold,Total Sales,Total Discount,Net Sales\n");
+
+    if (aggregates.count == 0) return;
+
+    EmployeeSummary* emp_summary = calloc(employee_count + 1, sizeof(EmployeeSummary));
+    collectEmployeeSales(emp_summary);
+
+    Money total_sales = 0, total_discount = 0;
+    int total_orders = 0, total_items = 0;
+
+    for (int i = 0; i < employee_count; i++) {
+        if (emp_summary[i].orders > 0) {
+            outPrintf(out, "%s,%d,%d,%s,%s,%s\n",
+                   employees[i].name,
+                   emp_summary[i].orders,
+                   emp_summary[i].items,
+                   moneyStr(emp_summary[i].sales),
+                   moneyStr(emp_summary[i].discount),
+                   moneyStr(emp_summary[i].sales - emp_summary[i].discount));
+
+            total_orders += emp_summary[i].orders;
+            total_items += emp_summary[i].items;
+            total_sales += emp_summary[i].sales;
+            total_discount += emp_summary[i].discount;
+        }
+    }
+    free(emp_summary);
+
+    outPrintf(out, "\nOverall Summary\n");
+    outPrintf(out, "Total Orders,%d\n", total_orders);
+    outPrintf(out, "Total Items Sold,%d\n", total_items);
+    outPrintf(out, "Total Sales,%s\n", moneyStr(total_sales));
+    outPrintf(out, "Total Discounts,%s\n", moneyStr(total_discount));
+    outPrintf(out, "Net Sales,%s\n", moneyStr(total_sales - total_discount));
+}
+
+void generateDailySalesReportCSV(OutputBuffer* out) {
+    char date[11];
+    time_t t = time(NULL);
+    struct tm* tm = localtime(&t);
+    strftime(date, sizeof(date), "%Y-%m-%d", tm);
+
+    outPrintf(out, "Daily Sales Report - %s\n\n", date);
+    outPrintf(out, "Time,Order ID,Customer,Items,Amount,Discount,Net Amount\n");
+
+    Money total_sales = 0, total_discount = 0;
+    int total_orders = 0;
+
+    SalesLedger ledger;
+    loadSalesLedgerRange(&ledger, dayKey(date) / 100, dayKey(date) / 100);
+    for (int k = 0; k < ledger.order_count; k++) {
+        LedgerOrder* order = &ledger.orders[k];
+
+        if (strstr(order->date, date)) {
+            // Same processing as HTML version but with CSV formatting
+            char customer_name[MAX_STRING] = "Guest";
+            int i = findCustomerIndex(order->customer_phone);
+            if (i != -1) {
+                strcpy(customer_name, customers[i].name);
+            }
+
+            char time_str[9];
+            strncpy(time_str, order->date + 11, 8);
+            time_str[8] = '\0';
+
+            outPrintf(out, "%s,%ld,%s,%d,%s,%s,%s\n",
+                   time_str, order->id, customer_name, order->item_units,
+                   moneyStr(order->total_amount), moneyStr(order->discount),
+                   moneyStr(order->total_amount - order->discount));
+
+            total_sales += order->total_amount;
+            total_discount += order->discount;
+            total_orders++;
+        }
+    }
+    freeSalesLedger(&ledger);
+
+    outPrintf(out, "\nDaily Summary\n");
+    outPrintf(out, "Total Orders,%d\n", total_orders);
+    outPrintf(out, "Total Sales,%s\n", moneyStr(total_sales));
+    outPrintf(out, "Total Discounts,%s\n", moneyStr(total_discount));
+    outPrintf(out, "Net Sales,%s\n", moneyStr(total_sales - total_discount));
+}
+
+char* getCurrentDateTime(void) {
+    static char datetime[20];
+    time_t t = time(NULL);
+    struct tm* tm = localtime(&t);
+    strftime(datetime, sizeof(datetime), "%Y-%m-%d %H:%M:%S", tm);
+    return datetime;
+}
+
+void generateDailySalesReportContent(OutputBuffer* out) {
+    char date[11];
+    time_t t = time(NULL);
+    struct tm* tm = localtime(&t);
+    strftime(date, sizeof(date), "%Y-%m-%d", tm);
+
+    outPrintf(out, "<h2>Daily Sales Report</h2>\n");
+    outPrintf(out, "<p><strong>Date:</strong> %s</p>\n", date);
+    outPrintf(out, "<table>\n");
+    outPrintf(out, "<tr><th>Time</th><th>Order ID</th><th>Customer</th><th>Items</th><th>Amount</th><th>Discount</th><th>Net Amount</th></tr>\n");
+
+    Money total_sales = 0, total_discount = 0;
+    int total_orders = 0, total_items = 0;
+
+    SalesLedger ledger;
+    loadSalesLedgerRange(&ledger, dayKey(date) / 100, dayKey(date) / 100);
+    for (int k = 0; k < ledger.order_count; k++) {
+        LedgerOrder* order = &ledger.orders[k];
+
+        if (strstr(order->date, date)) {
+            // Get customer name
+            char customer_name[MAX_STRING] = "Guest";
+            int i = findCustomerIndex(order->customer_phone);
+            if (i != -1) {
+                strcpy(customer_name, customers[i].name);
+            }
+
+            // Extract time from date
+            char time_str[9];
+            strncpy(time_str, order->date + 11, 8);
+            time_str[8] = '\0';
+
+            // Write order row
+            outPrintf(out, "<tr><td>%s</td><td>%ld</td><td>%s</td><td>%d</td><td>%s</td><td>%s</td><td>%s</td></tr>\n",
+                   time_str,
+                   order->id,
+                   customer_name,
+                   order->item_units,
+                   moneyStr(order->total_amount),
+                   moneyStr(order->discount),
+                   moneyStr(order->total_amount - order->discount));
+
+            total_sales += order->total_amount;
+            total_discount += order->discount;
+            total_orders++;
+            total_items += order->item_units;
+        }
+    }
+    freeSalesLedger(&ledger);
+
+    outPrintf(out, "</table>\n");
+    
+    // Write summary
+    outPrintf(out, "<div class='summary'>\n");
+    outPrintf(out, "<h3>Daily Summary</h3>\n");
+    outPrintf(out, "<p><strong>Total Orders:</strong> %d</p>\n", total_orders);
+    outPrintf(out, "<p><strong>Total Items Sold:</strong> %d</p>\n", total_items);
+    outPrintf(out, "<p><strong>Total Sales:</strong> %s</p>\n", moneyStr(total_sales));
+    outPrintf(out, "<p><strong>Total Discounts:</strong> %s</p>\n", moneyStr(total_discount));
+    outPrintf(out, "<p><strong>Net Sales:</strong> %s</p>\n", moneyStr(total_sales - total_discount));
+    outPrintf(out, "<p><strong>Average Order Value:</strong> %s</p>\n", 
+            moneyStr(total_orders > 0 ? (total_sales - total_discount + total_orders / 2) / total_orders : 0));
+    outPrintf(out, "</div>\n");
+}
+
+void openPDF(const char* filename) {
+    #ifdef _WIN32
+        char command[512];
+        sprintf(command, "start %s", filename);
+    #else
+        char command[512];
+        sprintf(command, "open %s", filename);  // 'open' command for macOS
+    #endif
+    system(command);
+}
+
+// Benchmark
+// "shop bench [orders] [directory]" builds a synthetic shop in directory
+// (default bench_data) and times the hot paths headlessly: loading the
+// tables, lookups, the checkout persistence path and every report
+// generator. Each case runs a number of iterations and reports
+// throughput along with p50/p99 iteration latency. Console output from
+// the code under test goes to the null device while it runs.
+#ifdef _WIN32
+    #define NULL_DEVICE "NUL"
+#else
+    #define NULL_DEVICE "/dev/null"
+#endif
+
+unsigned int bench_seed = 42;
+int saved_stdout = -1;
+
+unsigned int benchRandom() {
+    // xorshift32: fast and reproducible across runs
+    bench_seed ^= bench_seed << 13;
+    bench_seed ^= bench_seed >> 17;
+    bench_seed ^= bench_seed << 5;
+    return bench_seed;
+}
+
+double nowSeconds() {
+#ifdef _WIN32
+    LARGE_INTEGER frequency, counter;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+    return (double)counter.QuadPart / frequency.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+#endif
+}
+
+void silenceStdout() {
+    fflush(stdout);
+    saved_stdout = dup(fileno(stdout));
+    FILE* null_file = fopen(NULL_DEVICE, "w");
+    if (null_file) {
+        dup2(fileno(null_file), fileno(stdout));
+        fclose(null_file);
+    }
+}
+
+void restoreStdout() {
+    fflush(stdout);
+    dup2(saved_stdout, fileno(stdout));
+    close(saved_stdout);
+}
+
+int compareDoubles(const void* a, const void* b) {
+    double x = *(const double*)a;
+    double y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+// Prints one result row; ops_per_iteration scales cheap operations that
+// are timed in batches
+void reportBenchmark(const char* name, double* latencies, int iterations, int ops_per_iteration) {
+    double total = 0;
+    for (int i = 0; i < iterations; i++) total += latencies[i];
+    qsort(latencies, iterations, sizeof(double), compareDoubles);
+
+    double p50 = latencies[(iterations - 1) / 2];
+    double p99 = latencies[(int)((iterations - 1) * 0.99)];
+    printf("%-36s%10d%14.0f%12.3f%12.3f\n",
+           name,
+           iterations * ops_per_iteration,
+           total > 0 ? iterations * ops_per_iteration / total : 0,
+           p50 * 1000,
+           p99 * 1000);
+}
+
+void generateBenchmarkData(int order_count, int product_total, int customer_total, int employee_total) {
+    static const char* categories[] = {
+        "grocery", "dairy", "bakery", "beverage", "snacks",
+        "household", "personal", "frozen", "produce", "mobile"
+    };
+
+    FILE* file = fopen("products.txt", "w");
+    for (int i = 1; i <= product_total; i++) {
+        Money purchase = TAKA(10 + benchRandom() % 2000);
+        fprintf(file, "%d,Product %d,%s,%d,%s,%s,2024-01-01 09:00:00\n",
+                i, i, categories[i % 10], 100000 + benchRandom() % 1000,
+                moneyStr(purchase), moneyStr(purchase * 5 / 4));
+    }
+    fclose(file);
+
+    file = fopen("customers.txt", "w");
+    for (int i = 0; i < customer_total; i++) {
+        fprintf(file, "01%09d,Customer %d,Area %d,0.00,0,0\n", i, i, i % 50);
+    }
+    fclose(file);
+
+    file = fopen("employees.txt", "w");
+    fprintf(file, "1,Administrator,admin,admin123,admin,0.00\n");
+    for (int i = 2; i <= employee_total; i++) {
+        fprintf(file, "%d,Employee %d,user%d,pass%d,employee,0.00\n", i, i, i, i);
+    }
+    fclose(file);
+
+    remove(SALES_LOG_FILE);
+    removeSalesPartitions();
+    remove(PRODUCT_JOURNAL_FILE);
+    remove(CUSTOMER_JOURNAL_FILE);
+    remove(AGGREGATE_FILE);
+
+    // Orders are spread over the year before today, oldest first
+    loadProducts();
+    SalesLogWriter log = {NULL, 0, 1, 0};
+    unsigned char buf[SALES_LOG_RECORD_SIZE(MAX_CART_ITEMS)];
+    time_t start = time(NULL) - 365 * 24 * 3600;
+    for (int k = 0; k < order_count; k++) {
+        Order order;
+        memset(&order, 0, sizeof(order));
+        time_t when = start + (time_t)((double)k / order_count * 365 * 24 * 3600);
+        order.id = 1000000000L + k;
+        sprintf(order.customer_phone, "01%09d", benchRandom() % customer_total);
+        order.employee_id = 1 + benchRandom() % employee_total;
+        strftime(order.date, sizeof(order.date), "%Y-%m-%d %H:%M:%S", localtime(&when));
+
+        order.item_count = 1 + benchRandom() % 5;
+        for (int j = 0; j < order.item_count; j++) {
+            Product* product = &products[benchRandom() % product_count];
+            order.items[j].product_id = product->id;
+            order.items[j].quantity = 1 + benchRandom() % 3;
+            order.items[j].price = product->sale_price;
+            order.items[j].cost = product->purchase_price;
+            order.total_amount += order.items[j].quantity * order.items[j].price;
+        }
+        order.discount = (benchRandom() % 4 == 0) ? percentOf(order.total_amount, 5) : 0;
+        order.payment_method = PAYMENT_CASH + benchRandom() % 5;
+
+        size_t size = encodeOrderRecord(&order, order.items, order.item_count, buf);
+        writeSalesRecord(&log, monthKey(order.date), buf, size);
+    }
+    closeSalesLogWriter(&log);
+}
+
+void benchmarkReport(const char* name, void (*generator)(OutputBuffer*), int iterations, double* latencies) {
+    for (int i = 0; i < iterations; i++) {
+        OutputBuffer out;
+        outOpen(&out, "bench_report.tmp");
+        double t0 = nowSeconds();
+        generator(&out);
+        outClose(&out);
+        latencies[i] = nowSeconds() - t0;
+    }
+    remove("bench_report.tmp");
+    reportBenchmark(name, latencies, iterations, 1);
+}
+
+int runBenchmark(int argc, char* argv[]) {
+    int order_count = argc > 2 ? atoi(argv[2]) : 10000;
+    const char* directory = argc > 3 ? argv[3] : "bench_data";
+    if (order_count < 1) order_count = 1;
+
+    int product_total = order_count / 10;
+    if (product_total < 100) product_total = 100;
+    if (product_total > 100000) product_total = 100000;
+    int customer_total = order_count / 5;
+    if (customer_total < 100) customer_total = 100;
+    if (customer_total > 1000000) customer_total = 1000000;
+    int employee_total = 20;
+
+#ifdef _WIN32
+    _mkdir(directory);
+    if (_chdir(directory) != 0) {
+#else
+    mkdir(directory, 0755);
+    if (chdir(directory) != 0) {
+#endif
+        RED_COLOR;
+        printf("\nError entering benchmark directory %s!\n", directory);
+        RESET_COLOR;
+        return 1;
+    }
+
+    printf("Generating %d orders, %d products, %d customers in %s...\n",
+           order_count, product_total, customer_total, directory);
+    double t0 = nowSeconds();
+    generateBenchmarkData(order_count, product_total, customer_total, employee_total);
+    printf("Generated in %.2f s\n\n", nowSeconds() - t0);
+
+    int iterations = 200;
+    int report_iterations = order_count > 1000000 ? 3 : 20;
+    double* latencies = malloc(iterations * sizeof(double));
+
+    printf("%-36s%10s%14s%12s%12s\n", "Benchmark", "Ops", "Ops/s", "p50 ms", "p99 ms");
+    printLine();
+
+    for (int i = 0; i < report_iterations; i++) {
+        t0 = nowSeconds();
+        loadProducts();
+        latencies[i] = nowSeconds() - t0;
+    }
+    reportBenchmark("loadProducts", latencies, report_iterations, 1);
+
+    for (int i = 0; i < report_iterations; i++) {
+        t0 = nowSeconds();
+        loadCustomers();
+        latencies[i] = nowSeconds() - t0;
+    }
+    reportBenchmark("loadCustomers", latencies, report_iterations, 1);
+
+    loadEmployees();
+    current_user = employees[0];
+
+    for (int i = 0; i < report_iterations; i++) {
+        SalesLedger ledger;
+        t0 = nowSeconds();
+        loadSalesLedger(&ledger);
+        latencies[i] = nowSeconds() - t0;
+        freeSalesLedger(&ledger);
+    }
+    reportBenchmark("loadSalesLedger", latencies, report_iterations, 1);
+
+    for (int i = 0; i < report_iterations; i++) {
+        t0 = nowSeconds();
+        rebuildAggregates();
+        latencies[i] = nowSeconds() - t0;
+    }
+    reportBenchmark("rebuildAggregates", latencies, report_iterations, 1);
+
+    // Lookups are timed in batches of 1000
+    volatile int sink = 0;
+    for (int i = 0; i < iterations; i++) {
+        t0 = nowSeconds();
+        for (int j = 0; j < 1000; j++) {
+            sink += findProductIndex(1 + benchRandom() % product_total);
+        }
+        latencies[i] = nowSeconds() - t0;
+    }
+    reportBenchmark("findProductIndex", latencies, iterations, 1000);
+
+    char phone[MAX_STRING];
+    for (int i = 0; i < iterations; i++) {
+        t0 = nowSeconds();
+        for (int j = 0; j < 1000; j++) {
+            sprintf(phone, "01%09d", benchRandom() % customer_total);
+            sink += findCustomerIndex(phone);
+        }
+        latencies[i] = nowSeconds() - t0;
+    }
+    reportBenchmark("findCustomerIndex", latencies, iterations, 1000);
+
+    // The first lookup builds the ledger's customer index; keep it out
+    SalesLedger ledger;
+    loadSalesLedger(&ledger);
+    int first;
+    ledgerFindCustomerOrders(&ledger, "", &first);
+    for (int i = 0; i < iterations; i++) {
+        sprintf(phone, "01%09d", benchRandom() % customer_total);
+        t0 = nowSeconds();
+        sink += ledgerFindCustomerOrders(&ledger, phone, &first);
+        latencies[i] = nowSeconds() - t0;
+    }
+    freeSalesLedger(&ledger);
+    reportBenchmark("ledgerFindCustomerOrders", latencies, iterations, 1);
+
+    // Checkout persistence: log, stock journal, customer and staff totals
+    silenceStdout();
+    for (int i = 0; i < iterations; i++) {
+        Order order;
+        memset(&order, 0, sizeof(order));
+        order.id = nextOrderId();
+        sprintf(order.customer_phone, "01%09d", benchRandom() % customer_total);
+        order.employee_id = current_user.id;
+        strcpy(order.date, getCurrentDate());
+        order.item_count = 1 + benchRandom() % 5;
+        for (int j = 0; j < order.item_count; j++) {
+            Product* product = &products[benchRandom() % product_count];
+            order.items[j].product_id = product->id;
+            order.items[j].quantity = 1;
+            order.items[j].price = product->sale_price;
+            order.total_amount += order.items[j].price;
+        }
+
+        t0 = nowSeconds();
+        if (!saveTransactionToFile(order)) {
+            restoreStdout();
+            RED_COLOR;
+            printf("\nError saving transaction!\n");
+            RESET_COLOR;
+            free(latencies);
+            return 1;
+        }
+        updateInventory(order);
+        updateEmployeeTotalSales(order.employee_id, order.total_amount - order.discount);
+        flushCustomers();
+        latencies[i] = nowSeconds() - t0;
+    }
+    restoreStdout();
+    reportBenchmark("checkout persistence", latencies, iterations, 1);
+
+    benchmarkReport("generateDailySalesReportContent", generateDailySalesReportContent, report_iterations, latencies);
+    benchmarkReport("generateDailySalesReportCSV", generateDailySalesReportCSV, report_iterations, latencies);
+    benchmarkReport("generateMonthlySalesReportContent", generateMonthlySalesReportContent, report_iterations, latencies);
+    benchmarkReport("generateMonthlySalesReportCSV", generateMonthlySalesReportCSV, report_iterations, latencies);
+    benchmarkReport("generateEmployeeSalesReportContent", generateEmployeeSalesReportContent, report_iterations, latencies);
+    benchmarkReport("generateEmployeeSalesReportCSV", generateEmployeeSalesReportCSV, report_iterations, latencies);
+    benchmarkReport("generateProfitReportContent", generateProfitReportContent, report_iterations, latencies);
+    benchmarkReport("generateProfitReportCSV", generateProfitReportCSV, report_iterations, latencies);
+
+    free(latencies);
+    flushEmployees(1);
+    return 0;
+}
+
+// Headless Commands
+// "shop <command> ..." runs a single command and "shop run <file>" runs
+// one command per line ("-" reads stdin), without menus, prompts, screen
+// clears or pauses. Data is loaded once, so a command file of checkouts
+// is processed at the speed of the persistence path. Commands:
+//
+//   checkout <employee_id> <phone|GUEST> <product_id>:<qty>... [discount=<pct>]
+//            [payment=<1-5>] [txn=<id>] [name=<name>] [address=<address>]
+//   restock <product_id> <quantity>
+//   report <profit|daily_sales|monthly_sales|employee_sales> <csv|html|pdf> [file]
+//   export
+//   import <file|->
+//   run <file|->
+//
+// Each command prints one result line; errors go to stderr. Under "serve"
+// both go back to the client instead (see runServer).
+#define MAX_COMMAND_ARGS (MAX_CART_ITEMS + 16)
+
+// Order ids are seconds since the epoch, which a batch or two tills in
+// the same second outrun. ORDER_ID_FILE keeps them apart: each till takes
+// ids after the last one any till handed out. Returns the first of count
+// ids.
+long reserveOrderIds(int count) {
+    static long last_id = 0;
+    lockStore();
+    long last = last_id;
+    FILE* file = fopen(ORDER_ID_FILE, "r+");
+    if (!file) file = fopen(ORDER_ID_FILE, "w+");
+    long stored;
+    if (file && fscanf(file, "%ld", &stored) == 1 && stored > last) last = stored;
+
+    long id = (long)time(NULL);
+    if (id <= last) id = last + 1;
+    last_id = id + count - 1;
+    if (file) {
+        // Ids only grow, so the new one overwrites the old completely
+        rewind(file);
+        fprintf(file, "%ld\n", last_id);
+        fclose(file);
+    }
+    unlockStore();
+    return id;
+}
+
+long nextOrderId() {
+    return reserveOrderIds(1);
+}
+
+void commandError(const char* message, const char* detail) {
+    if (command_reply) {
+        outPrintf(command_reply, "Error: %s%s%s\n", message, detail ? ": " : "", detail ? detail : "");
+        return;
+    }
+    fprintf(stderr, "Error: %s%s%s\n", message, detail ? ": " : "", detail ? detail : "");
+}
+
+// Prints a result line, or adds it to the reply being built by the daemon
+void commandResult(const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    if (command_reply) {
+        va_list copy;
+        va_copy(copy, args);
+        int len = vsnprintf(NULL, 0, format, copy);
+        va_end(copy);
+        if (len > 0) {
+            vsnprintf(outReserve(command_reply, len + 1), len + 1, format, args);
+            command_reply->size += len;
+        }
+    } else {
+        vprintf(format, args);
+    }
+    va_end(args);
+}
+
+const char* commandOption(int argc, char* argv[], const char* name) {
+    size_t len = strlen(name);
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], name, len) == 0 && argv[i][len] == '=') {
+            return argv[i] + len + 1;
+        }
+    }
+    return NULL;
+}
+
+// Returns -1 for GUEST; unknown phones become new customers
+int findOrCreateCustomer(const char* phone, const char* name, const char* address) {
+    if (strcmp(phone, "GUEST") == 0) return -1;
+
+    int c = findCustomerIndex(phone);
+    if (c != -1) return c;
+
+    Customer customer;
+    customer.phone = internString(phone);
+    customer.name = internString(name ? name : "Unknown");
+    customer.address = internString(address ? address : "Unknown");
+    customer.total_spending = 0;
+    customer.loyalty_points = 0;
+    customer.last_loyalty_milestone = 0;
+    customer.dirty = 0;
+
+    c = customer_count;
+    ensureCustomerCapacity(customer_count + 1);
+    customers[customer_count++] = customer;
+    indexCustomer(c);
+    markCustomerDirty(c);
+    return c;
+}
+
+// Same discount rules as processPayment. The order's manual percentage and
+// payment method must already be set; total is the undiscounted subtotal.
+void applyOrderDiscounts(Order* order, int c, Money total) {
+    if (c != -1) {
+        int milestone = eligibleLoyaltyMilestone(&customers[c]);
+        if (milestone > 0) {
+            order->discount += percentOf(total, 10);
+            customers[c].last_loyalty_milestone = milestone;
+            markCustomerDirty(c);
+        }
+    }
+    order->discount += percentOf(total, order->manual_discount_percentage);
+    if (order->payment_method == PAYMENT_1CARD) {
+        order->card_discount_percentage = 5.0;
+        order->discount += percentOf(total - order->discount, 5);
+    }
+    order->total_amount = total - order->discount;
+}
+
+int commandCheckout(int argc, char* argv[]) {
+    if (argc < 4) {
+        commandError("usage", "checkout <employee_id> <phone|GUEST> <product_id>:<qty>...");
+        return 1;
+    }
+
+    int e = findEmployeeIndex(atoi(argv[1]));
+    if (e == -1) {
+        commandError("unknown employee", argv[1]);
+        return 1;
+    }
+
+    Order order;
+    memset(&order, 0, sizeof(order));
+    time_t t = time(NULL);
+    order.id = nextOrderId();
+    strftime(order.date, sizeof(order.date), "%Y-%m-%d %I:%M:%S %p", localtime(&t));
+    order.employee_id = employees[e].id;
+    snprintf(order.customer_phone, sizeof(order.customer_phone), "%s", argv[2]);
+
+    Money total = 0;
+    for (int a = 3; a < argc; a++) {
+        int id, quantity;
+        if (strchr(argv[a], '=')) continue;
+        if (sscanf(argv[a], "%d:%d", &id, &quantity) != 2 || quantity <= 0) {
+            commandError("bad item", argv[a]);
+            return 1;
+        }
+        int p = findProductIndex(id);
+        if (p == -1) {
+            commandError("unknown product", argv[a]);
+            return 1;
+        }
+        if (order.item_count == MAX_CART_ITEMS) {
+            commandError("too many items", NULL);
+            return 1;
+        }
+        order.items[order.item_count].product_id = id;
+        order.items[order.item_count].quantity = quantity;
+        order.items[order.item_count].price = products[p].sale_price;
+        order.item_count++;
+        total += quantity * products[p].sale_price;
+    }
+    if (order.item_count == 0) {
+        commandError("no items", NULL);
+        return 1;
+    }
+
+    int short_index = findShortStock(&order);
+    if (short_index != -1) {
+        commandError("insufficient stock for product", products[short_index].name);
+        return 1;
+    }
+
+    const char* discount = commandOption(argc, argv, "discount");
+    if (discount) {
+        order.manual_discount_percentage = atof(discount);
+        if (order.manual_discount_percentage < 0 || order.manual_discount_percentage > 100) {
+            commandError("bad discount", discount);
+            return 1;
+        }
+    }
+    const char* payment = commandOption(argc, argv, "payment");
+    order.payment_method = payment ? atoi(payment) : PAYMENT_CASH;
+    if (order.payment_method < PAYMENT_CASH || order.payment_method > PAYMENT_BANK) {
+        commandError("bad payment method", payment);
+        return 1;
+    }
+    const char* txn = commandOption(argc, argv, "txn");
+    if (txn) {
+        snprintf(order.transaction_id, sizeof(order.transaction_id), "%s", txn);
+    }
+
+    int c = findOrCreateCustomer(order.customer_phone, commandOption(argc, argv, "name"),
+                                 commandOption(argc, argv, "address"));
+    applyOrderDiscounts(&order, c, total);
+
+    if (!saveTransactionToFile(order)) {
+        flushCustomers();
+        commandError("cannot write", SALES_DIR);
+        return 1;
+    }
+    updateInventory(order);
+    updateEmployeeTotalSales(order.employee_id, order.total_amount - order.discount);
+    if (c != -1) {
+        customers[c].total_spending += order.total_amount;
+        markCustomerDirty(c);
+    }
+    flushCustomers();
+
+    commandResult("checkout %ld %s %s\n", order.id, moneyStr(order.total_amount), moneyStr(order.discount));
+    return 0;
+}
+
+int commandRestock(int argc, char* argv[]) {
+    if (argc != 3) {
+        commandError("usage", "restock <product_id> <quantity>");
+        return 1;
+    }
+
+    int i = findProductIndex(atoi(argv[1]));
+    int quantity = atoi(argv[2]);
+    if (i == -1) {
+        commandError("unknown product", argv[1]);
+        return 1;
+    }
+    if (quantity < 0) {
+        commandError("bad quantity", argv[2]);
+        return 1;
+    }
+
+    FILE* journal = openProductJournal();
+    if (!journal) {
+        commandError("cannot write", PRODUCT_JOURNAL_FILE);
+        return 1;
+    }
+    products[i].quantity += quantity;
+    journalStockChange(journal, i, quantity);
+    closeProductJournal(journal);
+
+    commandResult("restock %d %d\n", products[i].id, products[i].quantity);
+    return 0;
+}
+
+int commandReport(int argc, char* argv[]) {
+    if (argc < 3 || (strcmp(argv[2], "csv") != 0 && strcmp(argv[2], "html") != 0 &&
+                     strcmp(argv[2], "pdf") != 0)) {
+        commandError("usage", "report <type> <csv|html|pdf> [file]");
+        return 1;
+    }
+    if (strcmp(argv[1], "profit") != 0 && strcmp(argv[1], "daily_sales") != 0 &&
+        strcmp(argv[1], "monthly_sales") != 0 && strcmp(argv[1], "employee_sales") != 0) {
+        commandError("unknown report", argv[1]);
+        return 1;
+    }
+
+    char filename[256];
+    if (argc > 3) {
+        snprintf(filename, sizeof(filename), "%s", argv[3]);
+    } else {
+        reportPath(filename, sizeof(filename), argv[1], argv[2]);
+    }
+
+    if (strcmp(argv[2], "pdf") == 0) {
+        ReportJob job;
+        memset(&job, 0, sizeof(job));
+        snprintf(job.pdf, sizeof(job.pdf), "%s", filename);
+        tempReportPath(job.html, sizeof(job.html));
+        if (!writeReportHTML(argv[1], job.html) || !renderReportJobs(&job, 1)) {
+            remove(job.html);
+            commandError("cannot render", filename);
+            return 1;
+        }
+    } else {
+        int ok = strcmp(argv[2], "csv") == 0 ? writeReportCSV(argv[1], filename)
+                                             : writeReportHTML(argv[1], filename);
+        if (!ok) {
+            commandError("cannot write", filename);
+            return 1;
+        }
+    }
+    commandResult("report %s\n", filename);
+    return 0;
+}
+
+// Every report as CSV, plus every PDF report rendered as one batch
+int commandExport(int argc, char* argv[]) {
+    const char* sales_reports[] = {"profit", "daily_sales", "monthly_sales", "employee_sales"};
+    ReportJob jobs[6];
+    int job_count = 0, failed = 0;
+    (void)argv;
+    if (argc != 1) {
+        commandError("usage", "export");
+        return 1;
+    }
+
+    for (int i = 0; i < 4; i++) {
+        char filename[256];
+        reportPath(filename, sizeof(filename), sales_reports[i], "csv");
+        if (writeReportCSV(sales_reports[i], filename)) {
+            commandResult("report %s\n", filename);
+        } else {
+            commandError("cannot write", filename);
+            failed++;
+        }
+
+        newReportJob(&jobs[job_count], sales_reports[i]);
+        if (writeReportHTML(sales_reports[i], jobs[job_count].html)) job_count++;
+        else remove(jobs[job_count].html);
+    }
+    newReportJob(&jobs[job_count], "customer_list");
+    if (writeCustomerListHTML(jobs[job_count].html)) job_count++;
+    else remove(jobs[job_count].html);
+    newReportJob(&jobs[job_count], "customer_details");
+    if (writeDetailedCustomerListHTML(jobs[job_count].html)) job_count++;
+    else remove(jobs[job_count].html);
+    failed += 6 - job_count;
+
+    renderReportJobs(jobs, job_count);
+    for (int i = 0; i < job_count; i++) {
+        if (jobs[i].ok) {
+            commandResult("report %s\n", jobs[i].pdf);
+        } else {
+            commandError("cannot render", jobs[i].pdf);
+            failed++;
+        }
+    }
+    return failed ? 1 : 0;
+}
+
+// Bulk import of offline orders, one per line, in either form:
+//
+//   CSV:   employee_id,phone,product_id:qty;product_id:qty...[,discount[,payment[,date]]]
+//   JSONL: {"employee_id":3,"phone":"GUEST","items":[{"product_id":1,"quantity":2}],
+//           "discount":5,"payment":1,"date":"2024-11-30 11:17:28 PM"}
+//
+// Every line is validated first, with stock counted across the whole file,
+// and nothing is applied if any line is bad. Orders are then priced in file
+// order with the checkout rules and the results are committed once: one
+// write per sales partition, then the product, aggregate, customer and
+// employee files.
+#define IMPORT_LINE_SIZE 8192
+
+// Points past "key": in a flat JSON object, or NULL
+const char* jsonField(const char* text, const char* key) {
+    size_t len = strlen(key);
+    for (const char* p = strchr(text, '"'); p; p = strchr(p + 1, '"')) {
+        if (strncmp(p + 1, key, len) != 0 || p[len + 1] != '"') continue;
+        p += len + 2;
+        while (*p == ' ' || *p == '\t') p++;
+        if (*p != ':') continue;
+        p++;
+        while (*p == ' ' || *p == '\t') p++;
+        return p;
+    }
+    return NULL;
+}
+
+int jsonString(const char* value, char* out, size_t size) {
+    if (!value || *value != '"') return 0;
+    size_t n = 0;
+    for (value++; *value && *value != '"'; value++) {
+        if (*value == '\\' && value[1]) value++;
+        if (n + 1 < size) out[n++] = *value;
+    }
+    out[n] = '\0';
+    return *value == '"';
+}
+
+// Fills in the order fields an import line carries; returns an error or NULL
+const char* parseImportLine(char* line, Order* order, Money* subtotal) {
+    char phone[MAX_STRING] = "", date[30] = "";
+    char* items = NULL;
+    char items_text[IMPORT_LINE_SIZE];
+    float discount = 0;
+    int payment = PAYMENT_CASH;
+
+    if (line[0] == '{') {
+        const char* v;
+        if (!(v = jsonField(line, "employee_id"))) return "missing employee_id";
+        order->employee_id = atoi(v);
+        if (!jsonString(jsonField(line, "phone"), phone, sizeof(phone))) return "missing phone";
+        if ((v = jsonField(line, "discount"))) discount = atof(v);
+        if ((v = jsonField(line, "payment"))) payment = atoi(v);
+        if ((v = jsonField(line, "date")) && !jsonString(v, date, sizeof(date))) return "bad date";
+
+        // Flatten the items array to the CSV form
+        const char* p = jsonField(line, "items");
+        if (!p || *p != '[') return "missing items";
+        const char* close = strchr(p, ']');
+        if (!close) return "bad items";
+        size_t n = 0;
+        items_text[0] = '\0';
+        for (p = strchr(p, '{'); p && p < close; p = strchr(p + 1, '{')) {
+            const char* end = strchr(p, '}');
+            char item[256];
+            size_t len = end ? (size_t)(end - p) : sizeof(item);
+            if (len >= sizeof(item)) return "bad items";
+            memcpy(item, p, len);
+            item[len] = '\0';
+            const char* id = jsonField(item, "product_id");
+            const char* quantity = jsonField(item, "quantity");
+            if (!id || !quantity) return "bad items";
+            n += snprintf(items_text + n, sizeof(items_text) - n, "%s%d:%d",
+                          n ? ";" : "", atoi(id), atoi(quantity));
+            if (n >= sizeof(items_text)) return "too many items";
+        }
+        items = items_text;
+    } else {
+        char* fields[6] = {0};
+        int count = 0;
+        for (char* p = line; p && count < 6; count++) {
+            fields[count] = p;
+            p = strchr(p, ',');
+            if (p) *p++ = '\0';
+        }
+        if (count < 3) return "expected employee_id,phone,items";
+        order->employee_id = atoi(fields[0]);
+        snprintf(phone, sizeof(phone), "%s", fields[1]);
+        items = fields[2];
+        if (fields[3] && *fields[3]) discount = atof(fields[3]);
+        if (fields[4] && *fields[4]) payment = atoi(fields[4]);
+        if (fields[5]) snprintf(date, sizeof(date), "%s", fields[5]);
+    }
+
+    if (findEmployeeIndex(order->employee_id) == -1) return "unknown employee";
+    if (phone[0] == '\0') return "missing phone";
+    snprintf(order->customer_phone, sizeof(order->customer_phone), "%s", phone);
+    if (discount < 0 || discount > 100) return "bad discount";
+    order->manual_discount_percentage = discount;
+    if (payment < PAYMENT_CASH || payment > PAYMENT_BANK) return "bad payment method";
+    order->payment_method = payment;
+
+    if (date[0] == '\0') {
+        time_t t = time(NULL);
+        strftime(order->date, sizeof(order->date), "%Y-%m-%d %I:%M:%S %p", localtime(&t));
+    } else if (dayKey(date) == 0) {
+        return "bad date";
+    } else if (strlen(date) == 10) {
+        snprintf(order->date, sizeof(order->date), "%s 12:00:00 PM", date);
+    } else {
+        snprintf(order->date, sizeof(order->date), "%s", date);
+    }
+
+    *subtotal = 0;
+    for (char* token = strtok(items, "; "); token; token = strtok(NULL, "; ")) {
+        int id, quantity;
+        if (sscanf(token, "%d:%d", &id, &quantity) != 2 || quantity <= 0) return "bad item";
+        int p = findProductIndex(id);
+        if (p == -1) return "unknown product";
+        if (order->item_count == MAX_CART_ITEMS) return "too many items";
+        order->items[order->item_count].product_id = id;
+        order->items[order->item_count].quantity = quantity;
+        order->items[order->item_count].price = products[p].sale_price;
+        order->item_count++;
+        *subtotal += quantity * products[p].sale_price;
+    }
+    if (order->item_count == 0) return "no items";
+    return NULL;
+}
+
+int commandImport(int argc, char* argv[]) {
+    if (argc != 2) {
+        commandError("usage", "import <file|->");
+        return 1;
+    }
+    FILE* file = strcmp(argv[1], "-") == 0 ? stdin : fopen(argv[1], "r");
+    if (!file) {
+        commandError("cannot open", argv[1]);
+        return 1;
+    }
+
+    double start = nowSeconds();
+    Order* orders = NULL;
+    Money* subtotals = NULL;
+    int order_count = 0, order_capacity = 0;
+    int* demand = calloc(product_count ? product_count : 1, sizeof(int));
+    char* line = malloc(IMPORT_LINE_SIZE);
+    int line_number = 0, failed = 0;
+
+    // Validate everything before touching any state
+    while (fgets(line, IMPORT_LINE_SIZE, file)) {
+        line_number++;
+        line[strcspn(line, "\r\n")] = '\0';
+        char* text = line;
+        while (*text == ' ' || *text == '\t') text++;
+        if (*text == '\0' || *text == '#') continue;
+        if (line_number == 1 && !isdigit((unsigned char)*text) && *text != '{') continue;  // Header
+
+        if (order_count == order_capacity) {
+            order_capacity = order_capacity ? order_capacity * 2 : 256;
+            orders = realloc(orders, order_capacity * sizeof(Order));
+            subtotals = realloc(subtotals, order_capacity * sizeof(Money));
+        }
+        Order* order = &orders[order_count];
+        memset(order, 0, sizeof(Order));
+        const char* error = parseImportLine(text, order, &subtotals[order_count]);
+        if (error) {
+            fprintf(stderr, "line %d: %s\n", line_number, error);
+            failed++;
+            continue;
+        }
+        for (int i = 0; i < order->item_count; i++) {
+            int p = findProductIndex(order->items[i].product_id);
+            demand[p] += order->items[i].quantity;
+        }
+        order_count++;
+    }
+    if (file != stdin) fclose(file);
+    free(line);
+
+    for (int p = 0; p < product_count; p++) {
+        if (demand[p] > products[p].quantity) {
+            fprintf(stderr, "insufficient stock for product %d (%s): %d needed, %d in stock\n",
+                    products[p].id, products[p].name, demand[p], products[p].quantity);
+            failed++;
+        }
+    }
+    free(demand);
+    if (failed || order_count == 0) {
+        if (failed) commandError("import rejected, nothing was applied", NULL);
+        else commandError("no orders", argv[1]);
+        free(orders);
+        free(subtotals);
+        return 1;
+    }
+
+    // Apply in memory, encoding every log record into one buffer
+    size_t log_size = 0, log_capacity = (size_t)order_count * SALES_LOG_RECORD_SIZE(4);
+    unsigned char* log_buf = malloc(log_capacity);
+    Money total = 0, discount = 0;
+    long first_id = reserveOrderIds(order_count);
+    for (int k = 0; k < order_count; k++) {
+        Order* order = &orders[k];
+        order->id = first_id + k;
+        int c = findOrCreateCustomer(order->customer_phone, NULL, NULL);
+        applyOrderDiscounts(order, c, subtotals[k]);
+
+        costOrderItems(order);
+        for (int i = 0; i < order->item_count; i++) {
+            products[findProductIndex(order->items[i].product_id)].quantity -= order->items[i].quantity;
+        }
+
+        if (log_size + SALES_LOG_RECORD_SIZE(order->item_count) > log_capacity) {
+            log_capacity = log_capacity * 2 + SALES_LOG_RECORD_SIZE(order->item_count);
+            log_buf = realloc(log_buf, log_capacity);
+        }
+        log_size += encodeOrderRecord(order, order->items, order->item_count, log_buf + log_size);
+
+        // Same bookkeeping as checkout and saveTransactionToFile
+        if (c != -1) {
+            customers[c].total_spending += order->total_amount;
+            customers[c].loyalty_points = (int)(customers[c].total_spending / TAKA(100));
+            customers[c].total_spending += order->total_amount;
+            markCustomerDirty(c);
+        }
+        int e = findEmployeeIndex(order->employee_id);
+        employees[e].total_sales += order->total_amount - order->discount;
+        employees[e].unsaved_sales += order->total_amount - order->discount;
+        if (employees[e].id == current_user.id) {
+            current_user.total_sales = employees[e].total_sales;
+        }
+        employees_dirty = 1;
+
+        total += order->total_amount;
+        discount += order->discount;
+    }
+
+    // The sales log is the commit point. Each partition's length is noted
+    // before its first record, so a failed write can cut every partition
+    // back and drop the in-memory changes with nothing of the batch kept.
+    SalesLogWriter log = {NULL, 0, 1, 1};
+    int* months = NULL;
+    long* lengths = NULL;
+    int month_count = 0, month_capacity = 0;
+    for (size_t k = 0, offset = 0; k < (size_t)order_count && log.ok; k++) {
+        int month = monthKey(orders[k].date);
+        int m = 0;
+        while (m < month_count && months[m] != month) m++;
+        if (m == month_count) {
+            if (month_count == month_capacity) {
+                month_capacity = month_capacity ? month_capacity * 2 : 4;
+                months = realloc(months, month_capacity * sizeof(int));
+                lengths = realloc(lengths, month_capacity * sizeof(long));
+            }
+            char path[SALES_PARTITION_PATH_SIZE];
+            salesPartitionPath(path, month);
+            struct stat st;
+            long length = stat(path, &st) == 0 ? intactSalesLength(path, month) : 0;
+            months[month_count] = month;
+            lengths[month_count++] = length < 0 ? (long)st.st_size : length;
+        }
+        size_t size = SALES_LOG_RECORD_HEADER + getU32(log_buf + offset);
+        writeSalesRecord(&log, month, log_buf + offset, size);
+        offset += size;
+    }
+    int ok = closeSalesLogWriter(&log);
+    free(log_buf);
+    if (!ok) {
+        for (int m = 0; m < month_count; m++) truncateSalesPartition(months[m], lengths[m]);
+    }
+    free(months);
+    free(lengths);
+    if (!ok) {
+        commandError("cannot write", SALES_DIR);
+        loadProducts();
+        loadCustomers();
+        dirty_customer_count = 0;
+        loadEmployees();
+        employees_dirty = 0;
+        loadAggregates();
+        free(orders);
+        free(subtotals);
+        return 1;
+    }
+
+    for (int k = 0; k < order_count; k++) {
+        applyOrderAggregates(&aggregates, &orders[k], NULL);
+    }
+    saveAggregates();
+    saveProducts();
+    flushCustomers();
+    flushEmployees(1);
+
+    double elapsed = nowSeconds() - start;
+    commandResult("import %d %s %s\n", order_count, moneyStr(total), moneyStr(discount));
+    fprintf(stderr, "%d orders imported, %.0f orders/s\n",
+            order_count, elapsed > 0 ? order_count / elapsed : 0);
+    free(orders);
+    free(subtotals);
+    return 0;
+}
+
+// Splits line in place on whitespace into at most MAX_COMMAND_ARGS words
+int splitCommand(char* line, char* args[]) {
+    int count = 0;
+    for (char* token = strtok(line, " \t\r\n"); token && count < MAX_COMMAND_ARGS;
+         token = strtok(NULL, " \t\r\n")) {
+        args[count++] = token;
+    }
+    return count;
+}
+
+int runCommandFile(const char* path) {
+    FILE* file = strcmp(path, "-") == 0 ? stdin : fopen(path, "r");
+    if (!file) {
+        commandError("cannot open", path);
+        return 1;
+    }
+
+    char line[4096];
+    int line_number = 0, failed = 0, total = 0;
+    double start = nowSeconds();
+    // Ctrl+C stops the batch between commands
+    while (!exit_signal && fgets(line, sizeof(line), file)) {
+        line_number++;
+        char* args[MAX_COMMAND_ARGS];
+        int count = splitCommand(line, args);
+        if (count == 0 || args[0][0] == '#') continue;
+
+        if (strcmp(args[0], "run") == 0) {
+            fprintf(stderr, "line %d: nested run is not supported\n", line_number);
+            failed++;
+        } else if (runCommand(count, args) != 0) {
+            fprintf(stderr, "line %d: %s failed\n", line_number, args[0]);
+            failed++;
+        }
+        total++;
+    }
+    if (file != stdin) fclose(file);
+
+    double elapsed = nowSeconds() - start;
+    fprintf(stderr, "%d commands, %d failed, %.0f commands/s\n",
+            total, failed, elapsed > 0 ? total / elapsed : 0);
+    return failed ? 1 : 0;
+}
+
+int isHeadlessCommand(const char* name) {
+    return strcmp(name, "checkout") == 0 || strcmp(name, "restock") == 0 ||
+           strcmp(name, "report") == 0 || strcmp(name, "export") == 0 ||
+           strcmp(name, "import") == 0 ||
+           strcmp(name, "run") == 0;
+}
+
+int runCommand(int argc, char* argv[]) {
+    // Commands that change the store hold its lock from their first lookup
+    // to their last write; reports only need to catch up first
+    int (*command)(int argc, char* argv[]) = NULL;
+    if (strcmp(argv[0], "checkout") == 0) command = commandCheckout;
+    if (strcmp(argv[0], "restock") == 0) command = commandRestock;
+    if (strcmp(argv[0], "import") == 0) command = commandImport;
+    if (command) {
+        lockStore();
+        int result = command(argc, argv);
+        unlockStore();
+        return result;
+    }
+    if (strcmp(argv[0], "report") == 0 || strcmp(argv[0], "export") == 0) {
+        refreshStore();
+        return strcmp(argv[0], "report") == 0 ? commandReport(argc, argv) : commandExport(argc, argv);
+    }
+    if (strcmp(argv[0], "run") == 0) {
+        if (argc != 2) {
+            commandError("usage", "run <file|->");
+            return 1;
+        }
+        return runCommandFile(argv[1]);
+    }
+    commandError("unknown command", argv[0]);
+    return 1;
+}
+
+// POS daemon
+// "shop serve [socket] [window=<ms>]" loads the store once and then answers thin tills
+// over a Unix domain socket, so a lookup costs a round trip instead of a
+// reload of every data file. Requests and replies are frames: a 4-byte
+// little-endian length, then that many bytes. A request is one command
+// line; a reply is a status byte (0 ok, 1 failed) followed by the result
+// lines or the error. Requests:
+//
+//   add <product_id> <qty>     add to this connection's cart
+//   cart                       list the cart
+//   clear                      empty the cart
+//   checkout <employee_id> <phone|GUEST> [option=value...]
+//                              sell the cart; options as for checkout
+//   product <id>
+//   search <text>              products whose name or category has text
+//   customer <phone>
+//   restock, report, export    as the headless commands
+//
+// Lookup lines end with their free-text fields, separated by tabs:
+//
+//   product <id> <stock> <price> <name>\t<category>
+//   customer <phone> <spending> <points> <name>\t<address>
+//
+// One thread runs an event loop over every connection (epoll on Linux,
+// poll() elsewhere). A till may send requests without waiting for the
+// replies; they are answered in order. Reports and exports go to the job
+// scheduler, and the till's later requests wait for them while other
+// tills carry on. Requests touch the store under server_lock. A report job
+// drops it while its PDFs render, which is most of the time an export
+// takes. Other tills on the same directory are caught up with
+// through the store lock, as for any process (see syncStore).
+//
+// A checkout's reply, and any reply after it, goes out once the order is
+// synced to disk. Orders are synced in groups by the sales committer;
+// window=<ms> sets how long it waits for more orders before each sync
+// (default SALES_COMMIT_WINDOW_MS).
+#ifndef _WIN32
+#define SERVER_READ 1
+#define SERVER_WRITE 2
+
+pthread_mutex_t server_lock = PTHREAD_MUTEX_INITIALIZER;
+const char* server_socket_path = NULL;
+volatile sig_atomic_t server_stopping = 0;
+int server_wake[2] = {-1, -1};  // Workers and signals write here to wake the loop
+
+// Jobs done but not yet answered
+pthread_mutex_t server_job_lock = PTHREAD_MUTEX_INITIALIZER;
+ServerJob** server_done = NULL;
+int server_done_count = 0;
+int server_done_capacity = 0;
+
+// Sessions closed during this pass of the loop; freed at the end of it,
+// since events already collected may still point at them
+ServerSession** server_closed = NULL;
+int server_closed_count = 0;
+int server_closed_capacity = 0;
+
+// Sessions with checkout replies waiting for the sales log to be synced
+ServerSession** server_held = NULL;
+int server_held_count = 0;
+int server_held_capacity = 0;
+
+// Reads or writes exactly size bytes; 0 on end of file or error
+int readFull(int fd, void* data, size_t size) {
+    char* p = data;
+    while (size > 0) {
+        ssize_t n = read(fd, p, size);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return 0;
+        p += n;
+        size -= n;
+    }
+    return 1;
+}
+
+int writeFull(int fd, const void* data, size_t size) {
+    const char* p = data;
+    while (size > 0) {
+        ssize_t n = write(fd, p, size);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return 0;
+        p += n;
+        size -= n;
+    }
+    return 1;
 }
-void updateEmployeeTotalSales(int employee_id, float sale_amount) {
-    FILE *file = fopen("employees.txt", "r");
-    FILE *temp = fopen("temp.txt", "w");
-    
-    if (!file || !temp) {
-        RED_COLOR;
-        printf("\nError updating employee sales!\n");
-        RESET_COLOR;
-        return;
+
+// Reads one frame of at most max bytes, NUL-terminated; free() the result
+char* readFrame(int fd, uint32_t max, uint32_t* size) {
+    unsigned char header[4];
+    if (!readFull(fd, header, sizeof(header))) return NULL;
+    uint32_t len = getU32(header);
+    if (len > max) return NULL;
+    char* data = malloc(len + 1);
+    if (!readFull(fd, data, len)) {
+        free(data);
+        return NULL;
     }
+    data[len] = '\0';
+    if (size) *size = len;
+    return data;
+}
 
-    Employee emp;
-    int found = 0;
+int writeFrame(int fd, const char* data, uint32_t size) {
+    unsigned char header[4];
+    putU32(header, size);
+    return writeFull(fd, header, sizeof(header)) && writeFull(fd, data, size);
+}
 
-    while (fscanf(file, "%d,%[^,],%[^,],%[^,],%[^,],%f\n",
-           &emp.id, emp.name, emp.username, emp.password,
-           emp.role, &emp.total_sales) != EOF) {
-        
-        if (emp.id == employee_id) {
-            emp.total_sales += sale_amount;
-            found = 1;
-        }
-        
-        fprintf(temp, "%d,%s,%s,%s,%s,%.2f\n",
-                emp.id, emp.name, emp.username, emp.password,
-                emp.role, emp.total_sales);
+void serverProductLine(int p) {
+    commandResult("product %d %d %s %s\t%s\n", products[p].id, products[p].quantity,
+                  moneyStr(products[p].sale_price), products[p].name, products[p].category);
+}
+
+int serverCart(ServerSession* session, int argc, char* argv[]) {
+    (void)argc;
+    (void)argv;
+    Money total = 0;
+    for (int i = 0; i < session->cart_count; i++) {
+        CartItem* item = &session->cart[i];
+        int p = findProductIndex(item->product_id);
+        if (p != -1) item->price = products[p].sale_price;
+        commandResult("item %d %d %s %s\n", item->product_id, item->quantity, moneyStr(item->price),
+                      p != -1 ? products[p].name : "");
+        total += item->quantity * item->price;
     }
+    commandResult("cart %d %s\n", session->cart_count, moneyStr(total));
+    return 0;
+}
 
-    fclose(file);
-    fclose(temp);
+int serverClear(ServerSession* session, int argc, char* argv[]) {
+    session->cart_count = 0;
+    return serverCart(session, argc, argv);
+}
 
-    if (found) {
-        remove("employees.txt");
-        rename("temp.txt", "employees.txt");
-        GREEN_COLOR;
-        printf("\nEmployee sales updated successfully!\n");
-        RESET_COLOR;
-    } else {
-        remove("temp.txt");
-        RED_COLOR;
-        printf("\nEmployee ID %d not found!\n", employee_id);
-        RESET_COLOR;
+// Same checks as addToCart, counting what the cart already holds
+int serverAdd(ServerSession* session, int argc, char* argv[]) {
+    if (argc != 3) {
+        commandError("usage", "add <product_id> <qty>");
+        return 1;
+    }
+    int p = findProductIndex(atoi(argv[1]));
+    int quantity = atoi(argv[2]);
+    if (p == -1) {
+        commandError("unknown product", argv[1]);
+        return 1;
+    }
+    if (quantity <= 0) {
+        commandError("bad quantity", argv[2]);
+        return 1;
+    }
+
+    int i = 0;
+    while (i < session->cart_count && session->cart[i].product_id != products[p].id) i++;
+    if (i == MAX_CART_ITEMS) {
+        commandError("cart is full", NULL);
+        return 1;
+    }
+    int in_cart = i < session->cart_count ? session->cart[i].quantity : 0;
+    if (in_cart + quantity > products[p].quantity) {
+        commandError("insufficient stock for product", products[p].name);
+        return 1;
     }
+    session->cart[i].product_id = products[p].id;
+    session->cart[i].quantity = in_cart + quantity;
+    if (i == session->cart_count) session->cart_count++;
+    return serverCart(session, 1, argv);
 }
-void generateMonthlySalesReportContent(FILE* file) {
-    char month[8];
-    time_t t = time(NULL);
-    struct tm* tm = localtime(&t);
-    strftime(month, sizeof(month), "%Y-%m", tm);
 
-    fprintf(file, "<style>\n");
-    fprintf(file, "table { width: 100%%; border-collapse: collapse; margin: 20px 0; }\n");
-    fprintf(file, "th, td { padding: 10px; border: 1px solid #ddd; text-align: left; }\n");
-    fprintf(file, "th { background-color: #4CAF50; color: white; }\n");
-    fprintf(file, "tr:nth-child(even) { background-color: #f2f2f2; }\n");
-    fprintf(file, ".summary { margin: 20px 0; padding: 20px; background: #f9f9f9; border: 1px solid #ddd; }\n");
-    fprintf(file, "</style>\n");
-
-    fprintf(file, "<div style='text-align: center; margin-bottom: 30px;'>\n");
-    fprintf(file, "<h1 style='color: #4CAF50;'>Monthly Sales Report</h1>\n");
-    fprintf(file, "<h2>%s</h2>\n", month);
-    fprintf(file, "</div>\n");
-
-    fprintf(file, "<div class='content'>\n");
-    fprintf(file, "<h3>Daily Sales Breakdown</h3>\n");
-    fprintf(file, "<table>\n");
-    fprintf(file, "<thead>\n");
-    fprintf(file, "<tr>\n");
-    fprintf(file, "<th>Date</th>\n");
-    fprintf(file, "<th>Orders</th>\n");
-    fprintf(file, "<th>Items Sold</th>\n");
-    fprintf(file, "<th>Total Sales</th>\n");
-    fprintf(file, "<th>Total Discount</th>\n");
-    fprintf(file, "<th>Net Sales</th>\n");
-    fprintf(file, "</tr>\n");
-    fprintf(file, "</thead>\n");
-    fprintf(file, "<tbody>\n");
-
-    struct DailySummary {
-        char date[11];
-        int orders;
-        int items;
-        float sales;
-        float discount;
-    };
-    
-    struct DailySummary daily_summary[31] = {0};
-    int days_count = 0;
+// Hands the cart to commandCheckout as <product_id>:<qty> arguments
+int serverCheckout(ServerSession* session, int argc, char* argv[]) {
+    if (argc < 3) {
+        commandError("usage", "checkout <employee_id> <phone|GUEST> [option=value...]");
+        return 1;
+    }
+    if (session->cart_count == 0) {
+        commandError("cart is empty", NULL);
+        return 1;
+    }
+    // A failed sync may have lost sales already written; take no more
+    if (salesFailed()) {
+        commandError("sales are not being synced", SALES_DIR);
+        return 1;
+    }
 
-    float monthly_total = 0, monthly_discount = 0;
-    int monthly_orders = 0, monthly_items = 0;
-    Order order;
+    char items[MAX_CART_ITEMS][32];
+    char* args[MAX_COMMAND_ARGS + MAX_CART_ITEMS];
+    int count = 0;
+    for (int a = 0; a < 3; a++) args[count++] = argv[a];
+    for (int i = 0; i < session->cart_count; i++) {
+        snprintf(items[i], sizeof(items[i]), "%d:%d", session->cart[i].product_id,
+                 session->cart[i].quantity);
+        args[count++] = items[i];
+    }
+    for (int a = 3; a < argc; a++) args[count++] = argv[a];
 
-    FILE* sales_file = fopen("sales.txt", "r");
-    if (sales_file) {
-        while (fscanf(sales_file, "%ld,%[^,],%d,%[^,],%f,%f\n",
-                    &order.id,
-                    order.customer_phone,
-                    &order.employee_id,
-                    order.date,
-                    &order.total_amount,
-                    &order.discount) != EOF) {
-            
-            if (strncmp(order.date, month, 7) == 0) {
-                char date_str[11];
-                strncpy(date_str, order.date, 10);
-                date_str[10] = '\0';
-
-                // Find or create daily summary
-                int day_index = -1;
-                for (int i = 0; i < days_count; i++) {
-                    if (strcmp(daily_summary[i].date, date_str) == 0) {
-                        day_index = i;
-                        break;
-                    }
-                }
-                if (day_index == -1) {
-                    day_index = days_count++;
-                    strcpy(daily_summary[day_index].date, date_str);
-                }
+    int result = runCommand(count, args);
+    if (result == 0) session->cart_count = 0;
+    return result;
+}
 
-                // Count items
-                int items_count = 0;
-                FILE* items_file = fopen("sales_items.txt", "r");
-                if (items_file) {
-                    int order_id, product_id, quantity;
-                    float price;
-                    while (fscanf(items_file, "%d,%d,%d,%f\n", 
-                                &order_id, &product_id, &quantity, &price) != EOF) {
-                        if (order_id == order.id) {
-                            items_count += quantity;
-                        }
-                    }
-                    fclose(items_file);
-                }
+int serverProduct(ServerSession* session, int argc, char* argv[]) {
+    (void)session;
+    if (argc != 2) {
+        commandError("usage", "product <id>");
+        return 1;
+    }
+    int p = findProductIndex(atoi(argv[1]));
+    if (p == -1) {
+        commandError("unknown product", argv[1]);
+        return 1;
+    }
+    serverProductLine(p);
+    return 0;
+}
 
-                daily_summary[day_index].orders++;
-                daily_summary[day_index].items += items_count;
-                daily_summary[day_index].sales += order.total_amount;
-                daily_summary[day_index].discount += order.discount;
+// Same matching as searchProduct, by name or category
+int serverSearch(ServerSession* session, int argc, char* argv[]) {
+    (void)session;
+    if (argc < 2) {
+        commandError("usage", "search <text>");
+        return 1;
+    }
+    // The request was split on whitespace; put multi-word text back together
+    char text[MAX_STRING];
+    int n = 0;
+    text[0] = '\0';
+    for (int a = 1; a < argc && n < (int)sizeof(text); a++) {
+        n += snprintf(text + n, sizeof(text) - n, "%s%s", a > 1 ? " " : "", argv[a]);
+    }
 
-                monthly_orders++;
-                monthly_items += items_count;
-                monthly_total += order.total_amount;
-                monthly_discount += order.discount;
-            }
+    int found = 0;
+    for (int i = 0; i < product_count && found < SERVER_SEARCH_LIMIT; i++) {
+        if (strstr(products[i].name, text) || strstr(products[i].category, text)) {
+            serverProductLine(i);
+            found++;
         }
-        fclose(sales_file);
     }
+    if (found == 0) {
+        commandError("no products match", text);
+        return 1;
+    }
+    return 0;
+}
 
-    for (int i =0; i < days_count; i++) {
-        fprintf(file, "<tr>\n");
-        fprintf(file, "<td>%s</td>\n", daily_summary[i].date);
-        fprintf(file, "<td>%d</td>\n", daily_summary[i].orders);
-        fprintf(file, "<td>%d</td>\n", daily_summary[i].items);
-        fprintf(file, "<td>%.2f</td>\n", daily_summary[i].sales);
-        fprintf(file, "<td>%.2f</td>\n", daily_summary[i].discount);
-        fprintf(file, "<td>%.2f</td>\n", daily_summary[i].sales - daily_summary[i].discount);
-        fprintf(file, "</tr>\n");
-    }
-
-    fprintf(file, "</tbody>\n");
-    fprintf(file, "</table>\n");
-
-    fprintf(file, "<div class='summary'>\n");
-    fprintf(file, "<h3 style='color: #4CAF50;'>Monthly Summary</h3>\n");
-    fprintf(file, "<table style='width: 50%%; margin: 20px auto;'>\n");
-    fprintf(file, "<tr><td><strong>Total Days with Sales:</strong></td><td>%d</td></tr>\n", days_count);
-    fprintf(file, "<tr><td><strong>Total Orders:</strong></td><td>%d</td></tr>\n", monthly_orders);
-    fprintf(file, "<tr><td><strong>Total Items Sold:</strong></td><td>%d</td></tr>\n", monthly_items);
-    fprintf(file, "<tr><td><strong>Total Sales:</strong></td><td>%.2f</td></tr>\n", monthly_total);
-    fprintf(file, "<tr><td><strong>Total Discounts:</strong></td><td>%.2f</td></tr>\n", monthly_discount);
-    fprintf(file, "<tr><td><strong>Net Sales:</strong></td><td>%.2f</td></tr>\n", monthly_total - monthly_discount);
-    fprintf(file, "<tr><td><strong>Average Daily Sales:</strong></td><td>%.2f</td></tr>\n", 
-            days_count > 0 ? (monthly_total - monthly_discount)/days_count : 0);
-    fprintf(file, "<tr><td><strong>Average Order Value:</strong></td><td>%.2f</td></tr>\n", 
-            monthly_orders > 0 ? (monthly_total - monthly_discount)/monthly_orders : 0);
-    fprintf(file, "</table>\n");
-    fprintf(file, "</div>\n");
-    fprintf(file, "</div>\n");
-}
-
-void generateMonthlySalesReportCSV(FILE* file) {
-    char month[8];
-    time_t t = time(NULL);
-    struct tm* tm = localtime(&t);
-    strftime(month, sizeof(month), "%Y-%m", tm);
+int serverCustomer(ServerSession* session, int argc, char* argv[]) {
+    (void)session;
+    if (argc != 2) {
+        commandError("usage", "customer <phone>");
+        return 1;
+    }
+    int c = findCustomerIndex(argv[1]);
+    if (c == -1) {
+        commandError("unknown customer", argv[1]);
+        return 1;
+    }
+    commandResult("customer %s %s %d %s\t%s\n", customers[c].phone,
+                  moneyStr(customers[c].total_spending), customers[c].loyalty_points,
+                  customers[c].name, customers[c].address);
+    return 0;
+}
 
-    fprintf(file, "Monthly Sales Report - %s\n\n", month);
-    fprintf(file, "Date,Orders,Items Sold,Total Sales,Total Discount,Net Sales\n");
+// Runs one request, with its output going to command_reply
+int serveRequest(ServerSession* session, char* request) {
+    char* args[MAX_COMMAND_ARGS];
+    int argc = splitCommand(request, args);
+    if (argc == 0) {
+        commandError("empty request", NULL);
+        return 1;
+    }
 
-    struct {
-        char date[11];
-        int orders;
-        int items;
-        float sales;
-        float discount;
-    } daily_summary[31] = {0};
-    int days_count = 0;
+    // Commands lock the store themselves
+    if (strcmp(args[0], "checkout") == 0) return serverCheckout(session, argc, args);
+    if (strcmp(args[0], "restock") == 0 || strcmp(args[0], "report") == 0 ||
+        strcmp(args[0], "export") == 0) {
+        return runCommand(argc, args);
+    }
 
-    FILE* sales_file = fopen("sales.txt", "r");
-    if (!sales_file) return;
+    int (*request_handler)(ServerSession* session, int argc, char* argv[]) = NULL;
+    if (strcmp(args[0], "add") == 0) request_handler = serverAdd;
+    if (strcmp(args[0], "cart") == 0) request_handler = serverCart;
+    if (strcmp(args[0], "clear") == 0) request_handler = serverClear;
+    if (strcmp(args[0], "product") == 0) request_handler = serverProduct;
+    if (strcmp(args[0], "search") == 0) request_handler = serverSearch;
+    if (strcmp(args[0], "customer") == 0) request_handler = serverCustomer;
+    if (!request_handler) {
+        commandError("unknown request", args[0]);
+        return 1;
+    }
+    // Taking the lock catches up with the other tills first
+    lockStore();
+    int result = request_handler(session, argc, args);
+    unlockStore();
+    return result;
+}
 
-    float monthly_total = 0, monthly_discount = 0;
-    int monthly_orders = 0, monthly_items = 0;
-    Order order;
+#ifdef __linux__
+int server_epoll = -1;
 
-    while (fscanf(sales_file, "%ld,%[^,],%d,%[^,],%f,%f\n",
-                  &order.id,
-                  order.customer_phone,
-                  &order.employee_id,
-                  order.date,
-                  &order.total_amount,
-                  &order.discount) != EOF) {
-    }
-    fclose(sales_file);
+int openEvents() {
+    server_epoll = epoll_create1(0);
+    return server_epoll >= 0;
+}
 
-    for (int i =0; i < days_count; i++) {
-        fprintf(file, "%s,%d,%d,%.2f,%.2f,%.2f\n",
-               daily_summary[i].date,
-               daily_summary[i].orders,
-               daily_summary[i].items,
-               daily_summary[i].sales,
-               daily_summary[i].discount,
-               daily_summary[i].sales - daily_summary[i].discount);
-    }
+// Changes what fd is watched for from previous to events, both made of
+// SERVER_READ and SERVER_WRITE; 0 is not watched at all
+void watchFd(int fd, void* data, int events, int previous) {
+    if (!events && !previous) return;
+    struct epoll_event event;
+    memset(&event, 0, sizeof(event));
+    event.events = ((events & SERVER_READ) ? EPOLLIN : 0) | ((events & SERVER_WRITE) ? EPOLLOUT : 0);
+    event.data.ptr = data;
+    epoll_ctl(server_epoll, !previous ? EPOLL_CTL_ADD : !events ? EPOLL_CTL_DEL : EPOLL_CTL_MOD,
+              fd, &event);
+}
 
-    fprintf(file, "\nMonthly Summary\n");
-    fprintf(file, "Total Days with Sales,%d\n", days_count);
-    fprintf(file, "Total Orders,%d\n", monthly_orders);
-    fprintf(file, "Total Items Sold,%d\n", monthly_items);
-    fprintf(file, "Total Sales,%.2f\n", monthly_total);
-    fprintf(file, "Total Discounts,%.2f\n", monthly_discount);
-    fprintf(file, "Net Sales,%.2f\n", monthly_total - monthly_discount);
-    fprintf(file, "Average Daily Sales,%.2f\n", 
-            days_count > 0 ? (monthly_total - monthly_discount)/days_count : 0);
-    fprintf(file, "Average Order Value,%.2f\n", 
-            monthly_orders > 0 ? (monthly_total - monthly_discount)/monthly_orders : 0);
+// Waits for at most max events; -1 on error or a signal
+int waitEvents(ServerEvent* events, int max) {
+    struct epoll_event ready[SERVER_MAX_EVENTS];
+    int count = epoll_wait(server_epoll, ready, max < SERVER_MAX_EVENTS ? max : SERVER_MAX_EVENTS, -1);
+    for (int i = 0; i < count; i++) {
+        events[i].data = ready[i].data.ptr;
+        events[i].readable = (ready[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) != 0;
+        events[i].writable = (ready[i].events & EPOLLOUT) != 0;
+    }
+    return count;
 }
+#else
+struct pollfd* server_polls = NULL;
+void** server_poll_data = NULL;
+int server_poll_count = 0;
+int server_poll_capacity = 0;
 
-// Employee Sales Report Generators
-void generateEmployeeSalesReportContent(FILE* file) {
-    fprintf(file, "<h2>Employee Sales Report</h2>\n");
-    
-    fprintf(file, "<style>\n");
-    fprintf(file, "table { width: 100%%; border-collapse: collapse; margin: 20px 0; }\n");
-    fprintf(file, "th, td { padding: 8px; border: 1px solid #ddd; text-align: left; }\n");
-    fprintf(file, "th { background-color: #4CAF50; color: white; }\n");
-    fprintf(file, ".summary { margin-top: 20px; }\n");
-    fprintf(file, "</style>\n");
+int openEvents() {
+    return 1;
+}
 
-    // Start employee sales table
-    fprintf(file, "<table>\n");
-    fprintf(file, "<tr><th>Name</th><th>Orders</th><th>Items</th>");
-    fprintf(file, "<th>Sales</th><th>Discount</th><th>Net Sales</th></tr>\n");
-    
-    struct {
-        int id;
-        char name[MAX_STRING];
-        int orders;
-        int items;
-        float sales;
-        float discount;
-    } emp_summary[MAX_EMPLOYEES] = {0};
-
-    FILE* emp_file = fopen("employees.txt", "r");
-    if (emp_file) {
-        Employee emp;
-        while (fscanf(emp_file, "%d,%[^,],%[^,],%[^,],%[^,],%f\n",
-               &emp.id, emp.name, emp.username, emp.password,
-               emp.role, &emp.total_sales) != EOF) {
-            for (int i = 0; i < MAX_EMPLOYEES; i++) {
-                if (emp_summary[i].id == 0) {
-                    emp_summary[i].id = emp.id;
-                    strcpy(emp_summary[i].name, emp.name);
-                    break;
-                }
-            }
+void watchFd(int fd, void* data, int events, int previous) {
+    (void)previous;
+    int i = 0;
+    while (i < server_poll_count && server_polls[i].fd != fd) i++;
+    if (!events) {
+        if (i < server_poll_count) {
+            server_poll_count--;
+            server_polls[i] = server_polls[server_poll_count];
+            server_poll_data[i] = server_poll_data[server_poll_count];
+        }
+        return;
+    }
+    if (i == server_poll_count) {
+        if (server_poll_count == server_poll_capacity) {
+            server_poll_capacity = server_poll_capacity ? server_poll_capacity * 2 : 64;
+            server_polls = realloc(server_polls, server_poll_capacity * sizeof(struct pollfd));
+            server_poll_data = realloc(server_poll_data, server_poll_capacity * sizeof(void*));
         }
-        fclose(emp_file);
+        server_poll_count++;
     }
+    server_polls[i].fd = fd;
+    server_polls[i].events = ((events & SERVER_READ) ? POLLIN : 0) | ((events & SERVER_WRITE) ? POLLOUT : 0);
+    server_polls[i].revents = 0;
+    server_poll_data[i] = data;
+}
 
-    FILE* sales_file = fopen("sales.txt", "r");
-    if (!sales_file) return;
+int waitEvents(ServerEvent* events, int max) {
+    int ready = poll(server_polls, server_poll_count, -1);
+    int count = 0;
+    for (int i = 0; i < server_poll_count && count < max && ready > 0; i++) {
+        short revents = server_polls[i].revents;
+        if (!revents) continue;
+        events[count].data = server_poll_data[i];
+        events[count].readable = (revents & (POLLIN | POLLHUP | POLLERR)) != 0;
+        events[count].writable = (revents & POLLOUT) != 0;
+        count++;
+    }
+    return ready < 0 ? -1 : count;
+}
+#endif
 
-    Order order;
-    while (fscanf(sales_file, "%ld,%[^,],%d,%[^,],%f,%f\n",
-                  &order.id,
-                  order.customer_phone,
-                  &order.employee_id,
-                  order.date,
-                  &order.total_amount,
-                  &order.discount) != EOF) {
-        
-        
-        for (int i =0; i < MAX_EMPLOYEES; i++) {
-            if (emp_summary[i].id == order.employee_id) {
-                // Count items
-                int items_count = 0;
-                FILE* items_file = fopen("sales_items.txt", "r");
-                if (items_file) {
-                    int order_id, product_id, quantity;
-                    float price;
-                    while (fscanf(items_file, "%d,%d,%d,%f\n", 
-                                &order_id, &product_id, &quantity, &price) != EOF) {
-                        if (order_id == order.id) {
-                            items_count += quantity;
-                        }
-                    }
-                    fclose(items_file);
-                }
+int setNonBlocking(int fd) {
+    int flags = fcntl(fd, F_GETFL, 0);
+    return flags >= 0 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+}
 
-                emp_summary[i].orders++;
-                emp_summary[i].items += items_count;
-                emp_summary[i].sales += order.total_amount;
-                emp_summary[i].discount += order.discount;
-                break;
-            }
-        }
-    }
-    fclose(sales_file);
+void wakeServer() {
+    // A full pipe already has the loop's attention
+    if (write(server_wake[1], "", 1) < 0) {}
+}
 
-    float total_sales = 0, total_discount = 0;
-    int total_orders = 0, total_items = 0;
+// Starts a reply frame in out; endReply fills in its length and status
+size_t beginReply(OutputBuffer* out) {
+    size_t start = out->size;
+    outWrite(out, "\0\0\0\0\0", 5);
+    return start;
+}
 
-    for (int i = 0; i < MAX_EMPLOYEES; i++) {
-        if (emp_summary[i].id != 0 && emp_summary[i].orders > 0) {
-            fprintf(file, "<tr><td>%s</td><td>%d</td><td>%d</td><td>%.2f</td><td>%.2f</td><td>%.2f</td></tr>\n",
-                   emp_summary[i].name,
-                   emp_summary[i].orders,
-                   emp_summary[i].items,
-                   emp_summary[i].sales,
-                   emp_summary[i].discount,
-                   emp_summary[i].sales - emp_summary[i].discount);
+void endReply(OutputBuffer* out, size_t start, int status) {
+    putU32((unsigned char*)out->data + start, (uint32_t)(out->size - start - 4));
+    out->data[start + 4] = status ? 1 : 0;
+}
 
-            total_orders += emp_summary[i].orders;
-            total_items += emp_summary[i].items;
-            total_sales += emp_summary[i].sales;
-            total_discount += emp_summary[i].discount;
-        }
+// Reports and exports can take seconds, so they go to the workers
+int isSlowRequest(const char* request) {
+    request += strspn(request, " \t\r\n");
+    size_t len = strcspn(request, " \t\r\n");
+    return len == 6 && (strncmp(request, "report", 6) == 0 || strncmp(request, "export", 6) == 0);
+}
+
+// Runs a slow request on the job scheduler and hands the reply back to
+// the event loop
+void runServerJob(void* arg) {
+    ServerJob* job = arg;
+    size_t start = beginReply(&job->reply);
+    pthread_mutex_lock(&server_lock);
+    command_reply = &job->reply;
+    int status = serveRequest(job->session, job->request);
+    command_reply = NULL;
+    pthread_mutex_unlock(&server_lock);
+    endReply(&job->reply, start, status);
+
+    pthread_mutex_lock(&server_job_lock);
+    if (server_done_count == server_done_capacity) {
+        server_done_capacity = server_done_capacity ? server_done_capacity * 2 : 16;
+        server_done = realloc(server_done, server_done_capacity * sizeof(ServerJob*));
     }
-    fprintf(file, "</table>\n");
+    server_done[server_done_count++] = job;
+    wakeServer();
+    pthread_mutex_unlock(&server_job_lock);
+}
 
-    fprintf(file, "<div class='summary'>\n");
-    fprintf(file, "<h3>Overall Summary</h3>\n");
-    fprintf(file, "<p><strong>Total Orders:</strong> %d</p>\n", total_orders);
-    fprintf(file, "<p><strong>Total Items Sold:</strong> %d</p>\n", total_items);
-    fprintf(file, "<p><strong>Total Sales:</strong> %.2f</p>\n", total_sales);
-    fprintf(file, "<p><strong>Total Discounts:</strong> %.2f</p>\n", total_discount);
-    fprintf(file, "<p><strong>Net Sales:</strong> %.2f</p>\n", total_sales - total_discount);
-    fprintf(file, "</div>\n");
+// Renders in a report job let the event loop and other jobs at the store;
+// the reply being built is put back by resumeServerRequest
+OutputBuffer* pauseServerRequest() {
+    if (!server_socket_path) return NULL;
+    OutputBuffer* reply = command_reply;
+    command_reply = NULL;
+    pthread_mutex_unlock(&server_lock);
+    return reply;
 }
 
-void generateEmployeeSalesReportCSV(FILE* file) {
-    fprintf(file, "Employee Sales Report\n\n");
-    fprintf(file, "Employee,Orders,Items Sold,Total Sales,Total Discount,Net Sales\n");
+void resumeServerRequest(OutputBuffer* reply) {
+    if (!server_socket_path) return;
+    pthread_mutex_lock(&server_lock);
+    command_reply = reply;
+}
 
-    struct {
-        int id;
-        char name[MAX_STRING];
-        int orders;
-        int items;
-        float sales;
-        float discount;
-    } emp_summary[MAX_EMPLOYEES] = {0};
+// Replies up to here may go out; the rest wait for a sync
+size_t sendableOutput(ServerSession* session) {
+    return session->commit_seq ? session->commit_from : session->output.size;
+}
 
-    FILE* emp_file = fopen("employees.txt", "r");
-    if (emp_file) {
-        Employee emp;
-        while (fscanf(emp_file, "%d,%[^,],%[^,],%[^,],%[^,],%f\n",
-               &emp.id, emp.name, emp.username, emp.password,
-               emp.role, &emp.total_sales) != EOF) {
-            for (int i =0; i < MAX_EMPLOYEES; i++) {
-                if (emp_summary[i].id == 0) {
-                    emp_summary[i].id = emp.id;
-                    strcpy(emp_summary[i].name, emp.name);
-                    break;
-                }
-            }
+// Holds the reply starting at start, and everything after it, until the
+// sale it made is on disk. A run of checkouts waits on its last one.
+void holdReply(ServerSession* session, size_t start) {
+    if (!session->commit_seq) {
+        session->commit_from = start;
+        if (server_held_count == server_held_capacity) {
+            server_held_capacity = server_held_capacity ? server_held_capacity * 2 : 16;
+            server_held = realloc(server_held, server_held_capacity * sizeof(ServerSession*));
         }
-        fclose(emp_file);
+        server_held[server_held_count++] = session;
     }
+    session->commit_seq = sales_appended;
+}
 
-    FILE* sales_file = fopen("sales.txt", "r");
-    if (!sales_file) return;
+// Reads only while the till's replies are keeping up
+void watchSession(ServerSession* session) {
+    int events = 0;
+    if (!session->eof && !session->busy &&
+        session->output.size - session->output_sent < SERVER_MAX_OUTPUT) {
+        events |= SERVER_READ;
+    }
+    if (session->output_sent < sendableOutput(session)) events |= SERVER_WRITE;
+    if (events != session->watching) {
+        watchFd(session->fd, session, events, session->watching);
+        session->watching = events;
+    }
+}
 
-    Order order;
-    while (fscanf(sales_file, "%ld,%[^,],%d,%[^,],%f,%f\n",
-                  &order.id,
-                  order.customer_phone,
-                  &order.employee_id,
-                  order.date,
-                  &order.total_amount,
-                  &order.discount) != EOF) {
-        
-        for (int i =0; i < MAX_EMPLOYEES; i++) {
-            if (emp_summary[i].id == order.employee_id) {
-                int items_count = 0;
-                FILE* items_file = fopen("sales_items.txt", "r");
-                if (items_file) {
-                    int order_id, product_id, quantity;
-                    float price;
-                    while (fscanf(items_file, "%d,%d,%d,%f\n", 
-                                &order_id, &product_id, &quantity, &price) != EOF) {
-                        if (order_id == order.id) {
-                            items_count += quantity;
-                        }
-                    }
-                    fclose(items_file);
-                }
+void closeSession(ServerSession* session) {
+    watchFd(session->fd, session, 0, session->watching);
+    close(session->fd);
+    session->fd = -1;
+    if (session->commit_seq) {
+        int i = 0;
+        while (server_held[i] != session) i++;
+        server_held[i] = server_held[--server_held_count];
+        session->commit_seq = 0;
+    }
+    // A worker still holding one of its requests frees it when done
+    if (session->busy) return;
+    if (server_closed_count == server_closed_capacity) {
+        server_closed_capacity = server_closed_capacity ? server_closed_capacity * 2 : 16;
+        server_closed = realloc(server_closed, server_closed_capacity * sizeof(ServerSession*));
+    }
+    server_closed[server_closed_count++] = session;
+}
 
-                emp_summary[i].orders++;
-                emp_summary[i].items += items_count;
-                emp_summary[i].sales += order.total_amount;
-                emp_summary[i].discount += order.discount;
-                break;
-            }
+void freeClosedSessions() {
+    for (int i = 0; i < server_closed_count; i++) {
+        free(server_closed[i]->input);
+        free(server_closed[i]->output.data);
+        free(server_closed[i]);
+    }
+    server_closed_count = 0;
+}
+
+// Reads what the socket has, up to one largest request at a time; 0 once
+// the till has hung up
+int readSession(ServerSession* session) {
+    while (session->input_size < SERVER_MAX_REQUEST + 4) {
+        if (session->input_capacity - session->input_size < 4096) {
+            session->input_capacity = session->input_capacity ? session->input_capacity * 2 : 8192;
+            session->input = realloc(session->input, session->input_capacity);
+        }
+        ssize_t n = read(session->fd, session->input + session->input_size,
+                         session->input_capacity - session->input_size);
+        if (n > 0) {
+            session->input_size += n;
+        } else if (n < 0 && errno == EINTR) {
+            continue;
+        } else {
+            return n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK);
         }
     }
-    fclose(sales_file);
+    return 1;
+}
 
-    float total_sales = 0, total_discount = 0;
-    int total_orders = 0, total_items = 0;
+int hasRequest(ServerSession* session) {
+    return session->input_size >= 4 &&
+           session->input_size - 4 >= getU32((unsigned char*)session->input);
+}
 
-    for (int i =0; i < MAX_EMPLOYEES; i++) {
-        if (emp_summary[i].id != 0 && emp_summary[i].orders > 0) {
-            fprintf(file, "%s,%d,%d,%.2f,%.2f,%.2f\n",
-                   emp_summary[i].name,
-                   emp_summary[i].orders,
-                   emp_summary[i].items,
-                   emp_summary[i].sales,
-                   emp_summary[i].discount,
-                   emp_summary[i].sales - emp_summary[i].discount);
+// Answers complete requests in order until one goes to a worker or the
+// till stops taking replies; 0 if it sent something that is not a request.
+// One store lock covers the whole run, so pipelined requests catch up with
+// other tills once rather than once each.
+int processSession(ServerSession* session) {
+    size_t used = 0;
+    int ok = 1, locked = 0;
+    while (!session->busy && session->output.size - session->output_sent < SERVER_MAX_OUTPUT &&
+           session->input_size - used >= 4) {
+        uint32_t len = getU32((unsigned char*)session->input + used);
+        if (len > SERVER_MAX_REQUEST) {
+            ok = 0;
+            break;
+        }
+        if (session->input_size - used - 4 < len) break;
+        char* request = malloc(len + 1);
+        memcpy(request, session->input + used + 4, len);
+        request[len] = '\0';
+        used += 4 + len;
+
+        if (isSlowRequest(request)) {
+            ServerJob* job = calloc(1, sizeof(ServerJob));
+            job->session = session;
+            job->request = request;
+            session->busy = 1;
+            submitJob(JOB_PRIORITY_REPORT, runServerJob, job);
+            continue;
+        }
 
-            total_orders += emp_summary[i].orders;
-            total_items += emp_summary[i].items;
-            total_sales += emp_summary[i].sales;
-            total_discount += emp_summary[i].discount;
+        if (!locked) {
+            pthread_mutex_lock(&server_lock);
+            lockStore();
+            locked = 1;
         }
+        unsigned long long appended = sales_appended;
+        size_t start = beginReply(&session->output);
+        command_reply = &session->output;
+        int status = serveRequest(session, request);
+        command_reply = NULL;
+        endReply(&session->output, start, status);
+        if (sales_committer_running && sales_appended != appended) holdReply(session, start);
+        free(request);
     }
-
-    fprintf(file, "\nOverall Summary\n");
-    fprintf(file, "Total Orders,%d\n", total_orders);
-    fprintf(file, "Total Items Sold,%d\n", total_items);
-    fprintf(file, "Total Sales,%.2f\n", total_sales);
-    fprintf(file, "Total Discounts,%.2f\n", total_discount);
-    fprintf(file, "Net Sales,%.2f\n", total_sales - total_discount);
+    if (locked) {
+        unlockStore();
+        pthread_mutex_unlock(&server_lock);
+    }
+    memmove(session->input, session->input + used, session->input_size - used);
+    session->input_size -= used;
+    return ok;
 }
 
-void generateDailySalesReportCSV(FILE* file) {
-    char date[11];
-    time_t t = time(NULL);
-    struct tm* tm = localtime(&t);
-    strftime(date, sizeof(date), "%Y-%m-%d", tm);
+// Sends what the socket takes; 0 if the till has gone
+int writeSession(ServerSession* session) {
+    size_t sendable = sendableOutput(session);
+    while (session->output_sent < sendable) {
+        ssize_t n = write(session->fd, session->output.data + session->output_sent,
+                          sendable - session->output_sent);
+        if (n > 0) {
+            session->output_sent += n;
+        } else if (n < 0 && errno == EINTR) {
+            continue;
+        } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            // A stopping daemon waits a while for the till to make room
+            struct pollfd out = {session->fd, POLLOUT, 0};
+            if (!server_stopping || poll(&out, 1, SERVER_FLUSH_MS) <= 0) return 1;
+        } else {
+            return 0;
+        }
+    }
+    if (session->output_sent == session->output.size) session->output.size = session->output_sent = 0;
+    return 1;
+}
 
-    fprintf(file, "Daily Sales Report - %s\n\n", date);
-    fprintf(file, "Time,Order ID,Customer,Items,Amount,Discount,Net Amount\n");
+// Does whatever the socket and the session's requests allow, then closes
+// the session or changes what it waits for. A till that hung up is closed
+// once all its requests are answered.
+void serviceSession(ServerSession* session, int readable) {
+    if (session->fd < 0) return;
+    if (readable && !readSession(session)) session->eof = 1;
 
-    float total_sales = 0, total_discount = 0;
-    int total_orders = 0;
-    Order order;
+    int ok;
+    do {
+        ok = processSession(session) && writeSession(session);
+    } while (ok && !session->busy && session->output.size == 0 && hasRequest(session));
 
-    FILE* sales_file = fopen("sales.txt", "r");
-    if (sales_file) {
-        while (fscanf(sales_file, "%ld,%[^,],%d,%[^,],%f,%f\n",
-                    &order.id,
-                    order.customer_phone,
-                    &order.employee_id,
-                    order.date,
-                    &order.total_amount,
-                    &order.discount) != EOF) {
-            
-            if (strstr(order.date, date)) {
-                // Same processing as HTML version but with CSV formatting
-                char customer_name[MAX_STRING] = "Guest";
-                for (int i = 0; i < customer_count; i++) {
-                    if (strcmp(customers[i].phone, order.customer_phone) == 0) {
-                        strcpy(customer_name, customers[i].name);
-                        break;
-                    }
-                }
+    if (!ok || (session->eof && !session->busy && session->output.size == 0)) {
+        closeSession(session);
+    } else {
+        watchSession(session);
+    }
+}
 
-                char time_str[9];
-                strncpy(time_str, order.date + 11, 8);
-                time_str[8] = '\0';
-
-                int items_count = 0;
-                FILE* items_file = fopen("sales_items.txt", "r");
-                if (items_file) {
-                    int order_id, product_id, quantity;
-                    float price;
-                    while (fscanf(items_file, "%d,%d,%d,%f\n", 
-                                &order_id, &product_id, &quantity, &price) != EOF) {
-                        if (order_id == order.id) {
-                            items_count += quantity;
-                        }
-                    }
-                    fclose(items_file);
-                }
+void acceptSessions(int listener) {
+    while (1) {
+        int fd = accept(listener, NULL, NULL);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK) commandError("cannot accept", strerror(errno));
+            return;
+        }
+        setNonBlocking(fd);
+        ServerSession* session = calloc(1, sizeof(ServerSession));
+        session->fd = fd;
+        watchSession(session);
+    }
+}
 
-                fprintf(file, "%s,%ld,%s,%d,%.2f,%.2f,%.2f\n",
-                       time_str, order.id, customer_name, items_count, 
-                       order.total_amount, order.discount,
-                       order.total_amount - order.discount);
+// Turns the held checkout replies into errors when the sync they waited
+// on failed; the sales were written but may not be on disk
+void failHeldCheckouts(ServerSession* session) {
+    size_t held = session->output.size - session->commit_from;
+    char* replies = malloc(held);
+    memcpy(replies, session->output.data + session->commit_from, held);
+    session->output.size = session->commit_from;
+    for (size_t at = 0; at < held;) {
+        uint32_t len = getU32((unsigned char*)replies + at);
+        const char* text = replies + at + 5;
+        size_t text_len = len - 1;
+        if (replies[at + 4] == 0 && text_len > 9 && strncmp(text, "checkout ", 9) == 0) {
+            size_t start = beginReply(&session->output);
+            outPrintf(&session->output, "Error: cannot sync %s: %.*s", SALES_DIR, (int)text_len, text);
+            endReply(&session->output, start, 1);
+        } else {
+            outWrite(&session->output, replies + at, len + 4);
+        }
+        at += len + 4;
+    }
+    free(replies);
+}
 
-                total_sales += order.total_amount;
-                total_discount += order.discount;
-                total_orders++;
-            }
+// Sends checkout replies whose sales the committer has synced
+void releaseSyncedReplies() {
+    unsigned long long durable = salesDurable();
+    unsigned long long failed = salesFailed();
+    for (int i = 0; i < server_held_count;) {
+        ServerSession* session = server_held[i];
+        if (session->commit_seq > durable) {
+            i++;
+            continue;
         }
-        fclose(sales_file);
+        if (session->commit_seq <= failed) failHeldCheckouts(session);
+        session->commit_seq = 0;
+        server_held[i] = server_held[--server_held_count];
+        serviceSession(session, 0);
     }
+}
 
-    fprintf(file, "\nDaily Summary\n");
-    fprintf(file, "Total Orders,%d\n", total_orders);
-    fprintf(file, "Total Sales,%.2f\n", total_sales);
-    fprintf(file, "Total Discounts,%.2f\n", total_discount);
-    fprintf(file, "Net Sales,%.2f\n", total_sales - total_discount);
+// Queues the replies of finished jobs and lets their tills go on
+void finishServerJobs() {
+    char drain[256];
+    while (read(server_wake[0], drain, sizeof(drain)) > 0) {}
+    releaseSyncedReplies();
+
+    pthread_mutex_lock(&server_job_lock);
+    ServerJob** done = server_done;
+    int done_count = server_done_count;
+    server_done = NULL;
+    server_done_count = server_done_capacity = 0;
+    pthread_mutex_unlock(&server_job_lock);
+
+    for (int i = 0; i < done_count; i++) {
+        ServerSession* session = done[i]->session;
+        session->busy = 0;
+        if (session->fd >= 0) {
+            outWrite(&session->output, done[i]->reply.data, done[i]->reply.size);
+            serviceSession(session, 0);
+        } else {
+            closeSession(session);
+        }
+        free(done[i]->reply.data);
+        free(done[i]->request);
+        free(done[i]);
+    }
+    free(done);
 }
 
-char* getCurrentDateTime(void) {
-    static char datetime[20];
-    time_t t = time(NULL);
-    struct tm* tm = localtime(&t);
-    strftime(datetime, sizeof(datetime), "%Y-%m-%d %H:%M:%S", tm);
-    return datetime;
+// Runs before flushEmployeesAtExit. Keeps any request from starting, then
+// removes the socket.
+void stopServer() {
+    pthread_mutex_lock(&server_lock);
+    if (server_socket_path) unlink(server_socket_path);
 }
 
-void generateDailySalesReportContent(FILE* file) {
-    char date[11];
-    time_t t = time(NULL);
-    struct tm* tm = localtime(&t);
-    strftime(date, sizeof(date), "%Y-%m-%d", tm);
+void stopServerSignal(int sig) {
+    (void)sig;
+    server_stopping = 1;
+    wakeServer();
+}
 
-    fprintf(file, "<h2>Daily Sales Report</h2>\n");
-    fprintf(file, "<p><strong>Date:</strong> %s</p>\n", date);
-    fprintf(file, "<table>\n");
-    fprintf(file, "<tr><th>Time</th><th>Order ID</th><th>Customer</th><th>Items</th><th>Amount</th><th>Discount</th><th>Net Amount</th></tr>\n");
+int runServer(int argc, char* argv[]) {
+    const char* path = SERVER_SOCKET_FILE;
+    const char* window = commandOption(argc, argv, "window");
+    int paths = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "window=", 7) != 0) {
+            path = argv[i];
+            paths++;
+        }
+    }
+    if (paths > 1 || (window && !isdigit((unsigned char)window[0]))) {
+        commandError("usage", "serve [socket] [window=<ms>]");
+        return 1;
+    }
+    if (window) sales_commit_window_ms = atoi(window);
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(address.sun_path)) {
+        commandError("socket path too long", path);
+        return 1;
+    }
+    strcpy(address.sun_path, path);
 
-    float total_sales = 0, total_discount = 0;
-    int total_orders = 0, total_items = 0;
-    Order order;
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listener < 0) {
+        commandError("cannot create socket", strerror(errno));
+        return 1;
+    }
+    if (bind(listener, (struct sockaddr*)&address, sizeof(address)) != 0) {
+        // A socket left behind by a daemon that died is taken over; one
+        // that still answers is not
+        int in_use = errno == EADDRINUSE;
+        int probe = socket(AF_UNIX, SOCK_STREAM, 0);
+        int alive = in_use && probe >= 0 &&
+                    connect(probe, (struct sockaddr*)&address, sizeof(address)) == 0;
+        if (probe >= 0) close(probe);
+        if (!in_use || alive || unlink(path) != 0 ||
+            bind(listener, (struct sockaddr*)&address, sizeof(address)) != 0) {
+            commandError(alive ? "already serving" : "cannot listen on", path);
+            close(listener);
+            return 1;
+        }
+    }
+    if (listen(listener, SOMAXCONN) != 0) {
+        commandError("cannot listen on", path);
+        close(listener);
+        unlink(path);
+        return 1;
+    }
+    if (pipe(server_wake) != 0 || !openEvents()) {
+        commandError("cannot start", strerror(errno));
+        close(listener);
+        unlink(path);
+        return 1;
+    }
+    setNonBlocking(listener);
+    setNonBlocking(server_wake[0]);
+    setNonBlocking(server_wake[1]);
+    watchFd(listener, &listener, SERVER_READ, 0);
+    watchFd(server_wake[0], server_wake, SERVER_READ, 0);
+    server_socket_path = path;
+    atexit(stopServer);
+    signal(SIGPIPE, SIG_IGN);
+
+    // Job workers leave Ctrl+C to this thread, whose handler only wakes
+    // the loop
+    startJobWorkers();
+    startSalesCommitter(wakeServer);
+    resumeReceiptQueue();
+    signal(SIGINT, stopServerSignal);
+    signal(SIGTERM, stopServerSignal);
+    fprintf(stderr, "serving on %s\n", path);
+
+    ServerEvent events[SERVER_MAX_EVENTS];
+    int result = 0;
+    while (!server_stopping) {
+        int count = waitEvents(events, SERVER_MAX_EVENTS);
+        if (count < 0 && errno != EINTR) {
+            commandError("cannot wait for requests", strerror(errno));
+            result = 1;
+            break;
+        }
+        for (int i = 0; i < count; i++) {
+            if (events[i].data == &listener) acceptSessions(listener);
+            else if (events[i].data == server_wake) finishServerJobs();
+            else serviceSession(events[i].data, events[i].readable);
+        }
+        freeClosedSessions();
+    }
+    // Reports already taken finish while server_lock is still free, and
+    // orders not yet synced are synced; the replies waiting on either then
+    // go out before the daemon does
+    stopJobWorkers();
+    stopSalesCommitter();
+    finishServerJobs();
+    freeClosedSessions();
+    return result;
+}
 
-    FILE* sales_file = fopen("sales.txt", "r");
-    if (sales_file) {
-        while (fscanf(sales_file, "%ld,%[^,],%d,%[^,],%f,%f\n",
-                    &order.id,
-                    order.customer_phone,
-                    &order.employee_id,
-                    order.date,
-                    &order.total_amount,
-                    &order.discount) != EOF) {
-            
-            if (strstr(order.date, date)) {
-                // Get customer name
-                char customer_name[MAX_STRING] = "Guest";
-                for (int i = 0; i < customer_count; i++) {
-                    if (strcmp(customers[i].phone, order.customer_phone) == 0) {
-                        strcpy(customer_name, customers[i].name);
-                        break;
-                    }
-                }
+// Prints replies as they arrive, so that requests can go out without
+// waiting for the ones before them
+void* readClientReplies(void* arg) {
+    ClientReplies* replies = arg;
+    uint32_t size;
+    char* reply;
+    while ((reply = readFrame(replies->fd, UINT32_MAX - 1, &size))) {
+        if (size > 0 && reply[0] == 0) {
+            fwrite(reply + 1, 1, size - 1, stdout);
+            fflush(stdout);
+        } else {
+            fwrite(reply + 1, 1, size > 0 ? size - 1 : 0, stderr);
+            replies->failed++;
+        }
+        replies->received++;
+        free(reply);
+    }
+    return NULL;
+}
 
-                // Extract time from date
-                char time_str[9];
-                strncpy(time_str, order.date + 11, 8);
-                time_str[8] = '\0';
-
-                // Count items in order
-                int items_count = 0;
-                FILE* items_file = fopen("sales_items.txt", "r");
-                if (items_file) {
-                    int order_id, product_id, quantity;
-                    float price;
-                    while (fscanf(items_file, "%d,%d,%d,%f\n", 
-                                &order_id, &product_id, &quantity, &price) != EOF) {
-                        if (order_id == order.id) {
-                            items_count += quantity;
-                        }
-                    }
-                    fclose(items_file);
-                }
+// Sends the request in argv, or one per line of stdin so that a cart can
+// be built up over several. Replies print to stdout, failures to stderr.
+int runClient(int argc, char* argv[]) {
+    if (argc < 2) {
+        commandError("usage", "client <socket> [request...]");
+        return 1;
+    }
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (strlen(argv[1]) >= sizeof(address.sun_path)) {
+        commandError("socket path too long", argv[1]);
+        return 1;
+    }
+    strcpy(address.sun_path, argv[1]);
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || connect(fd, (struct sockaddr*)&address, sizeof(address)) != 0) {
+        commandError("cannot connect to", argv[1]);
+        if (fd >= 0) close(fd);
+        return 1;
+    }
+    signal(SIGPIPE, SIG_IGN);
+
+    ClientReplies replies = {fd, 0, 0};
+    pthread_t reader;
+    if (pthread_create(&reader, NULL, readClientReplies, &replies) != 0) {
+        commandError("cannot start", "reply reader");
+        close(fd);
+        return 1;
+    }
 
-                // Write order row
-                fprintf(file, "<tr><td>%s</td><td>%ld</td><td>%s</td><td>%d</td><td>%.2f</td><td>%.2f</td><td>%.2f</td></tr>\n",
-                       time_str, 
-                       order.id, 
-                       customer_name, 
-                       items_count, 
-                       order.total_amount, 
-                       order.discount,
-                       order.total_amount - order.discount);
-
-                total_sales += order.total_amount;
-                total_discount += order.discount;
-                total_orders++;
-                total_items += items_count;
-            }
+    char line[SERVER_MAX_REQUEST];
+    int sent = 0, lost = 0;
+    if (argc > 2) {
+        int n = 0;
+        line[0] = '\0';
+        for (int a = 2; a < argc && n < (int)sizeof(line); a++) {
+            n += snprintf(line + n, sizeof(line) - n, "%s%s", a > 2 ? " " : "", argv[a]);
+        }
+        lost = !writeFrame(fd, line, (uint32_t)strlen(line));
+        sent++;
+    } else {
+        while (!lost && fgets(line, sizeof(line), stdin)) {
+            line[strcspn(line, "\r\n")] = '\0';
+            if (line[strspn(line, " \t")] == '\0' || line[0] == '#') continue;
+            lost = !writeFrame(fd, line, (uint32_t)strlen(line));
+            sent++;
         }
-        fclose(sales_file);
     }
+    // The daemon answers everything sent and then hangs up
+    shutdown(fd, SHUT_WR);
+    pthread_join(reader, NULL);
+    close(fd);
+
+    if (lost || replies.received < sent) {
+        commandError("connection lost", argv[1]);
+        return 1;
+    }
+    return replies.failed ? 1 : 0;
+}
+#else
+int runServer(int argc, char* argv[]) {
+    (void)argc;
+    (void)argv;
+    commandError("not supported on this platform", "serve");
+    return 1;
+}
 
-    fprintf(file, "</table>\n");
-    
-    // Write summary
-    fprintf(file, "<div class='summary'>\n");
-    fprintf(file, "<h3>Daily Summary</h3>\n");
-    fprintf(file, "<p><strong>Total Orders:</strong> %d</p>\n", total_orders);
-    fprintf(file, "<p><strong>Total Items Sold:</strong> %d</p>\n", total_items);
-    fprintf(file, "<p><strong>Total Sales:</strong> %.2f</p>\n", total_sales);
-    fprintf(file, "<p><strong>Total Discounts:</strong> %.2f</p>\n", total_discount);
-    fprintf(file, "<p><strong>Net Sales:</strong> %.2f</p>\n", total_sales - total_discount);
-    fprintf(file, "<p><strong>Average Order Value:</strong> %.2f</p>\n", 
-            total_orders > 0 ? (total_sales - total_discount)/total_orders : 0);
-    fprintf(file, "</div>\n");
+int runClient(int argc, char* argv[]) {
+    (void)argc;
+    (void)argv;
+    commandError("not supported on this platform", "client");
+    return 1;
 }
 
-void openPDF(const char* filename) {
-    #ifdef _WIN32
-        char command[512];
-        sprintf(command, "start %s", filename);
-    #else
-        char command[512];
-        sprintf(command, "open %s", filename);  // 'open' command for macOS
-    #endif
-    system(command);
+OutputBuffer* pauseServerRequest() {
+    return NULL;
+}
+
+void resumeServerRequest(OutputBuffer* reply) {
+    (void)reply;
 }
+#endif
@@ -0,0 +1,40 @@
+#!/bin/sh
+# A checkout cut short by a crash leaves a torn record at the end of its
+# month's sales log. Orders made after it must still be readable.
+#
+#   tests/torn_sales_log.sh [path/to/shop]
+shop=$(cd "$(dirname "${1:-./shop}")" && pwd)/$(basename "${1:-./shop}")
+dir=$(mktemp -d)
+trap 'rm -rf "$dir"' EXIT
+cp "$(dirname "$0")/../products.txt" "$(dirname "$0")/../customers.txt" \
+   "$(dirname "$0")/../employees.txt" "$dir/"
+cd "$dir" || exit 1
+
+fail() {
+    echo "FAIL: $1"
+    exit 1
+}
+
+"$shop" restock 1 10 >/dev/null || fail "restock"
+"$shop" checkout 1 GUEST 1:1 >/dev/null || fail "first checkout"
+"$shop" checkout 1 GUEST 2:1 >/dev/null || fail "second checkout"
+
+# Tear the second order
+log=$(ls sales/*.log)
+size=$(wc -c < "$log")
+head -c $((size - 5)) "$log" > torn && mv torn "$log"
+
+"$shop" checkout 1 GUEST 1:2 >/dev/null || fail "checkout after the tear"
+"$shop" checkout 1 GUEST 2:3 >/dev/null || fail "second checkout after the tear"
+
+check() {
+    "$shop" report daily_sales csv report.csv >/dev/null || fail "report"
+    for amount in 700.00 1400.00 3000.00; do
+        grep -q ",$amount,0.00,$amount\$" report.csv || fail "order of $amount missing $1"
+    done
+    [ "$(grep -c ',Guest,' report.csv)" = 3 ] || fail "torn order reported $1"
+}
+check ""
+rm -f sales.agg
+check "after rebuilding sales.agg"
+echo "PASS"